@@ -0,0 +1,41 @@
+QT += quick quickcontrols2
+
+# Application name
+TARGET = inksight
+TEMPLATE = app
+
+# Version info
+VERSION = 0.1.0
+DEFINES += APP_VERSION=\\\"$$VERSION\\\"
+
+# Everything but main.cpp is shared with the benchmarks
+include(core.pri)
+
+SOURCES += src/main.cpp
+
+# QML files
+RESOURCES += qml.qrc
+
+# Additional import path for QML modules
+QML_IMPORT_PATH =
+
+# Default rules for deployment
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /home/root
+!isEmpty(target.path): INSTALLS += target
+
+# Optional local Mermaid renderer, used when Node.js is installed
+mermaidworker.files = src/mermaid-worker.mjs
+mermaidworker.path = $$target.path
+!isEmpty(target.path): INSTALLS += mermaidworker
+
+# reMarkable Paper Pro specific settings are in core.pri; these are
+# activated when cross-compiling with the Chiappa SDK
+chiappa {
+    message("Building for reMarkable Paper Pro (Chiappa)")
+}
+
+# Development mode (native build for testing)
+!chiappa {
+    message("Building for development/testing")
+}
@@ -0,0 +1,74 @@
+# Ghostwriter Pro core: everything but main.cpp and the QML, for the
+# application and the benchmarks to build against
+
+QT += network svg
+
+CONFIG += c++17
+
+INCLUDEPATH += $$PWD/src
+
+SOURCES += \
+    $$PWD/src/editor.cpp \
+    $$PWD/src/filemanager.cpp \
+    $$PWD/src/inputhandler.cpp \
+    $$PWD/src/aiconfig.cpp \
+    $$PWD/src/aiclient.cpp \
+    $$PWD/src/aitransform.cpp \
+    $$PWD/src/mermaidrenderer.cpp \
+    $$PWD/src/piecetable.cpp \
+    $$PWD/src/undohistory.cpp \
+    $$PWD/src/streamparser.cpp \
+    $$PWD/src/diskcache.cpp \
+    $$PWD/src/networksession.cpp \
+    $$PWD/src/textchunker.cpp \
+    $$PWD/src/diagramlayout.cpp \
+    $$PWD/src/diagramrasterizer.cpp \
+    $$PWD/src/mermaidcache.cpp \
+    $$PWD/src/searchindex.cpp \
+    $$PWD/src/fuzzymatcher.cpp \
+    $$PWD/src/documentlistmodel.cpp \
+    $$PWD/src/editjournal.cpp \
+    $$PWD/src/metrics.cpp \
+    $$PWD/src/refreshscheduler.cpp
+
+HEADERS += \
+    $$PWD/src/editor.h \
+    $$PWD/src/filemanager.h \
+    $$PWD/src/inputhandler.h \
+    $$PWD/src/aiconfig.h \
+    $$PWD/src/aiclient.h \
+    $$PWD/src/aitransform.h \
+    $$PWD/src/mermaidrenderer.h \
+    $$PWD/src/piecetable.h \
+    $$PWD/src/undohistory.h \
+    $$PWD/src/streamparser.h \
+    $$PWD/src/diskcache.h \
+    $$PWD/src/networksession.h \
+    $$PWD/src/textchunker.h \
+    $$PWD/src/diagramlayout.h \
+    $$PWD/src/diagramrasterizer.h \
+    $$PWD/src/mermaidcache.h \
+    $$PWD/src/searchindex.h \
+    $$PWD/src/fuzzymatcher.h \
+    $$PWD/src/documentlistmodel.h \
+    $$PWD/src/editjournal.h \
+    $$PWD/src/metrics.h \
+    $$PWD/src/refreshscheduler.h \
+    $$PWD/src/cachebudget.h
+
+# reMarkable Paper Pro: set when cross-compiling with the Chiappa SDK
+chiappa {
+    # E-paper specific defines
+    DEFINES += REMARKABLE_PAPERPRO
+
+    # Link against evdev for keyboard input
+    LIBS += -levdev
+
+    # Keyboard reader thread and layouts (evdev only)
+    SOURCES += $$PWD/src/evdevreader.cpp $$PWD/src/keymap.cpp
+    HEADERS += $$PWD/src/evdevreader.h $$PWD/src/keymap.h
+}
+
+!chiappa {
+    DEFINES += DEVELOPMENT_BUILD
+}
@@ -17,6 +17,10 @@ Rectangle {
     property string resultText: ""
     property bool isMermaid: false
     property string mermaidImagePath: ""
+    // Still streaming or rendering: the text is not final yet
+    property bool busy: false
+    // Further results waiting behind this one
+    property int queuedCount: 0
 
     signal replaceClicked()
     signal insertAfterClicked()
@@ -54,9 +58,12 @@ Rectangle {
                 }
 
                 Text {
-                    text: root.isMermaid 
-                        ? "Mermaid diagram rendered" 
-                        : root.resultText.length + " characters"
+                    text: (root.busy
+                        ? "Receiving... " + root.resultText.length + " characters"
+                        : root.isMermaid
+                        ? "Mermaid diagram rendered"
+                        : root.resultText.length + " characters")
+                        + (root.queuedCount > 0 ? " · " + root.queuedCount + " more queued" : "")
                     font.pixelSize: 12
                     color: "#666666"
                 }
@@ -245,6 +252,7 @@ Rectangle {
                 width: 120
                 height: 44
                 radius: 4
+                opacity: root.busy ? 0.4 : 1.0
                 color: insertArea.pressed ? "#444444" : "#555555"
 
                 Text {
@@ -258,6 +266,7 @@ Rectangle {
                 MouseArea {
                     id: insertArea
                     anchors.fill: parent
+                    enabled: !root.busy
                     onClicked: root.insertAfterClicked()
                 }
             }
@@ -267,6 +276,7 @@ Rectangle {
                 width: 120
                 height: 44
                 radius: 4
+                opacity: root.busy ? 0.4 : 1.0
                 color: replaceArea.pressed ? "#222222" : "#333333"
 
                 Text {
@@ -280,6 +290,7 @@ Rectangle {
                 MouseArea {
                     id: replaceArea
                     anchors.fill: parent
+                    enabled: !root.busy
                     onClicked: root.replaceClicked()
                 }
             }
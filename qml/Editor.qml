@@ -46,14 +46,16 @@ Item {
             selectedTextColor: "#000000"
             textFormat: TextEdit.PlainText
 
-            // Sync with editor content
-            text: editor.content
-
-            // Sync cursor position
-            cursorPosition: editor.cursorPosition
-
-            // Sync selection
-            Component.onCompleted: updateSelection()
+            // Edits since the last refresh, with the text each one inserted
+            property var pendingEdits: []
+
+            // Initial sync; afterwards edits are applied incrementally so
+            // only the changed block is re-laid-out and repainted
+            Component.onCompleted: {
+                text = editor.content
+                cursorPosition = editor.cursorPosition
+                updateSelection()
+            }
 
             function updateSelection() {
                 if (editor.hasSelection) {
@@ -63,56 +65,60 @@ Item {
                 }
             }
 
+            function applyPendingEdits() {
+                for (var i = 0; i < pendingEdits.length; i++) {
+                    var edit = pendingEdits[i]
+                    if (edit.removed > 0) {
+                        remove(edit.position, edit.position + edit.removed)
+                    }
+                    if (edit.text.length > 0) {
+                        insert(edit.position, edit.text)
+                    }
+                }
+                pendingEdits = []
+            }
+
+            // Edits are held until the refresh scheduler says the panel may
+            // update, then shown together with the cursor and selection
             Connections {
                 target: editor
-                function onSelectionChanged() {
-                    textDisplay.updateSelection()
+                function onContentsChange(position, charsRemoved, charsAdded) {
+                    textDisplay.pendingEdits.push({
+                        position: position,
+                        removed: charsRemoved,
+                        text: charsAdded > 0 ? editor.textRange(position, charsAdded) : ""
+                    })
                 }
-                function onCursorPositionChanged() {
+            }
+
+            Connections {
+                target: refreshScheduler
+                function onRefresh(firstLine, lastLine, waveform, flash) {
+                    textDisplay.applyPendingEdits()
                     textDisplay.cursorPosition = editor.cursorPosition
-                }
-                function onContentChanged() {
-                    textDisplay.text = editor.content
+                    textDisplay.updateSelection()
+                    if (flash && refreshScheduler.ghostingCleanup) {
+                        cleanupFlash.start()
+                    }
                 }
             }
 
-            // Show cursor in edit mode
-            cursorVisible: editMode
+            // The overlay draws the cursor; the built-in one blinks
+            cursorVisible: false
         }
 
-        // Cursor overlay for better visibility
+        // Cursor overlay for better visibility. It does not blink: on e-ink
+        // every blink would be a panel update
         Rectangle {
             id: cursorOverlay
             width: 2
-            height: editor.fontSize * 1.2
+            height: textDisplay.cursorRectangle.height
             color: "#000000"
-            visible: editMode && !editor.hasSelection
-            opacity: cursorBlink.running ? (cursorBlinkState ? 1 : 0) : 1
-
-            property bool cursorBlinkState: true
-
-            Timer {
-                id: cursorBlink
-                interval: 500
-                running: editMode && root.visible && !editor.hasSelection
-                repeat: true
-                onTriggered: cursorOverlay.cursorBlinkState = !cursorOverlay.cursorBlinkState
-            }
+            visible: editMode && textDisplay.selectedText.length === 0
 
-            // Position the cursor overlay
-            // This is approximate - for production you'd calculate from text metrics
-            x: {
-                // Simple estimate based on character position
-                var lineStart = editor.content.lastIndexOf('\n', editor.cursorPosition - 1) + 1
-                var col = editor.cursorPosition - lineStart
-                return col * editor.fontSize * 0.6  // Approximate character width
-            }
-            y: {
-                // Count newlines before cursor
-                var text = editor.content.substring(0, editor.cursorPosition)
-                var lines = text.split('\n').length - 1
-                return lines * editor.fontSize * 1.5
-            }
+            // Follow the text layout's own cursor geometry
+            x: textDisplay.cursorRectangle.x
+            y: textDisplay.cursorRectangle.y
         }
 
         ScrollBar.vertical: ScrollBar {
@@ -145,18 +151,20 @@ Item {
         text: "Start typing..."
         font.pixelSize: 24
         color: "#cccccc"
-        visible: editor.content.length === 0 && editMode
+        visible: editor.length === 0 && editMode
+    }
+
+    // Ghosting cleanup: changing every pixel of the editor makes the panel
+    // redraw it with its full waveform
+    Rectangle {
+        id: cleanupOverlay
+        anchors.fill: parent
+        color: "#000000"
+        visible: cleanupFlash.running
     }
 
-    // Cursor blink animation
     Timer {
-        id: cursorBlink
-        interval: 500
-        running: editMode && root.visible
-        repeat: true
-        onTriggered: {
-            // Toggle cursor visibility by updating text
-            textDisplay.opacity = textDisplay.opacity === 1 ? 0.99 : 1
-        }
+        id: cleanupFlash
+        interval: 100
     }
 }
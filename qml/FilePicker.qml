@@ -68,7 +68,7 @@ Rectangle {
         anchors.bottom: parent.bottom
         anchors.margins: 20
 
-        model: fileManager.documents
+        model: fileManager.documentModel
 
         delegate: Rectangle {
             width: documentList.width
@@ -87,12 +87,22 @@ Rectangle {
                 anchors.left: parent.left
                 anchors.leftMargin: 20
                 anchors.verticalCenter: parent.verticalCenter
-                text: modelData
+                text: model.name
                 font.pixelSize: 18
                 color: "#333333"
             }
 
             Text {
+                anchors.right: arrow.left
+                anchors.rightMargin: 20
+                anchors.verticalCenter: parent.verticalCenter
+                text: model.wordCount >= 0 ? qsTr("%1 words").arg(model.wordCount) : ""
+                font.pixelSize: 14
+                color: "#999999"
+            }
+
+            Text {
+                id: arrow
                 anchors.right: parent.right
                 anchors.rightMargin: 20
                 anchors.verticalCenter: parent.verticalCenter
@@ -105,7 +115,7 @@ Rectangle {
                 id: delegateArea
                 anchors.fill: parent
                 onClicked: {
-                    root.fileSelected(fileManager.fullPath(modelData))
+                    root.fileSelected(fileManager.fullPath(model.name))
                 }
             }
         }
@@ -0,0 +1,119 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * MetricsOverlay.qml - Ctrl+Shift+M performance readout
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+import QtQuick 2.15
+
+Rectangle {
+    id: root
+    width: 320
+    height: content.height + 24
+    radius: 8
+    color: "#ffffff"
+    border.color: "#333333"
+    border.width: 2
+
+    property var snapshot: ({})
+
+    function refresh() {
+        snapshot = metrics.snapshot()
+    }
+
+    function histogram(name) {
+        var histograms = snapshot.histograms || {}
+        return histograms[name] || { count: 0, p50: 0, p99: 0 }
+    }
+
+    function counter(name) {
+        var counters = snapshot.counters || {}
+        return counters[name] || 0
+    }
+
+    function gauge(name) {
+        var gauges = snapshot.gauges || {}
+        return gauges[name] || 0
+    }
+
+    function latencyLine(label, name, unit) {
+        var h = histogram(name)
+        if (h.count === 0) return label + ": -"
+        return label + ": p50 " + h.p50 + " / p99 " + h.p99 + " " + unit + "  (" + h.count + ")"
+    }
+
+    // One line per provider that has been used
+    function aiLines() {
+        var lines = []
+        var histograms = snapshot.histograms || {}
+        for (var name in histograms) {
+            var match = name.match(/^ai\.(.+)\.ttfb_ms$/)
+            if (match) {
+                lines.push(latencyLine(match[1] + " first byte", name, "ms"))
+                lines.push(latencyLine(match[1] + " total", "ai." + match[1] + ".total_ms", "ms"))
+            }
+        }
+        return lines
+    }
+
+    function refreshCounts() {
+        return "Refreshes: " + counter("display.refresh_fast") + " fast, "
+            + counter("display.refresh_partial") + " partial, "
+            + counter("display.refresh_full") + " full"
+    }
+
+    function mermaidHitRate() {
+        var hits = counter("mermaid.cache_hits")
+        var total = hits + counter("mermaid.cache_misses")
+        if (total === 0) return "Mermaid cache: -"
+        return "Mermaid cache: " + Math.round(100 * hits / total) + "% hits of " + total
+    }
+
+    // Poll only while shown; each refresh redraws part of the e-ink panel
+    Timer {
+        interval: 2000
+        repeat: true
+        running: root.visible
+        triggeredOnStart: true
+        onTriggered: root.refresh()
+    }
+
+    Column {
+        id: content
+        anchors.left: parent.left
+        anchors.right: parent.right
+        anchors.top: parent.top
+        anchors.margins: 12
+        spacing: 4
+
+        Text {
+            text: "Metrics"
+            font.pixelSize: 16
+            font.bold: true
+            color: "#000000"
+        }
+
+        Repeater {
+            model: [
+                root.latencyLine("Keystroke", "editor.keystroke_latency_us", "us"),
+                root.latencyLine("Keys per read", "input.batch_size", ""),
+                root.refreshCounts(),
+                "Undo history: " + Math.round(root.gauge("editor.undo_bytes") / 1024) + " KB",
+                root.mermaidHitRate(),
+                root.latencyLine("Mermaid render", "mermaid.render_ms", "ms")
+            ].concat(root.aiLines())
+
+            Text {
+                width: content.width
+                text: modelData
+                font.pixelSize: 12
+                font.family: "monospace"
+                color: "#333333"
+                elide: Text.ElideRight
+            }
+        }
+    }
+}
@@ -23,7 +23,19 @@ Rectangle {
     signal cancelled()
 
     property string searchQuery: ""
-    property var filteredDocuments: fileManager.searchDocuments(searchQuery)
+    property var filteredDocuments: mergeResults(fileManager.searchDocuments(searchQuery),
+                                                 fileManager.searchContent(searchQuery, 20))
+
+    // Name matches first, then documents that only match by content
+    function mergeResults(byName, byContent) {
+        var results = byName.slice()
+        for (var i = 0; i < byContent.length; i++) {
+            if (results.indexOf(byContent[i]) < 0) {
+                results.push(byContent[i])
+            }
+        }
+        return results
+    }
 
     function accept() {
         if (searchQuery.length > 0) {
@@ -34,13 +34,41 @@ ApplicationWindow {
     property bool aiResultVisible: false
     property bool aiSettingsVisible: false
 
+    // Result on show in the AI result view
+    property string aiResultText: ""
+    property bool aiResultIsMermaid: false
+    property string aiResultImagePath: ""
+
+    // Performance readout (Ctrl+Shift+M)
+    property bool metricsOverlayVisible: false
+
+    // The AI views are only created the first time they are needed,
+    // then kept for next time
+    onPromptPaletteVisibleChanged: {
+        if (promptPaletteVisible) {
+            promptPaletteLoader.active = true
+            // Connect to the AI provider while a prompt is being picked
+            aiTransform.prewarm()
+        }
+    }
+    onAiResultVisibleChanged: {
+        if (aiResultVisible) {
+            aiResultLoader.active = true
+        }
+    }
+    onAiSettingsVisibleChanged: {
+        if (aiSettingsVisible) {
+            aiSettingsLoader.active = true
+        }
+    }
+
     // Connect to input handler signals
     Connections {
         target: inputHandler
 
-        function onKeyPressed(key, modifiers) {
+        function onTextEntered(text) {
             if (mode === "edit") {
-                editorComponent.insertText(key)
+                editorComponent.insertText(text)
             }
         }
 
@@ -137,6 +165,10 @@ ApplicationWindow {
             aiSettingsVisible = true
         }
 
+        function onMetricsOverlayRequested() {
+            metricsOverlayVisible = !metricsOverlayVisible
+        }
+
         // Selection with Shift+arrows
         function onSelectionArrowPressed(direction) {
             if (mode === "edit") {
@@ -163,9 +195,16 @@ ApplicationWindow {
         }
 
         function onShowResult(result, isMermaid, imagePath) {
-            aiResultView.resultText = result
-            aiResultView.isMermaid = isMermaid
-            aiResultView.mermaidImagePath = imagePath
+            aiResultText = result
+            aiResultIsMermaid = isMermaid
+            aiResultImagePath = imagePath
+            aiResultVisible = true
+        }
+
+        function onShowPartialResult(result) {
+            aiResultText = result
+            aiResultIsMermaid = false
+            aiResultImagePath = ""
             aiResultVisible = true
         }
 
@@ -173,6 +212,10 @@ ApplicationWindow {
             aiSettingsVisible = true
         }
 
+        function onHideResult() {
+            aiResultVisible = false
+        }
+
         function onShowError(error) {
             notification.show("AI Error: " + error)
         }
@@ -237,56 +280,83 @@ ApplicationWindow {
     }
 
     // AI Prompt Palette overlay
-    PromptPalette {
-        id: promptPalette
+    Loader {
+        id: promptPaletteLoader
         anchors.centerIn: parent
+        active: false
         visible: promptPaletteVisible
-        selectedText: editor.selectedText
-        templates: aiTransform.promptTemplates
 
-        onPromptSelected: function(templateId, customPrompt) {
-            promptPaletteVisible = false
-            aiTransform.transform(templateId, customPrompt)
-        }
+        sourceComponent: PromptPalette {
+            selectedText: editor.selectedText
+            templates: aiTransform.promptTemplates
 
-        onCancelled: {
-            promptPaletteVisible = false
+            onPromptSelected: function(templateId, customPrompt) {
+                promptPaletteVisible = false
+                aiTransform.transform(templateId, customPrompt)
+            }
+
+            onCancelled: {
+                promptPaletteVisible = false
+            }
         }
     }
 
     // AI Result View overlay
-    AIResultView {
-        id: aiResultView
+    Loader {
+        id: aiResultLoader
         anchors.fill: parent
+        active: false
         visible: aiResultVisible
 
-        onReplaceClicked: {
-            aiTransform.replaceSelection()
-            aiResultVisible = false
-        }
+        sourceComponent: AIResultView {
+            resultText: aiResultText
+            isMermaid: aiResultIsMermaid
+            mermaidImagePath: aiResultImagePath
+            busy: !aiTransform.resultReady
+            queuedCount: aiTransform.queuedResults
+
+            // Hide first: applying a result may bring up the next one
+            onReplaceClicked: {
+                aiResultVisible = false
+                aiTransform.replaceSelection()
+            }
 
-        onInsertAfterClicked: {
-            aiTransform.insertAfterSelection()
-            aiResultVisible = false
-        }
+            onInsertAfterClicked: {
+                aiResultVisible = false
+                aiTransform.insertAfterSelection()
+            }
 
-        onDiscardClicked: {
-            aiTransform.discardResult()
-            aiResultVisible = false
+            onDiscardClicked: {
+                aiResultVisible = false
+                aiTransform.discardResult()
+            }
         }
     }
 
     // AI Settings overlay
-    AISettings {
-        id: aiSettings
+    Loader {
+        id: aiSettingsLoader
         anchors.fill: parent
+        active: false
         visible: aiSettingsVisible
 
-        onClosed: {
-            aiSettingsVisible = false
+        sourceComponent: AISettings {
+            onClosed: {
+                aiSettingsVisible = false
+            }
         }
     }
 
+    // Metrics overlay, out of the way of the text
+    Loader {
+        anchors.top: parent.top
+        anchors.right: parent.right
+        anchors.margins: 16
+        active: metricsOverlayVisible
+
+        sourceComponent: MetricsOverlay {}
+    }
+
     // AI loading indicator
     Rectangle {
         id: aiLoadingIndicator
@@ -358,12 +428,29 @@ ApplicationWindow {
             anchors.verticalCenter: parent.verticalCenter
             spacing: 20
 
-            // Selection indicator
+            // Selection indicator and cursor location follow the editor's
+            // refreshes, so typing does not also redraw the status bar
             Text {
-                text: editor.hasSelection ? "SEL: " + (editor.selectionEnd - editor.selectionStart) : ""
+                id: selectionIndicator
                 font.pixelSize: 12
                 color: "#666666"
-                visible: editor.hasSelection
+                visible: text.length > 0
+            }
+
+            Text {
+                id: cursorLocation
+                text: "Ln 1, Col 1"
+                font.pixelSize: 12
+                color: "#666666"
+            }
+
+            Connections {
+                target: refreshScheduler
+                function onRefresh(firstLine, lastLine, waveform) {
+                    selectionIndicator.text = editor.hasSelection
+                        ? "SEL: " + (editor.selectionEnd - editor.selectionStart) : ""
+                    cursorLocation.text = "Ln " + (editor.cursorLine + 1) + ", Col " + (editor.cursorColumn + 1)
+                }
             }
 
             // AI indicator
@@ -464,6 +551,11 @@ ApplicationWindow {
                     case Qt.Key_T: inputHandler.aiTransformRequested(); event.accepted = true; break  // AI Transform
                     case Qt.Key_Comma: inputHandler.aiSettingsRequested(); event.accepted = true; break // AI Settings
                     case Qt.Key_A: editor.selectAll(); event.accepted = true; break  // Select all
+                    case Qt.Key_M:
+                        if (event.modifiers & Qt.ShiftModifier) {
+                            inputHandler.metricsOverlayRequested(); event.accepted = true
+                        }
+                        break
                 }
             } else if (event.modifiers & Qt.ShiftModifier) {
                 // Selection with Shift+arrows
@@ -481,8 +573,8 @@ ApplicationWindow {
                         if (promptPaletteVisible) {
                             promptPaletteVisible = false
                         } else if (aiResultVisible) {
-                            aiTransform.discardResult()
                             aiResultVisible = false
+                            aiTransform.discardResult()
                         } else if (aiSettingsVisible) {
                             aiSettingsVisible = false
                         } else if (editor.hasSelection) {
@@ -504,11 +596,7 @@ ApplicationWindow {
                         if (event.text && mode === "edit") {
                             // If there's a selection, delete it first
                             if (editor.hasSelection) {
-                                var content = editor.content
-                                var before = content.substring(0, editor.selectionStart)
-                                var after = content.substring(editor.selectionEnd)
-                                editor.setContent(before + after)
-                                editor.setCursorPosition(editor.selectionStart)
+                                editor.replaceRange(editor.selectionStart, editor.selectionEnd, "")
                                 editor.clearSelection()
                             }
                             editorComponent.insertText(event.text)
@@ -8,23 +8,34 @@
  */
 
 #include "aiclient.h"
+#include "metrics.h"
+#include "networksession.h"
+#include "textchunker.h"
 #include <QNetworkRequest>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QRegularExpression>
+#include <QTimer>
+#include <QRandomGenerator>
 #include <QDebug>
 
 AIClient::AIClient(QObject *parent)
     : QObject(parent)
     , m_config(nullptr)
-    , m_networkManager(new QNetworkAccessManager(this))
-    , m_currentReply(nullptr)
+    , m_network(nullptr)
     , m_busy(false)
-    , m_expectsMermaid(false)
+    , m_nextRequestId(1)
 {
-    connect(m_networkManager, &QNetworkAccessManager::finished,
-            this, &AIClient::onRequestFinished);
+    m_decoder.setMaxThreadCount(1);
+}
+
+AIClient::~AIClient()
+{
+    // Decoded responses are dropped along with their requests
+    m_decoder.waitForDone();
+    qDeleteAll(m_requests);
+    qDeleteAll(m_mapReduces);
 }
 
 void AIClient::setConfig(AIConfig *config)
@@ -32,6 +43,21 @@ void AIClient::setConfig(AIConfig *config)
     m_config = config;
 }
 
+void AIClient::setNetworkSession(NetworkSession *session)
+{
+    m_network = session;
+}
+
+void AIClient::setCacheDirectory(const QString &path)
+{
+    m_cache.setDirectory(path + "/ai-cache", "txt");
+}
+
+void AIClient::clearCache()
+{
+    m_cache.clear();
+}
+
 bool AIClient::isBusy() const
 {
     return m_busy;
@@ -42,6 +68,11 @@ QString AIClient::statusMessage() const
     return m_statusMessage;
 }
 
+int AIClient::pendingRequests() const
+{
+    return m_requests.size();
+}
+
 void AIClient::setBusy(bool busy)
 {
     if (m_busy != busy) {
@@ -62,85 +93,596 @@ QString AIClient::buildSystemPrompt(const QString &templateId) const
 {
     if (!m_config) return QString();
     
-    for (const auto &pt : m_config->promptTemplates()) {
-        if (pt.id == templateId) {
-            return pt.prompt;
-        }
-    }
-    return QString();
+    const PromptTemplate *pt = m_config->promptTemplate(templateId);
+    return pt ? pt->prompt : QString();
 }
 
-void AIClient::transform(const QString &text, const QString &promptTemplate, const QString &customPrompt)
+int AIClient::transform(const QString &text, const QString &promptTemplate, const QString &customPrompt)
 {
-    if (!m_config) {
-        emit transformError("AI not configured");
-        return;
+    if (!m_config || !m_network) {
+        emit transformError(-1, "AI not configured");
+        return -1;
     }
     
     if (!m_config->isConfigured()) {
-        emit transformError("AI provider not configured. Please set up an API key in settings.");
-        return;
+        emit transformError(-1, "AI provider not configured. Please set up an API key in settings.");
+        return -1;
     }
     
-    if (m_busy) {
-        emit transformError("Already processing a request");
-        return;
-    }
+    QString systemPrompt;
+    QString reducePrompt;
+    bool expectsMermaid = false;
+    bool cacheable = true;
     
-    m_currentTemplateId = promptTemplate;
+    const PromptTemplate *pt = m_config->promptTemplate(promptTemplate);
+    if (pt) {
+        cacheable = pt->cacheable;
+        reducePrompt = pt->reducePrompt;
+        // Check if this template expects Mermaid output
+        expectsMermaid = pt->expectsMermaid;
+    }
     
     // Get the system prompt
-    QString systemPrompt;
     if (promptTemplate == "custom") {
         systemPrompt = customPrompt;
-        m_expectsMermaid = customPrompt.contains("mermaid", Qt::CaseInsensitive) ||
-                          customPrompt.contains("diagram", Qt::CaseInsensitive) ||
-                          customPrompt.contains("flowchart", Qt::CaseInsensitive);
+        expectsMermaid = customPrompt.contains("mermaid", Qt::CaseInsensitive) ||
+                         customPrompt.contains("diagram", Qt::CaseInsensitive) ||
+                         customPrompt.contains("flowchart", Qt::CaseInsensitive);
     } else {
         systemPrompt = buildSystemPrompt(promptTemplate);
-        // Check if this template expects Mermaid output
-        for (const auto &pt : m_config->promptTemplates()) {
-            if (pt.id == promptTemplate) {
-                m_expectsMermaid = pt.expectsMermaid;
-                break;
-            }
-        }
     }
     
     if (systemPrompt.isEmpty()) {
-        emit transformError("Invalid prompt template");
-        return;
+        emit transformError(-1, "Invalid prompt template");
+        return -1;
     }
     
+    // A custom prompt may need the whole text at once, so it is never split
+    if (promptTemplate != "custom" && text.size() > CHUNK_CHARS) {
+        QStringList chunks = TextChunker::split(text, CHUNK_CHARS);
+        if (chunks.size() > 1) {
+            return startMapReduce(chunks, systemPrompt, reducePrompt, expectsMermaid, cacheable);
+        }
+    }
+    
+    Request *request = createRequest(text, systemPrompt, expectsMermaid, cacheable);
+    submit(request);
+    return request->id;
+}
+
+AIClient::Request *AIClient::createRequest(const QString &text, const QString &systemPrompt,
+                                           bool expectsMermaid, bool cacheable)
+{
+    Request *request = new Request;
+    request->id = m_nextRequestId++;
+    request->provider = m_config->currentProvider();
+    request->systemPrompt = systemPrompt;
+    request->userContent = text;
+    request->expectsMermaid = expectsMermaid;
+    request->cacheable = cacheable;
+    request->attempt = 0;
+    request->primary.reply = nullptr;
+    request->primary.timeout = nullptr;
+    request->hedge.reply = nullptr;
+    request->hedge.timeout = nullptr;
+    request->winner = nullptr;
+    resetLeg(request->primary);
+    resetLeg(request->hedge);
+    
+    m_requests.insert(request->id, request);
+    return request;
+}
+
+void AIClient::submit(Request *request)
+{
     setBusy(true);
+    emit pendingRequestsChanged();
+    
+    if (request->cacheable && m_cache.contains(cacheKeyFor(*request, request->provider))) {
+        // Answer on the next event loop pass, after the caller has the id
+        const int id = request->id;
+        QTimer::singleShot(0, this, [this, id]() { deliverCached(id); });
+        return;
+    }
+    
+    m_queue.append(request->id);
+    if (!schedule()) {
+        setStatusMessage("Queued behind other AI requests...");
+    }
+}
+
+int AIClient::startMapReduce(const QStringList &chunks, const QString &systemPrompt,
+                             const QString &reducePrompt, bool expectsMermaid, bool cacheable)
+{
+    MapReduce *job = new MapReduce;
+    job->id = m_nextRequestId++;
+    job->reducePrompt = reducePrompt;
+    job->expectsMermaid = expectsMermaid;
+    job->cacheable = cacheable;
+    job->done.fill(false, chunks.size());
+    job->completed = 0;
+    job->front = 0;
+    job->shownChars = 0;
+    job->reduceRequest = -1;
+    job->tokens = 0;
+    m_mapReduces.insert(job->id, job);
+    
+    // All parts go into the queue at once and run as the provider allows
+    for (const QString &chunk : chunks) {
+        Request *part = createRequest(chunk, systemPrompt, expectsMermaid, cacheable);
+        job->parts.append(part->id);
+        job->results.append(QString());
+        m_partOf.insert(part->id, job->id);
+    }
+    for (int partId : job->parts) {
+        submit(m_requests.value(partId));
+    }
+    
+    setStatusMessage(QString("Split into %1 parts...").arg(chunks.size()));
+    return job->id;
+}
+
+void AIClient::emitChunk(Request *request, const QString &delta)
+{
+    MapReduce *job = m_mapReduces.value(m_partOf.value(request->id, -1));
+    if (!job) {
+        emit transformChunk(request->id, delta);
+    } else if (request->id == job->reduceRequest) {
+        emit transformChunk(job->id, delta);
+    } else if (job->reducePrompt.isEmpty()) {
+        // Joined parts stream out in document order
+        job->results[job->parts.indexOf(request->id)] += delta;
+        streamJoinedParts(job);
+    }
+}
+
+void AIClient::completeRequest(const AIResponse &response)
+{
+    MapReduce *job = m_mapReduces.value(m_partOf.take(response.requestId));
+    if (!job) {
+        emit transformComplete(response);
+        return;
+    }
+    
+    job->tokens += response.tokensUsed;
+    
+    if (response.requestId == job->reduceRequest) {
+        finishMapReduce(job, response.content);
+        return;
+    }
+    
+    int index = job->parts.indexOf(response.requestId);
+    job->results[index] = response.content;
+    job->done[index] = true;
+    ++job->completed;
+    
+    if (job->completed < job->parts.size()) {
+        setStatusMessage(QString("Processed %1 of %2 parts...")
+                         .arg(job->completed).arg(job->parts.size()));
+        if (job->reducePrompt.isEmpty()) {
+            streamJoinedParts(job);
+        }
+        return;
+    }
+    
+    if (job->reducePrompt.isEmpty()) {
+        streamJoinedParts(job);
+        finishMapReduce(job, job->results.join("\n\n"));
+        return;
+    }
+    
+    // Reduce the part results into one answer
+    Request *reduce = createRequest(job->results.join("\n\n---\n\n"), job->reducePrompt,
+                                    job->expectsMermaid, job->cacheable);
+    job->reduceRequest = reduce->id;
+    m_partOf.insert(reduce->id, job->id);
+    submit(reduce);
+    setStatusMessage("Combining parts...");
+}
+
+void AIClient::failRequest(int requestId, const QString &error)
+{
+    MapReduce *job = m_mapReduces.value(m_partOf.take(requestId));
+    if (!job) {
+        emit transformError(requestId, error);
+        return;
+    }
+    
+    // One failed part fails the whole transform
+    const int id = job->id;
+    removeMapReduce(id);
+    emit transformError(id, error);
+}
+
+void AIClient::streamJoinedParts(MapReduce *job)
+{
+    while (job->front < job->parts.size()) {
+        const QString &text = job->results.at(job->front);
+        if (text.size() > job->shownChars) {
+            QString delta = text.mid(job->shownChars);
+            if (job->shownChars == 0 && job->front > 0) {
+                delta.prepend("\n\n");
+            }
+            job->shownChars = text.size();
+            emit transformChunk(job->id, delta);
+        }
+        
+        if (!job->done.at(job->front)) break;
+        ++job->front;
+        job->shownChars = 0;
+    }
+}
+
+void AIClient::finishMapReduce(MapReduce *job, const QString &content)
+{
+    AIResponse response;
+    response.requestId = job->id;
+    response.success = true;
+    response.content = content;
+    response.isMermaid = false;
+    response.tokensUsed = job->tokens;
+    detectMermaid(response, job->expectsMermaid);
+    
+    removeMapReduce(job->id);
+    emit transformComplete(response);
+}
+
+void AIClient::removeMapReduce(int jobId)
+{
+    MapReduce *job = m_mapReduces.take(jobId);
+    if (!job) return;
+    
+    QList<int> ids = job->parts;
+    ids.append(job->reduceRequest);
+    delete job;
+    
+    // Unqueue every sibling first, so the slots freed below are not handed
+    // to a part that is about to go as well
+    for (int id : ids) {
+        m_partOf.remove(id);
+        m_queue.removeAll(id);
+    }
+    for (int id : ids) {
+        Request *request = m_requests.take(id);
+        if (!request) continue;
+        closeLeg(request->primary, true);
+        closeLeg(request->hedge, true);
+        delete request;
+    }
+    
+    emit pendingRequestsChanged();
+    schedule();
+    updateBusy();
+}
+
+QByteArray AIClient::cacheKeyFor(const Request &request, AIProvider provider) const
+{
+    return DiskCache::keyFor({
+        AIConfig::providerName(provider),
+        m_config->model(provider),
+        request.systemPrompt,
+        request.userContent
+    });
+}
+
+int AIClient::runningCount(AIProvider provider) const
+{
+    int running = 0;
+    for (const Request *request : m_requests) {
+        for (const Leg *leg : {&request->primary, &request->hedge}) {
+            if (leg->reply && leg->provider == provider) {
+                ++running;
+            }
+        }
+    }
+    return running;
+}
+
+bool AIClient::schedule()
+{
+    bool started = false;
+    
+    // FIFO per provider: a saturated provider does not hold back the others
+    for (int i = 0; i < m_queue.size(); ) {
+        Request *request = m_requests.value(m_queue.at(i));
+        if (runningCount(request->provider) >= m_config->maxConcurrentRequests(request->provider)) {
+            ++i;
+            continue;
+        }
+        
+        m_queue.removeAt(i);
+        startRequest(request);
+        started = true;
+    }
+    
+    return started;
+}
+
+void AIClient::startRequest(Request *request)
+{
     setStatusMessage("Connecting to AI...");
     
-    // Send to appropriate provider
-    switch (m_config->currentProvider()) {
+    if (!startLeg(request, request->primary, request->provider)) {
+        // Like a cache hit, after submit() has returned the id
+        const int id = request->id;
+        QTimer::singleShot(0, this, [this, id]() {
+            if (!m_requests.contains(id)) return; // Cancelled meanwhile
+            removeRequest(id);
+            failRequest(id, "No AI provider configured");
+        });
+        return;
+    }
+    
+    AIProvider hedgeProvider = m_config->hedgeProvider();
+    if (hedgeProvider != AIProvider::None && hedgeProvider != request->provider) {
+        const int id = request->id;
+        const int attempt = request->attempt;
+        QTimer::singleShot(m_config->hedgeDelay(), this, [this, id, attempt]() {
+            startHedge(id, attempt);
+        });
+    }
+}
+
+void AIClient::startHedge(int requestId, int attempt)
+{
+    Request *request = m_requests.value(requestId);
+    if (!request || request->attempt != attempt) return; // Finished or retried meanwhile
+    if (!request->primary.reply || request->winner || request->hedge.reply) return;
+    
+    AIProvider provider = m_config->hedgeProvider();
+    if (provider == AIProvider::None || provider == request->provider) return;
+    if (!m_config->isProviderConfigured(provider)) return;
+    if (runningCount(provider) >= m_config->maxConcurrentRequests(provider)) return;
+    
+    if (startLeg(request, request->hedge, provider)) {
+        setStatusMessage(QString("Slow response, also asking %1...")
+                         .arg(m_config->getProviderDisplayName(AIConfig::providerName(provider))));
+    }
+}
+
+bool AIClient::startLeg(Request *request, Leg &leg, AIProvider provider)
+{
+    resetLeg(leg);
+    leg.provider = provider;
+    
+    QNetworkReply *reply = nullptr;
+    switch (provider) {
         case AIProvider::OpenAI:
-            sendOpenAIRequest(systemPrompt, text);
+            reply = sendOpenAIRequest(request->systemPrompt, request->userContent);
             break;
         case AIProvider::Anthropic:
-            sendAnthropicRequest(systemPrompt, text);
+            reply = sendAnthropicRequest(request->systemPrompt, request->userContent);
             break;
         case AIProvider::Ollama:
-            sendOllamaRequest(systemPrompt, text);
+            reply = sendOllamaRequest(request->systemPrompt, request->userContent);
             break;
         default:
-            setBusy(false);
-            emit transformError("No AI provider configured");
             break;
     }
+    
+    if (!reply) return false;
+    
+    leg.reply = reply;
+    leg.startedUs = Metrics::nowUs();
+    leg.timeout = new QTimer(this);
+    leg.timeout->setSingleShot(true);
+    leg.timeout->setInterval(m_config->requestTimeout(provider) * 1000);
+    leg.timeout->start();
+    
+    // Per-reply connections, so every reply finds its own request and leg
+    const int id = request->id;
+    connect(reply, &QNetworkReply::readyRead, this, [this, id, reply]() { onReadyRead(id, reply); });
+    connect(reply, &QNetworkReply::finished, this, [this, id, reply]() { onReplyFinished(id, reply); });
+    connect(leg.timeout, &QTimer::timeout, this, [this, id, reply]() { onLegTimeout(id, reply); });
+    return true;
 }
 
-void AIClient::cancel()
+void AIClient::closeLeg(Leg &leg, bool abort)
 {
-    if (m_currentReply) {
-        m_currentReply->abort();
-        m_currentReply = nullptr;
+    if (leg.timeout) {
+        // May be running its own timeout signal right now
+        leg.timeout->stop();
+        leg.timeout->deleteLater();
+        leg.timeout = nullptr;
     }
-    setBusy(false);
-    setStatusMessage("");
+    if (leg.reply) {
+        leg.reply->disconnect(this);
+        if (abort) {
+            leg.reply->abort();
+        }
+        leg.reply->deleteLater();
+        leg.reply = nullptr;
+    }
+}
+
+void AIClient::resetLeg(Leg &leg)
+{
+    leg.provider = AIProvider::None;
+    leg.timedOut = false;
+    leg.decoding = false;
+    leg.startedUs = 0;
+    leg.firstByte = false;
+    leg.streaming = false;
+    leg.content.clear();
+    leg.error.clear();
+    leg.tokens = 0;
+}
+
+AIClient::Leg *AIClient::legFor(Request *request, QNetworkReply *reply)
+{
+    if (request->primary.reply == reply) return &request->primary;
+    if (request->hedge.reply == reply) return &request->hedge;
+    return nullptr;
+}
+
+void AIClient::removeRequest(int requestId)
+{
+    Request *request = m_requests.take(requestId);
+    if (!request) return;
+    
+    m_queue.removeAll(requestId);
+    closeLeg(request->primary, false);
+    closeLeg(request->hedge, false);
+    delete request;
+    
+    emit pendingRequestsChanged();
+    
+    // A slot opened up
+    schedule();
+    updateBusy();
+}
+
+void AIClient::updateBusy()
+{
+    if (m_requests.isEmpty() && m_mapReduces.isEmpty()) {
+        setBusy(false);
+        setStatusMessage("");
+    }
+}
+
+void AIClient::deliverCached(int requestId)
+{
+    Request *request = m_requests.value(requestId);
+    if (!request) return; // Cancelled meanwhile
+    
+    QByteArray data;
+    if (!m_cache.lookup(cacheKeyFor(*request, request->provider), &data)) {
+        // The entry went away; ask the provider after all
+        m_queue.append(requestId);
+        schedule();
+        return;
+    }
+    
+    decodeInBackground(request, [data]() {
+        AIResponse response;
+        response.success = true;
+        response.content = QString::fromUtf8(data);
+        response.isMermaid = false;
+        response.tokensUsed = 0;
+        return response;
+    }, [this](Request *, const AIResponse &response) {
+        removeRequest(response.requestId);
+        completeRequest(response);
+    });
+}
+
+void AIClient::decodeInBackground(Request *request, std::function<AIResponse()> decode,
+                                  std::function<void(Request *, const AIResponse &)> done)
+{
+    const int id = request->id;
+    const bool expectsMermaid = request->expectsMermaid;
+    m_decoder.start([this, id, expectsMermaid, decode, done]() {
+        AIResponse response = decode();
+        response.requestId = id;
+        if (response.success) {
+            detectMermaid(response, expectsMermaid);
+        }
+
+        QMetaObject::invokeMethod(this, [this, id, response, done]() {
+            Request *request = m_requests.value(id);
+            if (!request) return; // Cancelled meanwhile
+            done(request, response);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void AIClient::cancel(int requestId)
+{
+    if (m_mapReduces.contains(requestId)) {
+        removeMapReduce(requestId);
+        return;
+    }
+    
+    QList<int> ids;
+    if (requestId < 0) {
+        ids = m_requests.keys();
+        m_queue.clear(); // Nothing may start while the others are torn down
+        qDeleteAll(m_mapReduces);
+        m_mapReduces.clear();
+        m_partOf.clear();
+    } else if (m_requests.contains(requestId)) {
+        ids.append(requestId);
+    }
+    
+    // Cancelled requests end silently, without transformError
+    for (int id : ids) {
+        Request *request = m_requests.value(id);
+        closeLeg(request->primary, true);
+        closeLeg(request->hedge, true);
+        removeRequest(id);
+    }
+    updateBusy();
+}
+
+bool AIClient::isTransientError(QNetworkReply::NetworkError error)
+{
+    switch (error) {
+        case QNetworkReply::RemoteHostClosedError:
+        case QNetworkReply::HostNotFoundError:
+        case QNetworkReply::TimeoutError:
+        case QNetworkReply::TemporaryNetworkFailureError:
+        case QNetworkReply::NetworkSessionFailedError:
+        case QNetworkReply::ProxyTimeoutError:
+        case QNetworkReply::UnknownNetworkError:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void AIClient::failLeg(Request *request, Leg *leg, const QString &error, bool retryable, int retryAfterMs)
+{
+    const int id = request->id;
+    const bool shown = request->winner == leg;
+    closeLeg(*leg, false);
+    
+    // Text already on screen cannot be taken back by a retry
+    if (!shown) {
+        Leg &other = (leg == &request->primary) ? request->hedge : request->primary;
+        if (other.reply || other.decoding) {
+            return; // The other leg may still answer
+        }
+        if (retryable && request->attempt < MAX_RETRIES) {
+            scheduleRetry(request, retryAfterMs);
+            return;
+        }
+    }
+    
+    removeRequest(id);
+    failRequest(id, error);
+}
+
+void AIClient::scheduleRetry(Request *request, int minimumDelayMs)
+{
+    const int attempt = ++request->attempt;
+    closeLeg(request->primary, true);
+    closeLeg(request->hedge, true);
+    request->winner = nullptr;
+    
+    // Exponential backoff with "equal jitter": half fixed, half random, so
+    // requests that failed together do not come back together
+    int delay = qMin(RETRY_MAX_DELAY_MS, RETRY_BASE_DELAY_MS << (attempt - 1));
+    delay = delay / 2 + QRandomGenerator::global()->bounded(delay / 2 + 1);
+    delay = qMin(qMax(delay, minimumDelayMs), RETRY_MAX_DELAY_MS);
+    
+    setStatusMessage(QString("Connection problem, retrying in %1 s (%2/%3)...")
+                     .arg((delay + 999) / 1000).arg(attempt).arg(MAX_RETRIES));
+    
+    const int id = request->id;
+    QTimer::singleShot(delay, this, [this, id, attempt]() {
+        Request *request = m_requests.value(id);
+        if (!request || request->attempt != attempt) return; // Cancelled meanwhile
+        
+        // Retries go ahead of requests that have not been tried yet
+        m_queue.prepend(id);
+        schedule();
+    });
+}
+
+void AIClient::prewarm()
+{
+    if (!m_config || !m_network || !m_config->isConfigured()) return;
+    m_network->prewarm(endpointFor(m_config->currentProvider()));
 }
 
 void AIClient::testConnection()
@@ -154,10 +696,26 @@ void AIClient::testConnection()
     transform("test", "summarize");
 }
 
-void AIClient::sendOpenAIRequest(const QString &systemPrompt, const QString &userContent)
+QUrl AIClient::endpointFor(AIProvider provider) const
+{
+    switch (provider) {
+        case AIProvider::OpenAI:
+            return QUrl("https://api.openai.com/v1/chat/completions");
+        case AIProvider::Anthropic:
+            return QUrl("https://api.anthropic.com/v1/messages");
+        case AIProvider::Ollama: {
+            QString url = m_config->ollamaUrl();
+            if (!url.endsWith('/')) url += '/';
+            return QUrl(url + "api/chat");
+        }
+        default:
+            return QUrl();
+    }
+}
+
+QNetworkReply *AIClient::sendOpenAIRequest(const QString &systemPrompt, const QString &userContent)
 {
-    QNetworkRequest request;
-    request.setUrl(QUrl("https://api.openai.com/v1/chat/completions"));
+    QNetworkRequest request = m_network->request(endpointFor(AIProvider::OpenAI));
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
     request.setRawHeader("Authorization", 
         QString("Bearer %1").arg(m_config->apiKey(AIProvider::OpenAI)).toUtf8());
@@ -179,17 +737,21 @@ void AIClient::sendOpenAIRequest(const QString &systemPrompt, const QString &use
     body["messages"] = messages;
     body["max_tokens"] = 4096;
     body["temperature"] = 0.7;
+    body["stream"] = true;
+    // Ask for a final chunk carrying token usage
+    QJsonObject streamOptions;
+    streamOptions["include_usage"] = true;
+    body["stream_options"] = streamOptions;
     
     QJsonDocument doc(body);
     
     setStatusMessage("Waiting for OpenAI response...");
-    m_currentReply = m_networkManager->post(request, doc.toJson());
+    return m_network->post(request, doc.toJson());
 }
 
-void AIClient::sendAnthropicRequest(const QString &systemPrompt, const QString &userContent)
+QNetworkReply *AIClient::sendAnthropicRequest(const QString &systemPrompt, const QString &userContent)
 {
-    QNetworkRequest request;
-    request.setUrl(QUrl("https://api.anthropic.com/v1/messages"));
+    QNetworkRequest request = m_network->request(endpointFor(AIProvider::Anthropic));
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
     request.setRawHeader("x-api-key", m_config->apiKey(AIProvider::Anthropic).toUtf8());
     request.setRawHeader("anthropic-version", "2023-06-01");
@@ -206,19 +768,17 @@ void AIClient::sendAnthropicRequest(const QString &systemPrompt, const QString &
     body["system"] = systemPrompt;
     body["messages"] = messages;
     body["max_tokens"] = 4096;
+    body["stream"] = true;
     
     QJsonDocument doc(body);
     
     setStatusMessage("Waiting for Claude response...");
-    m_currentReply = m_networkManager->post(request, doc.toJson());
+    return m_network->post(request, doc.toJson());
 }
 
-void AIClient::sendOllamaRequest(const QString &systemPrompt, const QString &userContent)
+QNetworkReply *AIClient::sendOllamaRequest(const QString &systemPrompt, const QString &userContent)
 {
-    QNetworkRequest request;
-    QString url = m_config->ollamaUrl();
-    if (!url.endsWith('/')) url += '/';
-    request.setUrl(QUrl(url + "api/chat"));
+    QNetworkRequest request = m_network->request(endpointFor(AIProvider::Ollama));
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
     
     QJsonObject systemMessage;
@@ -236,25 +796,171 @@ void AIClient::sendOllamaRequest(const QString &systemPrompt, const QString &use
     QJsonObject body;
     body["model"] = m_config->ollamaModel();
     body["messages"] = messages;
-    body["stream"] = false;
+    body["stream"] = true;
     
     QJsonDocument doc(body);
     
     setStatusMessage("Waiting for Ollama response...");
-    m_currentReply = m_networkManager->post(request, doc.toJson());
+    return m_network->post(request, doc.toJson());
 }
 
-void AIClient::onRequestFinished(QNetworkReply *reply)
+void AIClient::onLegTimeout(int requestId, QNetworkReply *reply)
 {
-    if (reply != m_currentReply) {
-        reply->deleteLater();
-        return;
+    Request *request = m_requests.value(requestId);
+    if (!request) return;
+    Leg *leg = legFor(request, reply);
+    if (!leg) return;
+    
+    // abort() finishes the reply, which lands in onReplyFinished
+    leg->timedOut = true;
+    reply->abort();
+}
+
+void AIClient::onReadyRead(int requestId, QNetworkReply *reply)
+{
+    Request *request = m_requests.value(requestId);
+    if (!request) return;
+    Leg *leg = legFor(request, reply);
+    if (!leg) return;
+    
+    leg->timeout->start();
+
+    if (!leg->firstByte) {
+        leg->firstByte = true;
+        Metrics::instance().histogram(QString("ai.%1.ttfb_ms").arg(AIConfig::providerName(leg->provider)))
+            .record((Metrics::nowUs() - leg->startedUs) / 1000);
     }
+
+    // Error bodies are plain JSON; leave them for onReplyFinished
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status >= 400) return;
+
+    // A plain JSON body is left to be parsed as a whole when finished
+    if (!leg->streaming && !beginStream(*leg)) return;
+
+    for (const QByteArray &message : leg->parser.feed(reply->readAll())) {
+        handleStreamMessage(request, *leg, message);
+    }
+}
+
+bool AIClient::beginStream(Leg &leg)
+{
+    QString contentType = leg.reply->header(QNetworkRequest::ContentTypeHeader).toString();
+    if (contentType.contains("text/event-stream")) {
+        leg.parser.reset(StreamParser::ServerSentEvents);
+    } else if (contentType.contains("ndjson")) {
+        leg.parser.reset(StreamParser::NdJson);
+    } else {
+        return false;
+    }
+
+    leg.streaming = true;
+    setStatusMessage("Receiving response...");
+    return true;
+}
+
+void AIClient::handleStreamMessage(Request *request, Leg &leg, const QByteArray &message)
+{
+    // OpenAI ends with a literal [DONE], which is not JSON
+    QJsonDocument doc = QJsonDocument::fromJson(message);
+    if (!doc.isObject()) return;
+
+    QJsonObject root = doc.object();
+    QString delta;
+
+    switch (leg.provider) {
+        case AIProvider::OpenAI: {
+            if (root.contains("error")) {
+                leg.error = root["error"].toObject()["message"].toString();
+                return;
+            }
+            QJsonArray choices = root["choices"].toArray();
+            if (!choices.isEmpty()) {
+                delta = choices[0].toObject()["delta"].toObject()["content"].toString();
+            }
+            if (root["usage"].isObject()) {
+                leg.tokens = root["usage"].toObject()["total_tokens"].toInt();
+            }
+            break;
+        }
+        case AIProvider::Anthropic: {
+            QString type = root["type"].toString();
+            if (type == "content_block_delta") {
+                QJsonObject d = root["delta"].toObject();
+                if (d["type"].toString() == "text_delta") {
+                    delta = d["text"].toString();
+                }
+            } else if (type == "message_start") {
+                leg.tokens += root["message"].toObject()["usage"].toObject()["input_tokens"].toInt();
+            } else if (type == "message_delta") {
+                leg.tokens += root["usage"].toObject()["output_tokens"].toInt();
+            } else if (type == "error") {
+                leg.error = root["error"].toObject()["message"].toString();
+            }
+            break;
+        }
+        case AIProvider::Ollama: {
+            if (root.contains("error")) {
+                leg.error = root["error"].toString();
+                return;
+            }
+            delta = root["message"].toObject()["content"].toString();
+            if (root["done"].toBool()) {
+                leg.tokens = root["eval_count"].toInt();
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    if (delta.isEmpty()) return;
+
+    // The first leg to produce text wins; a hedge still in flight is dropped
+    if (!request->winner) {
+        Leg &other = (&leg == &request->primary) ? request->hedge : request->primary;
+        if (other.decoding) {
+            // The other leg already has its whole answer; this one is not needed
+            closeLeg(leg, true);
+            return;
+        }
+        request->winner = &leg;
+        closeLeg(other, true);
+    }
+
+    leg.content += delta;
+    emitChunk(request, delta);
+}
+
+AIResponse AIClient::streamedResponse(const Leg &leg) const
+{
+    AIResponse response;
+    response.isMermaid = false;
+    response.tokensUsed = leg.tokens;
+    response.content = leg.content;
+    response.success = leg.error.isEmpty() && !leg.content.isEmpty();
+
+    if (!leg.error.isEmpty()) {
+        response.error = leg.error;
+    } else if (leg.content.isEmpty()) {
+        response.error = "No response content";
+    }
+
+    return response;
+}
+
+void AIClient::onReplyFinished(int requestId, QNetworkReply *reply)
+{
+    Request *request = m_requests.value(requestId);
+    if (!request) return;
+    Leg *leg = legFor(request, reply);
+    if (!leg) return;
     
-    m_currentReply = nullptr;
+    leg->timeout->stop();
     
     if (reply->error() != QNetworkReply::NoError) {
         QString errorMsg = reply->errorString();
+        int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
         
         // Try to extract more specific error from response
         QByteArray data = reply->readAll();
@@ -271,54 +977,90 @@ void AIClient::onRequestFinished(QNetworkReply *reply)
             }
         }
         
-        setBusy(false);
-        setStatusMessage("");
-        emit transformError(errorMsg);
-        reply->deleteLater();
+        if (leg->timedOut) {
+            errorMsg = QString("No response from %1 within %2 seconds")
+                .arg(m_config->getProviderDisplayName(AIConfig::providerName(leg->provider)))
+                .arg(m_config->requestTimeout(leg->provider));
+        }
+        
+        // Rate limits may say when to come back
+        int retryAfterMs = 0;
+        if (status == 429 && reply->hasRawHeader("Retry-After")) {
+            retryAfterMs = reply->rawHeader("Retry-After").toInt() * 1000;
+        }
+        
+        bool retryable = leg->timedOut || status == 429 || status >= 500
+                         || isTransientError(reply->error());
+        failLeg(request, leg, errorMsg, retryable, retryAfterMs);
         return;
     }
     
     QByteArray data = reply->readAll();
-    reply->deleteLater();
     
     setStatusMessage("Processing response...");
     
-    AIResponse response;
+    const AIProvider provider = leg->provider;
+    std::function<AIResponse()> decode;
+    if (leg->streaming || beginStream(*leg)) {
+        // Whatever arrived after the last readyRead, then any unterminated tail
+        for (const QByteArray &message : leg->parser.feed(data)) {
+            handleStreamMessage(request, *leg, message);
+        }
+        for (const QByteArray &message : leg->parser.finish()) {
+            handleStreamMessage(request, *leg, message);
+        }
+        if (!leg->reply) return; // Lost to the other leg while draining
+        AIResponse response = streamedResponse(*leg);
+        decode = [response]() { return response; };
+    } else {
+        decode = [provider, data]() { return parseResponse(provider, data); };
+    }
+    
+    // The body is in hand; the leg counts as answering until it is decoded
+    const qint64 startedUs = leg->startedUs;
+    closeLeg(*leg, false);
+    leg->decoding = true;
     
-    switch (m_config->currentProvider()) {
+    decodeInBackground(request, decode, [this, leg, provider, startedUs](Request *request,
+                                                                       const AIResponse &response) {
+        leg->decoding = false;
+        if (request->winner && request->winner != leg) {
+            return; // The other leg's text is on screen; it answers
+        }
+        if (!response.success) {
+            failLeg(request, leg, response.error, false, 0);
+            return;
+        }
+        
+        if (request->cacheable) {
+            m_cache.store(cacheKeyFor(*request, provider), response.content.toUtf8());
+        }
+        Metrics::instance().histogram(QString("ai.%1.total_ms").arg(AIConfig::providerName(provider)))
+            .record((Metrics::nowUs() - startedUs) / 1000);
+        
+        removeRequest(response.requestId);
+        completeRequest(response);
+    });
+}
+
+AIResponse AIClient::parseResponse(AIProvider provider, const QByteArray &data)
+{
+    switch (provider) {
         case AIProvider::OpenAI:
-            response = parseOpenAIResponse(data);
-            break;
+            return parseOpenAIResponse(data);
         case AIProvider::Anthropic:
-            response = parseAnthropicResponse(data);
-            break;
+            return parseAnthropicResponse(data);
         case AIProvider::Ollama:
-            response = parseOllamaResponse(data);
-            break;
-        default:
+            return parseOllamaResponse(data);
+        default: {
+            AIResponse response;
             response.success = false;
+            response.isMermaid = false;
+            response.tokensUsed = 0;
             response.error = "Unknown provider";
-            break;
-    }
-    
-    // Check for Mermaid content
-    if (response.success && (m_expectsMermaid || containsMermaid(response.content))) {
-        response.isMermaid = true;
-        response.mermaidCode = extractMermaidCode(response.content);
-        if (response.mermaidCode.isEmpty() && m_expectsMermaid) {
-            // Try to use the whole content as Mermaid
-            response.mermaidCode = response.content.trimmed();
+            return response;
         }
     }
-    
-    setBusy(false);
-    setStatusMessage("");
-    
-    if (response.success) {
-        emit transformComplete(response);
-    } else {
-        emit transformError(response.error);
-    }
 }
 
 AIResponse AIClient::parseOpenAIResponse(const QByteArray &data)
@@ -442,7 +1184,7 @@ AIResponse AIClient::parseOllamaResponse(const QByteArray &data)
     return response;
 }
 
-bool AIClient::containsMermaid(const QString &content) const
+bool AIClient::containsMermaid(const QString &content)
 {
     return content.contains("```mermaid") ||
            content.contains("graph ") ||
@@ -451,7 +1193,19 @@ bool AIClient::containsMermaid(const QString &content) const
            content.contains("mindmap");
 }
 
-QString AIClient::extractMermaidCode(const QString &content) const
+void AIClient::detectMermaid(AIResponse &response, bool expectsMermaid)
+{
+    if (!expectsMermaid && !containsMermaid(response.content)) return;
+    
+    response.isMermaid = true;
+    response.mermaidCode = extractMermaidCode(response.content);
+    if (response.mermaidCode.isEmpty() && expectsMermaid) {
+        // Try to use the whole content as Mermaid
+        response.mermaidCode = response.content.trimmed();
+    }
+}
+
+QString AIClient::extractMermaidCode(const QString &content)
 {
     // Try to extract code from markdown code block
     QRegularExpression re("```mermaid\\s*([\\s\\S]*?)```");
@@ -12,15 +12,27 @@
 
 #include <QObject>
 #include <QString>
-#include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include <QUrl>
+#include <QHash>
+#include <QList>
+#include <QStringList>
+#include <QVector>
+#include <QThreadPool>
+#include <functional>
 
 #include "aiconfig.h"
+#include "streamparser.h"
+#include "diskcache.h"
+
+class NetworkSession;
+class QTimer;
 
 /**
  * @brief The AIResponse struct holds the result of an AI request.
  */
 struct AIResponse {
+    int requestId;        // As returned by AIClient::transform()
     bool success;
     QString content;
     QString error;
@@ -35,22 +47,69 @@ struct AIResponse {
  * This class provides async API calls to OpenAI, Anthropic, and local Ollama
  * instances. It handles request formatting, response parsing, and error handling
  * for each provider's specific API format.
+ *
+ * Every transform() gets a request id that tags all of its signals. Requests
+ * are queued and started in order, with at most
+ * AIConfig::maxConcurrentRequests() running per provider (one for a local
+ * Ollama, a few for the cloud APIs). Each request keeps its own reply,
+ * provider and parser state, so several can be in flight at once.
+ *
+ * Requests ask for a streamed response (SSE for OpenAI/Anthropic, NDJSON for
+ * Ollama). Text deltas are emitted through transformChunk() as they arrive;
+ * transformComplete() still carries the full response at the end. A server
+ * that answers with a plain JSON body is parsed the old way.
+ *
+ * Successful responses are cached on disk, keyed by a hash of the provider,
+ * model, system prompt and input text. Running the same template on the
+ * same text again is answered from the cache (also when offline) unless the
+ * template opts out with PromptTemplate::cacheable.
+ *
+ * All requests go through the shared NetworkSession; prewarm() lets the UI
+ * open the provider connection before the request is made.
+ *
+ * A request that times out (AIConfig::requestTimeout() without any data),
+ * hits a transient network error, or gets HTTP 429/5xx is retried up to
+ * MAX_RETRIES times with exponential backoff and jitter, as long as none of
+ * its text has been shown yet. With AIConfig::hedgeProvider() set, a request
+ * that has produced no text after AIConfig::hedgeDelay() is also sent to
+ * that provider; whichever exchange produces text first is kept and the
+ * other is aborted.
+ *
+ * Text longer than CHUNK_CHARS is split at paragraph and heading boundaries
+ * (see TextChunker) and each part becomes its own queued request, so the
+ * parts run in parallel within the provider limits. Templates with a
+ * PromptTemplate::reducePrompt then get one more request that combines
+ * the part results; for the others the results are joined in order and
+ * streamed out as soon as the parts before them are done. Either way the
+ * caller sees a single request id.
  */
 class AIClient : public QObject
 {
     Q_OBJECT
     Q_PROPERTY(bool busy READ isBusy NOTIFY busyChanged)
     Q_PROPERTY(QString statusMessage READ statusMessage NOTIFY statusMessageChanged)
+    Q_PROPERTY(int pendingRequests READ pendingRequests NOTIFY pendingRequestsChanged)
 
 public:
     explicit AIClient(QObject *parent = nullptr);
+    ~AIClient();
 
     // Configuration
     void setConfig(AIConfig *config);
+    void setCacheDirectory(const QString &path);
+    void setNetworkSession(NetworkSession *session);
 
     // State
     bool isBusy() const;
     QString statusMessage() const;
+    int pendingRequests() const;
+
+    // Parsers for a complete (not streamed) response body; they depend on
+    // nothing but the body
+    static AIResponse parseOpenAIResponse(const QByteArray &data);
+    static AIResponse parseAnthropicResponse(const QByteArray &data);
+    static AIResponse parseOllamaResponse(const QByteArray &data);
+    static AIResponse parseResponse(AIProvider provider, const QByteArray &data);
 
 public slots:
     /**
@@ -58,13 +117,25 @@ public slots:
      * @param text - The selected text to transform
      * @param promptTemplate - The prompt template ID or custom prompt
      * @param customPrompt - Custom prompt text (if promptTemplate is "custom")
+     * @return The request id, or -1 if the request was rejected (transformError
+     *         has then been emitted with id -1)
+     */
+    int transform(const QString &text, const QString &promptTemplate, const QString &customPrompt = QString());
+    
+    /**
+     * @brief cancel - Cancel a queued or running request, or all of them if requestId is -1
+     */
+    void cancel(int requestId = -1);
+    
+    /**
+     * @brief clearCache - Forget all cached responses
      */
-    void transform(const QString &text, const QString &promptTemplate, const QString &customPrompt = QString());
+    void clearCache();
     
     /**
-     * @brief cancel - Cancel any in-progress request
+     * @brief prewarm - Open a connection to the current provider ahead of a request
      */
-    void cancel();
+    void prewarm();
     
     /**
      * @brief testConnection - Test connection to current provider
@@ -72,29 +143,132 @@ public slots:
     void testConnection();
 
 signals:
+    void transformChunk(int requestId, const QString &chunk);
     void transformComplete(const AIResponse &response);
-    void transformError(const QString &error);
+    void transformError(int requestId, const QString &error);
     void busyChanged();
     void statusMessageChanged();
+    void pendingRequestsChanged();
     void connectionTestResult(bool success, const QString &message);
 
-private slots:
-    void onRequestFinished(QNetworkReply *reply);
-
 private:
+    /**
+     * One HTTP exchange with one provider. A hedged request has two.
+     */
+    struct Leg {
+        AIProvider provider;
+        QNetworkReply *reply;     // Null when not running
+        QTimer *timeout;          // Restarted whenever data arrives
+        bool timedOut;
+        bool decoding;            // Finished; its body is being parsed off the GUI thread
+        qint64 startedUs;         // For the latency metrics
+        bool firstByte;
+
+        // Streamed response state
+        StreamParser parser;
+        bool streaming;
+        QString content;
+        QString error;
+        int tokens;
+    };
+
+    struct Request {
+        int id;
+        AIProvider provider;      // The provider asked first
+        QString systemPrompt;
+        QString userContent;
+        bool expectsMermaid;
+        bool cacheable;
+        int attempt;              // Retries so far
+        Leg primary;
+        Leg hedge;
+        Leg *winner;              // The leg whose text is being shown, if any
+    };
+
+    /**
+     * A transform over text too long for one request, run as several
+     */
+    struct MapReduce {
+        int id;                   // The id the caller got
+        QString reducePrompt;     // Empty: part results are joined in order
+        bool expectsMermaid;
+        bool cacheable;
+        QList<int> parts;         // Part request ids, in document order
+        QStringList results;      // Text so far, per part
+        QVector<bool> done;
+        int completed;
+        int front;                // First part not yet fully streamed (join only)
+        int shownChars;           // How much of results[front] went out
+        int reduceRequest;        // -1 until all parts are in
+        int tokens;
+    };
+
+    // Request creation
+    Request *createRequest(const QString &text, const QString &systemPrompt,
+                           bool expectsMermaid, bool cacheable);
+    void submit(Request *request);
+
+    // Map-reduce over long text
+    int startMapReduce(const QStringList &chunks, const QString &systemPrompt,
+                       const QString &reducePrompt, bool expectsMermaid, bool cacheable);
+    void streamJoinedParts(MapReduce *job);
+    void finishMapReduce(MapReduce *job, const QString &content);
+    void removeMapReduce(int jobId);
+
+    // Results go out through these, which route parts to their job
+    void emitChunk(Request *request, const QString &delta);
+    void completeRequest(const AIResponse &response);
+    void failRequest(int requestId, const QString &error);
+
+    // Scheduling
+    bool schedule();
+    int runningCount(AIProvider provider) const;
+    void startRequest(Request *request);
+    void startHedge(int requestId, int attempt);
+    bool startLeg(Request *request, Leg &leg, AIProvider provider);
+    void closeLeg(Leg &leg, bool abort);
+    void resetLeg(Leg &leg);
+    Leg *legFor(Request *request, QNetworkReply *reply);
+    void removeRequest(int requestId);
+    void updateBusy();
+    void deliverCached(int requestId);
+    QByteArray cacheKeyFor(const Request &request, AIProvider provider) const;
+
+    // Failure handling
+    void failLeg(Request *request, Leg *leg, const QString &error, bool retryable, int retryAfterMs);
+    void scheduleRetry(Request *request, int minimumDelayMs);
+    static bool isTransientError(QNetworkReply::NetworkError error);
+
+    // Reply handling
+    void onReadyRead(int requestId, QNetworkReply *reply);
+    void onReplyFinished(int requestId, QNetworkReply *reply);
+    void onLegTimeout(int requestId, QNetworkReply *reply);
+
     // Provider-specific request handlers
-    void sendOpenAIRequest(const QString &systemPrompt, const QString &userContent);
-    void sendAnthropicRequest(const QString &systemPrompt, const QString &userContent);
-    void sendOllamaRequest(const QString &systemPrompt, const QString &userContent);
+    QUrl endpointFor(AIProvider provider) const;
+    QNetworkReply *sendOpenAIRequest(const QString &systemPrompt, const QString &userContent);
+    QNetworkReply *sendAnthropicRequest(const QString &systemPrompt, const QString &userContent);
+    QNetworkReply *sendOllamaRequest(const QString &systemPrompt, const QString &userContent);
     
-    // Response parsers
-    AIResponse parseOpenAIResponse(const QByteArray &data);
-    AIResponse parseAnthropicResponse(const QByteArray &data);
-    AIResponse parseOllamaResponse(const QByteArray &data);
+    // Streaming
+    bool beginStream(Leg &leg);
+    void handleStreamMessage(Request *request, Leg &leg, const QByteArray &message);
+    AIResponse streamedResponse(const Leg &leg) const;
+
+    /**
+     * @brief decodeInBackground - Finish a response off the GUI thread
+     *
+     * Runs decode() and the Mermaid detection on the decoder thread, then
+     * done() back on ours with the finished response, unless the request
+     * was cancelled meanwhile.
+     */
+    void decodeInBackground(Request *request, std::function<AIResponse()> decode,
+                            std::function<void(Request *, const AIResponse &)> done);
     
-    // Mermaid extraction
-    QString extractMermaidCode(const QString &content) const;
-    bool containsMermaid(const QString &content) const;
+    // Mermaid extraction; pure, so safe on the decoder thread
+    static QString extractMermaidCode(const QString &content);
+    static bool containsMermaid(const QString &content);
+    static void detectMermaid(AIResponse &response, bool expectsMermaid);
     
     // Prompt building
     QString buildSystemPrompt(const QString &templateId) const;
@@ -103,14 +277,28 @@ private:
     void setStatusMessage(const QString &message);
     
     AIConfig *m_config;
-    QNetworkAccessManager *m_networkManager;
-    QNetworkReply *m_currentReply;
+    NetworkSession *m_network;
+    DiskCache m_cache;
     bool m_busy;
     QString m_statusMessage;
-    bool m_expectsMermaid;
     
-    // Request context
-    QString m_currentTemplateId;
+    // Request bookkeeping
+    QHash<int, Request *> m_requests; // Queued and running
+    QList<int> m_queue;               // Waiting to start, oldest first
+    int m_nextRequestId;
+    QHash<int, MapReduce *> m_mapReduces;
+    QHash<int, int> m_partOf;         // Part or reduce request id -> job id
+    
+    // Parses finished responses; one thread, leaving the other core to input
+    QThreadPool m_decoder;
+    
+    // Retry policy
+    static const int MAX_RETRIES = 3;
+    static const int RETRY_BASE_DELAY_MS = 1000;
+    static const int RETRY_MAX_DELAY_MS = 30000;
+    
+    // Longer input is split into parts of at most this many characters
+    static const int CHUNK_CHARS = 6000;
 };
 
 #endif // AICLIENT_H
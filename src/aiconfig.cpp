@@ -9,9 +9,11 @@
 
 #include "aiconfig.h"
 #include <QFile>
+#include <QSaveFile>
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QDir>
+#include <QTimer>
 #include <QDebug>
 
 const QString AIConfig::DEFAULT_OLLAMA_URL = "http://localhost:11434";
@@ -26,8 +28,29 @@ AIConfig::AIConfig(QObject *parent)
     , m_ollamaModel(DEFAULT_OLLAMA_MODEL)
     , m_openaiModel(DEFAULT_OPENAI_MODEL)
     , m_anthropicModel(DEFAULT_ANTHROPIC_MODEL)
+    , m_openaiMaxRequests(DEFAULT_CLOUD_MAX_REQUESTS)
+    , m_anthropicMaxRequests(DEFAULT_CLOUD_MAX_REQUESTS)
+    , m_ollamaMaxRequests(DEFAULT_OLLAMA_MAX_REQUESTS)
+    , m_openaiTimeout(DEFAULT_CLOUD_TIMEOUT)
+    , m_anthropicTimeout(DEFAULT_CLOUD_TIMEOUT)
+    , m_ollamaTimeout(DEFAULT_OLLAMA_TIMEOUT)
+    , m_hedgeProvider(AIProvider::None)
+    , m_hedgeDelay(DEFAULT_HEDGE_DELAY)
+    , m_saveTimer(new QTimer(this))
 {
     initDefaultPrompts();
+
+    // Several settings applied together become one write
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(SAVE_DELAY_MS);
+    connect(m_saveTimer, &QTimer::timeout, this, &AIConfig::saveConfig);
+
+    m_writer.setMaxThreadCount(1);
+}
+
+AIConfig::~AIConfig()
+{
+    flush();
 }
 
 void AIConfig::initDefaultPrompts()
@@ -41,7 +64,9 @@ void AIConfig::initDefaultPrompts()
         "🔄",
         "Convert this text into a Mermaid flowchart diagram. Analyze the steps, decisions, and flow described and create a clear flowchart. Return ONLY the Mermaid code starting with ```mermaid and ending with ```. The diagram should be readable and well-organized.",
         "Convert text to Mermaid flowchart",
-        true
+        true,
+        true,
+        "These are Mermaid flowcharts of consecutive parts of one process, in order. Merge them into a single Mermaid flowchart of the whole process, connecting the parts in sequence and removing duplicate nodes. Return ONLY the Mermaid code starting with ```mermaid and ending with ```."
     });
     
     // Sequence diagram
@@ -51,7 +76,9 @@ void AIConfig::initDefaultPrompts()
         "📊",
         "Convert this text into a Mermaid sequence diagram. Identify the actors/participants and their interactions. Return ONLY the Mermaid code starting with ```mermaid and ending with ```. Focus on clear, chronological message flow.",
         "Convert interactions to sequence diagram",
-        true
+        true,
+        true,
+        "These are Mermaid sequence diagrams of consecutive parts of one interaction, in order. Merge them into a single Mermaid sequence diagram, keeping participant names consistent and the messages in chronological order. Return ONLY the Mermaid code starting with ```mermaid and ending with ```."
     });
     
     // Mind map
@@ -61,7 +88,9 @@ void AIConfig::initDefaultPrompts()
         "🧠",
         "Convert this text into a Mermaid mindmap diagram. Identify the central concept and related ideas. Return ONLY the Mermaid code starting with ```mermaid and ending with ```. Organize hierarchically.",
         "Convert ideas to mind map",
-        true
+        true,
+        true,
+        "These are Mermaid mindmaps of consecutive parts of one text. Merge them into a single Mermaid mindmap with one central concept, grouping related ideas and removing duplicates. Return ONLY the Mermaid code starting with ```mermaid and ending with ```."
     });
     
     // Summary
@@ -71,7 +100,9 @@ void AIConfig::initDefaultPrompts()
         "📝",
         "Provide a clear, concise summary of this text. Capture the key points and main ideas. Keep the summary to about 20-30% of the original length while preserving essential information.",
         "Create a concise summary",
-        false
+        false,
+        true,
+        "These are summaries of consecutive parts of one document, in order. Combine them into a single clear, concise summary of the whole document. Remove repetition and keep the key points and main ideas."
     });
     
     // Expand
@@ -141,7 +172,9 @@ void AIConfig::initDefaultPrompts()
         "☑️",
         "Extract all action items, tasks, and to-dos from this text. Format as a clear checklist with each item starting with '[ ]'. Include any deadlines or assignees mentioned.",
         "Extract actionable tasks",
-        false
+        false,
+        true,
+        "These are action item checklists from consecutive parts of one document. Merge them into a single checklist with each item starting with '[ ]', removing duplicates and keeping any deadlines or assignees."
     });
     
     // Questions
@@ -151,7 +184,9 @@ void AIConfig::initDefaultPrompts()
         "❓",
         "Generate thoughtful questions about this text that would help deepen understanding or spark discussion. Include a mix of clarifying, analytical, and open-ended questions.",
         "Generate discussion questions",
-        false
+        false,
+        false,  // A fresh set each time
+        "These are questions about consecutive parts of one text. Merge them into one list of thoughtful questions about the whole text, removing duplicates and keeping a mix of clarifying, analytical, and open-ended questions."
     });
     
     // Custom prompt placeholder
@@ -163,10 +198,31 @@ void AIConfig::initDefaultPrompts()
         "Enter your own instructions",
         false
     });
+
+    rebuildTemplates();
+}
+
+void AIConfig::rebuildTemplates()
+{
+    m_templates = m_promptTemplates;
+    m_templates.append(m_customPrompts);
+
+    m_templateIndex.clear();
+    m_templatesVariant.clear();
+    m_templateIndex.reserve(m_templates.size());
+    m_templatesVariant.reserve(m_templates.size());
+    for (int i = 0; i < m_templates.size(); ++i) {
+        // On a clash the built-in template wins, as it always has
+        if (!m_templateIndex.contains(m_templates[i].id)) {
+            m_templateIndex.insert(m_templates[i].id, i);
+        }
+        m_templatesVariant.append(m_templates[i].toVariantMap());
+    }
 }
 
 void AIConfig::setConfigDirectory(const QString &path)
 {
+    flush();
     m_configDirectory = path;
     loadConfig();
 }
@@ -188,7 +244,12 @@ AIProvider AIConfig::currentProvider() const
 
 QString AIConfig::currentProviderName() const
 {
-    switch (m_currentProvider) {
+    return providerName(m_currentProvider);
+}
+
+QString AIConfig::providerName(AIProvider provider)
+{
+    switch (provider) {
         case AIProvider::OpenAI: return "openai";
         case AIProvider::Anthropic: return "anthropic";
         case AIProvider::Ollama: return "ollama";
@@ -201,22 +262,26 @@ void AIConfig::setCurrentProvider(AIProvider provider)
     if (m_currentProvider != provider) {
         m_currentProvider = provider;
         emit configChanged();
-        saveConfig();
+        scheduleSave();
     }
 }
 
 void AIConfig::setCurrentProviderByName(const QString &name)
+{
+    setCurrentProvider(providerFromName(name));
+}
+
+AIProvider AIConfig::providerFromName(const QString &name)
 {
     QString lower = name.toLower();
     if (lower == "openai") {
-        setCurrentProvider(AIProvider::OpenAI);
+        return AIProvider::OpenAI;
     } else if (lower == "anthropic") {
-        setCurrentProvider(AIProvider::Anthropic);
+        return AIProvider::Anthropic;
     } else if (lower == "ollama") {
-        setCurrentProvider(AIProvider::Ollama);
-    } else {
-        setCurrentProvider(AIProvider::None);
+        return AIProvider::Ollama;
     }
+    return AIProvider::None;
 }
 
 QString AIConfig::apiKey(AIProvider provider) const
@@ -235,14 +300,14 @@ void AIConfig::setApiKey(AIProvider provider, const QString &key)
             if (m_openaiKey != key) {
                 m_openaiKey = key;
                 emit configChanged();
-                saveConfig();
+                scheduleSave();
             }
             break;
         case AIProvider::Anthropic:
             if (m_anthropicKey != key) {
                 m_anthropicKey = key;
                 emit configChanged();
-                saveConfig();
+                scheduleSave();
             }
             break;
         default:
@@ -270,7 +335,7 @@ void AIConfig::setOllamaUrl(const QString &url)
     if (m_ollamaUrl != url) {
         m_ollamaUrl = url;
         emit configChanged();
-        saveConfig();
+        scheduleSave();
     }
 }
 
@@ -284,7 +349,7 @@ void AIConfig::setOllamaModel(const QString &model)
     if (m_ollamaModel != model) {
         m_ollamaModel = model;
         emit configChanged();
-        saveConfig();
+        scheduleSave();
     }
 }
 
@@ -298,7 +363,7 @@ void AIConfig::setOpenaiModel(const QString &model)
     if (m_openaiModel != model) {
         m_openaiModel = model;
         emit configChanged();
-        saveConfig();
+        scheduleSave();
     }
 }
 
@@ -312,13 +377,135 @@ void AIConfig::setAnthropicModel(const QString &model)
     if (m_anthropicModel != model) {
         m_anthropicModel = model;
         emit configChanged();
-        saveConfig();
+        scheduleSave();
+    }
+}
+
+QString AIConfig::model(AIProvider provider) const
+{
+    switch (provider) {
+        case AIProvider::OpenAI: return m_openaiModel;
+        case AIProvider::Anthropic: return m_anthropicModel;
+        case AIProvider::Ollama: return m_ollamaModel;
+        default: return QString();
+    }
+}
+
+int AIConfig::maxConcurrentRequests(AIProvider provider) const
+{
+    switch (provider) {
+        case AIProvider::OpenAI:
+            return m_openaiMaxRequests;
+        case AIProvider::Anthropic:
+            return m_anthropicMaxRequests;
+        case AIProvider::Ollama:
+            return m_ollamaMaxRequests;
+        default:
+            return 1;
+    }
+}
+
+void AIConfig::setMaxConcurrentRequests(AIProvider provider, int count)
+{
+    count = qMax(1, count);
+    int *target = nullptr;
+    switch (provider) {
+        case AIProvider::OpenAI:
+            target = &m_openaiMaxRequests;
+            break;
+        case AIProvider::Anthropic:
+            target = &m_anthropicMaxRequests;
+            break;
+        case AIProvider::Ollama:
+            target = &m_ollamaMaxRequests;
+            break;
+        default:
+            return;
+    }
+
+    if (*target != count) {
+        *target = count;
+        emit configChanged();
+        scheduleSave();
+    }
+}
+
+int AIConfig::requestTimeout(AIProvider provider) const
+{
+    switch (provider) {
+        case AIProvider::OpenAI:
+            return m_openaiTimeout;
+        case AIProvider::Anthropic:
+            return m_anthropicTimeout;
+        case AIProvider::Ollama:
+            return m_ollamaTimeout;
+        default:
+            return DEFAULT_CLOUD_TIMEOUT;
+    }
+}
+
+void AIConfig::setRequestTimeout(AIProvider provider, int seconds)
+{
+    seconds = qMax(1, seconds);
+    int *target = nullptr;
+    switch (provider) {
+        case AIProvider::OpenAI:
+            target = &m_openaiTimeout;
+            break;
+        case AIProvider::Anthropic:
+            target = &m_anthropicTimeout;
+            break;
+        case AIProvider::Ollama:
+            target = &m_ollamaTimeout;
+            break;
+        default:
+            return;
+    }
+
+    if (*target != seconds) {
+        *target = seconds;
+        emit configChanged();
+        scheduleSave();
+    }
+}
+
+AIProvider AIConfig::hedgeProvider() const
+{
+    return m_hedgeProvider;
+}
+
+void AIConfig::setHedgeProvider(AIProvider provider)
+{
+    if (m_hedgeProvider != provider) {
+        m_hedgeProvider = provider;
+        emit configChanged();
+        scheduleSave();
+    }
+}
+
+int AIConfig::hedgeDelay() const
+{
+    return m_hedgeDelay;
+}
+
+void AIConfig::setHedgeDelay(int msecs)
+{
+    msecs = qMax(0, msecs);
+    if (m_hedgeDelay != msecs) {
+        m_hedgeDelay = msecs;
+        emit configChanged();
+        scheduleSave();
     }
 }
 
 bool AIConfig::isConfigured() const
 {
-    switch (m_currentProvider) {
+    return isProviderConfigured(m_currentProvider);
+}
+
+bool AIConfig::isProviderConfigured(AIProvider provider) const
+{
+    switch (provider) {
         case AIProvider::OpenAI:
             return !m_openaiKey.isEmpty();
         case AIProvider::Anthropic:
@@ -335,27 +522,28 @@ bool AIConfig::hasApiKey(AIProvider provider) const
     return !apiKey(provider).isEmpty();
 }
 
-QList<PromptTemplate> AIConfig::promptTemplates() const
+const QList<PromptTemplate> &AIConfig::promptTemplates() const
 {
-    QList<PromptTemplate> all = m_promptTemplates;
-    all.append(m_customPrompts);
-    return all;
+    return m_templates;
 }
 
 QVariantList AIConfig::promptTemplatesVariant() const
 {
-    QVariantList list;
-    for (const auto &pt : promptTemplates()) {
-        list.append(pt.toVariantMap());
-    }
-    return list;
+    return m_templatesVariant;
+}
+
+const PromptTemplate *AIConfig::promptTemplate(const QString &id) const
+{
+    auto it = m_templateIndex.constFind(id);
+    return it != m_templateIndex.constEnd() ? &m_templates.at(it.value()) : nullptr;
 }
 
 void AIConfig::addCustomPrompt(const PromptTemplate &prompt)
 {
     m_customPrompts.append(prompt);
+    rebuildTemplates();
     emit configChanged();
-    saveConfig();
+    scheduleSave();
 }
 
 void AIConfig::removeCustomPrompt(const QString &id)
@@ -363,8 +551,9 @@ void AIConfig::removeCustomPrompt(const QString &id)
     for (int i = 0; i < m_customPrompts.size(); ++i) {
         if (m_customPrompts[i].id == id) {
             m_customPrompts.removeAt(i);
+            rebuildTemplates();
             emit configChanged();
-            saveConfig();
+            scheduleSave();
             return;
         }
     }
@@ -424,6 +613,22 @@ bool AIConfig::loadConfig()
     m_openaiModel = root["openaiModel"].toString(DEFAULT_OPENAI_MODEL);
     m_anthropicModel = root["anthropicModel"].toString(DEFAULT_ANTHROPIC_MODEL);
     
+    // Load concurrency limits
+    QJsonObject maxRequests = root["maxConcurrentRequests"].toObject();
+    m_openaiMaxRequests = qMax(1, maxRequests["openai"].toInt(DEFAULT_CLOUD_MAX_REQUESTS));
+    m_anthropicMaxRequests = qMax(1, maxRequests["anthropic"].toInt(DEFAULT_CLOUD_MAX_REQUESTS));
+    m_ollamaMaxRequests = qMax(1, maxRequests["ollama"].toInt(DEFAULT_OLLAMA_MAX_REQUESTS));
+    
+    // Load timeouts and hedging
+    QJsonObject timeouts = root["requestTimeouts"].toObject();
+    m_openaiTimeout = qMax(1, timeouts["openai"].toInt(DEFAULT_CLOUD_TIMEOUT));
+    m_anthropicTimeout = qMax(1, timeouts["anthropic"].toInt(DEFAULT_CLOUD_TIMEOUT));
+    m_ollamaTimeout = qMax(1, timeouts["ollama"].toInt(DEFAULT_OLLAMA_TIMEOUT));
+    
+    QJsonObject hedging = root["hedging"].toObject();
+    m_hedgeProvider = providerFromName(hedging["provider"].toString());
+    m_hedgeDelay = qMax(0, hedging["delayMs"].toInt(DEFAULT_HEDGE_DELAY));
+    
     // Load custom prompts
     m_customPrompts.clear();
     QJsonArray customPrompts = root["customPrompts"].toArray();
@@ -436,9 +641,15 @@ bool AIConfig::loadConfig()
         pt.prompt = obj["prompt"].toString();
         pt.description = obj["description"].toString();
         pt.expectsMermaid = obj["expectsMermaid"].toBool();
+        pt.cacheable = obj["cacheable"].toBool(true);
+        pt.reducePrompt = obj["reducePrompt"].toString();
         m_customPrompts.append(pt);
     }
+    rebuildTemplates();
     
+    // What was just read needs no writing back
+    m_saveTimer->stop();
+
     emit configLoaded();
     emit configChanged();
     return true;
@@ -446,6 +657,7 @@ bool AIConfig::loadConfig()
 
 bool AIConfig::saveConfig()
 {
+    m_saveTimer->stop();
     if (m_configDirectory.isEmpty()) {
         return false;
     }
@@ -465,6 +677,23 @@ bool AIConfig::saveConfig()
     root["openaiModel"] = m_openaiModel;
     root["anthropicModel"] = m_anthropicModel;
     
+    QJsonObject maxRequests;
+    maxRequests["openai"] = m_openaiMaxRequests;
+    maxRequests["anthropic"] = m_anthropicMaxRequests;
+    maxRequests["ollama"] = m_ollamaMaxRequests;
+    root["maxConcurrentRequests"] = maxRequests;
+    
+    QJsonObject timeouts;
+    timeouts["openai"] = m_openaiTimeout;
+    timeouts["anthropic"] = m_anthropicTimeout;
+    timeouts["ollama"] = m_ollamaTimeout;
+    root["requestTimeouts"] = timeouts;
+    
+    QJsonObject hedging;
+    hedging["provider"] = providerName(m_hedgeProvider);
+    hedging["delayMs"] = m_hedgeDelay;
+    root["hedging"] = hedging;
+    
     // Save custom prompts
     QJsonArray customPrompts;
     for (const auto &pt : m_customPrompts) {
@@ -475,23 +704,44 @@ bool AIConfig::saveConfig()
         obj["prompt"] = pt.prompt;
         obj["description"] = pt.description;
         obj["expectsMermaid"] = pt.expectsMermaid;
+        obj["cacheable"] = pt.cacheable;
+        obj["reducePrompt"] = pt.reducePrompt;
         customPrompts.append(obj);
     }
     root["customPrompts"] = customPrompts;
     
-    QJsonDocument doc(root);
-    
-    QString path = configFilePath();
-    QFile file(path);
-    
-    if (!file.open(QIODevice::WriteOnly)) {
-        emit errorOccurred(tr("Could not save AI config file"));
-        return false;
-    }
-    
-    file.write(doc.toJson(QJsonDocument::Indented));
-    file.close();
-    
-    emit configSaved();
+    // Encode and write off the GUI thread; root is a snapshot
+    const QString path = configFilePath();
+    m_writer.start([this, root, path]() {
+        QSaveFile file(path);
+        bool saved = file.open(QIODevice::WriteOnly)
+            && file.write(QJsonDocument(root).toJson(QJsonDocument::Indented)) >= 0
+            && file.commit();
+
+        QMetaObject::invokeMethod(this, [this, saved]() {
+            if (saved) {
+                emit configSaved();
+            } else {
+                emit errorOccurred(tr("Could not save AI config file"));
+            }
+        }, Qt::QueuedConnection);
+    });
+
     return true;
 }
+
+void AIConfig::flush()
+{
+    if (m_saveTimer->isActive()) {
+        m_saveTimer->stop();
+        saveConfig();
+    }
+    m_writer.waitForDone();
+}
+
+void AIConfig::scheduleSave()
+{
+    if (!m_saveTimer->isActive()) {
+        m_saveTimer->start();
+    }
+}
@@ -14,7 +14,11 @@
 #include <QString>
 #include <QStringList>
 #include <QVariantMap>
+#include <QHash>
 #include <QJsonObject>
+#include <QThreadPool>
+
+class QTimer;
 
 /**
  * @brief The AIProvider enum represents supported AI backends.
@@ -36,6 +40,9 @@ struct PromptTemplate {
     QString prompt;
     QString description;
     bool expectsMermaid;
+    bool cacheable = true;  // Repeat runs on the same text reuse the stored answer
+    QString reducePrompt;   // Combines the results for long text split into parts;
+                            // empty means the part results are simply joined
     
     QVariantMap toVariantMap() const {
         return {
@@ -44,7 +51,8 @@ struct PromptTemplate {
             {"icon", icon},
             {"prompt", prompt},
             {"description", description},
-            {"expectsMermaid", expectsMermaid}
+            {"expectsMermaid", expectsMermaid},
+            {"cacheable", cacheable}
         };
     }
 };
@@ -55,6 +63,16 @@ struct PromptTemplate {
  * This class handles loading and saving AI configuration including API keys,
  * provider selection, and prompt templates. Configuration is stored in a
  * JSON file in the user's ghostwriter directory.
+ *
+ * The built-in and custom templates form one registry, hashed by ID and
+ * rebuilt only when the templates change, together with the QVariantList
+ * QML reads. Looking a template up for a transform therefore copies nothing.
+ *
+ * Setters do not write the file themselves. They mark the configuration
+ * dirty, and changes arriving within a short window are saved together. The
+ * JSON is encoded and written atomically on a background thread, one save
+ * at a time. flush() writes pending changes at once and waits for them; the
+ * destructor calls it.
  */
 class AIConfig : public QObject
 {
@@ -69,6 +87,7 @@ class AIConfig : public QObject
 
 public:
     explicit AIConfig(QObject *parent = nullptr);
+    ~AIConfig();
 
     // Configuration path
     void setConfigDirectory(const QString &path);
@@ -79,6 +98,8 @@ public:
     QString currentProviderName() const;
     void setCurrentProvider(AIProvider provider);
     void setCurrentProviderByName(const QString &name);
+    static QString providerName(AIProvider provider);
+    static AIProvider providerFromName(const QString &name);
 
     // API Keys (stored securely)
     QString apiKey(AIProvider provider) const;
@@ -97,20 +118,58 @@ public:
     QString anthropicModel() const;
     void setAnthropicModel(const QString &model);
 
+    // Model used for a provider
+    QString model(AIProvider provider) const;
+
+    // How many requests may run at once against a provider
+    int maxConcurrentRequests(AIProvider provider) const;
+    void setMaxConcurrentRequests(AIProvider provider, int count);
+
+    // A request is retried after this many seconds without data from the provider
+    int requestTimeout(AIProvider provider) const;
+    void setRequestTimeout(AIProvider provider, int seconds);
+
+    // Hedging: if the provider has not answered after hedgeDelay() ms, the
+    // request is also sent to hedgeProvider() (None disables hedging)
+    AIProvider hedgeProvider() const;
+    void setHedgeProvider(AIProvider provider);
+    int hedgeDelay() const;
+    void setHedgeDelay(int msecs);
+
     // Configuration status
     bool isConfigured() const;
+    bool isProviderConfigured(AIProvider provider) const;
     bool hasApiKey(AIProvider provider) const;
 
     // Prompt templates
-    QList<PromptTemplate> promptTemplates() const;
+    const QList<PromptTemplate> &promptTemplates() const;
     QVariantList promptTemplatesVariant() const;
+
+    /**
+     * @brief promptTemplate - The template with the given ID, or nullptr
+     *
+     * The pointer stays valid until the templates next change.
+     */
+    const PromptTemplate *promptTemplate(const QString &id) const;
     void addCustomPrompt(const PromptTemplate &prompt);
     void removeCustomPrompt(const QString &id);
 
     // Persistence
     bool loadConfig();
+
+    /**
+     * @brief saveConfig - Queue a write of the current configuration
+     *
+     * Returns false if there is no config directory. The write completes in
+     * the background; configSaved() or errorOccurred() follows.
+     */
     bool saveConfig();
 
+    /**
+     * @brief flush - Save pending changes now and wait until they are on disk
+     */
+    void flush();
+
 public slots:
     void setOpenAIKey(const QString &key);
     void setAnthropicKey(const QString &key);
@@ -125,7 +184,9 @@ signals:
 
 private:
     void initDefaultPrompts();
+    void rebuildTemplates();
     QString configFilePath() const;
+    void scheduleSave();
     
     QString m_configDirectory;
     AIProvider m_currentProvider;
@@ -139,16 +200,39 @@ private:
     QString m_ollamaModel;
     QString m_openaiModel;
     QString m_anthropicModel;
+    int m_openaiMaxRequests;
+    int m_anthropicMaxRequests;
+    int m_ollamaMaxRequests;
+    int m_openaiTimeout;
+    int m_anthropicTimeout;
+    int m_ollamaTimeout;
+    AIProvider m_hedgeProvider;
+    int m_hedgeDelay;
     
     // Prompt templates
     QList<PromptTemplate> m_promptTemplates;
     QList<PromptTemplate> m_customPrompts;
+
+    // Registry: built-in then custom templates, by ID, and as QML sees them
+    QList<PromptTemplate> m_templates;
+    QHash<QString, int> m_templateIndex;
+    QVariantList m_templatesVariant;
+
+    // Write-behind persistence
+    QTimer *m_saveTimer;
+    QThreadPool m_writer;           // One thread, so saves land in order
     
     // Defaults
     static const QString DEFAULT_OLLAMA_URL;
     static const QString DEFAULT_OLLAMA_MODEL;
     static const QString DEFAULT_OPENAI_MODEL;
     static const QString DEFAULT_ANTHROPIC_MODEL;
+    static const int DEFAULT_CLOUD_MAX_REQUESTS = 4;
+    static const int DEFAULT_OLLAMA_MAX_REQUESTS = 1;
+    static const int DEFAULT_CLOUD_TIMEOUT = 30;   // seconds
+    static const int DEFAULT_OLLAMA_TIMEOUT = 120; // local models can be slow to start
+    static const int DEFAULT_HEDGE_DELAY = 8000;   // msecs
+    static const int SAVE_DELAY_MS = 500;
 };
 
 #endif // AICONFIG_H
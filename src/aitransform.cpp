@@ -9,22 +9,69 @@
 
 #include "aitransform.h"
 #include "editor.h"
+#include "networksession.h"
 #include <QDebug>
+#include <QTimer>
+
+namespace {
+
+// Where a range boundary ends up after an edit. Text inserted exactly at
+// the boundary stays outside the range.
+int adjustedPosition(int pos, bool isEnd, int position, int charsRemoved, int charsAdded)
+{
+    if (pos < position || (isEnd && pos == position)) {
+        return pos;
+    }
+    if (pos >= position + charsRemoved) {
+        return pos + charsAdded - charsRemoved;
+    }
+    // Inside the removed text
+    return isEnd ? position + charsAdded : position;
+}
+
+} // namespace
 
 AITransform::AITransform(QObject *parent)
     : QObject(parent)
     , m_editor(nullptr)
+    , m_network(nullptr)
     , m_config(new AIConfig(this))
-    , m_client(new AIClient(this))
-    , m_renderer(new MermaidRenderer(this))
+    , m_client(nullptr)
+    , m_renderer(nullptr)
     , m_selectionStart(-1)
     , m_selectionEnd(-1)
-    , m_lastResultIsMermaid(false)
-    , m_busy(false)
+    , m_partialPending(false)
+    , m_streamRefreshTimer(new QTimer(this))
 {
+    // Streamed text that arrived since the last refresh goes out on timeout
+    m_streamRefreshTimer->setSingleShot(true);
+    m_streamRefreshTimer->setInterval(STREAM_REFRESH_MS);
+    connect(m_streamRefreshTimer, &QTimer::timeout, this, [this]() {
+        if (m_partialPending) {
+            publishPartialResult();
+        }
+    });
+
+    // Config changes
+    connect(m_config, &AIConfig::configChanged,
+            this, &AITransform::configChanged);
+}
+
+void AITransform::ensureStarted()
+{
+    if (m_client) return;
+
+    m_network = new NetworkSession(this);
+    m_client = new AIClient(this);
+    m_renderer = new MermaidRenderer(this);
+
     // Wire up client
     m_client->setConfig(m_config);
-    
+    m_client->setNetworkSession(m_network);
+    m_renderer->setNetworkSession(m_network);
+
+    connect(m_client, &AIClient::transformChunk,
+            this, &AITransform::onTransformChunk);
     connect(m_client, &AIClient::transformComplete,
             this, &AITransform::onTransformComplete);
     connect(m_client, &AIClient::transformError,
@@ -34,32 +81,46 @@ AITransform::AITransform(QObject *parent)
     connect(m_client, &AIClient::statusMessageChanged, this, [this]() {
         setStatusMessage(m_client->statusMessage());
     });
-    
+
     // Wire up renderer
     connect(m_renderer, &MermaidRenderer::renderComplete,
             this, &AITransform::onRenderComplete);
     connect(m_renderer, &MermaidRenderer::renderError,
             this, &AITransform::onRenderError);
-    
-    // Config changes
-    connect(m_config, &AIConfig::configChanged,
-            this, &AITransform::configChanged);
+    connect(m_renderer, &MermaidRenderer::renderingChanged,
+            this, &AITransform::busyChanged);
+
+    if (!m_configDirectory.isEmpty()) {
+        m_renderer->setCacheDirectory(m_configDirectory);
+        m_client->setCacheDirectory(m_configDirectory);
+    }
 }
 
 void AITransform::setEditor(Editor *editor)
 {
+    if (m_editor) {
+        disconnect(m_editor, nullptr, this, nullptr);
+    }
     m_editor = editor;
+    if (m_editor) {
+        connect(m_editor, &Editor::contentsChange,
+                this, &AITransform::onContentsChange);
+    }
 }
 
 void AITransform::setConfigDirectory(const QString &path)
 {
+    m_configDirectory = path;
     m_config->setConfigDirectory(path);
-    m_renderer->setCacheDirectory(path);
+    if (m_client) {
+        m_renderer->setCacheDirectory(path);
+        m_client->setCacheDirectory(path);
+    }
 }
 
 bool AITransform::isBusy() const
 {
-    return m_client->isBusy() || m_renderer->isRendering();
+    return m_client && (m_client->isBusy() || m_renderer->isRendering());
 }
 
 bool AITransform::hasSelection() const
@@ -89,17 +150,31 @@ QVariantList AITransform::promptTemplates() const
 
 QString AITransform::lastResult() const
 {
-    return m_lastResult;
+    const Job *job = shownJob();
+    return job ? job->result : QString();
 }
 
 bool AITransform::lastResultIsMermaid() const
 {
-    return m_lastResultIsMermaid;
+    const Job *job = shownJob();
+    return job && job->isMermaid;
 }
 
 QString AITransform::lastMermaidImagePath() const
 {
-    return m_lastMermaidImagePath;
+    const Job *job = shownJob();
+    return job ? job->mermaidImagePath : QString();
+}
+
+bool AITransform::isResultReady() const
+{
+    const Job *job = shownJob();
+    return job && job->state == Job::Ready;
+}
+
+int AITransform::queuedResults() const
+{
+    return qMax(0, m_jobOrder.size() - 1);
 }
 
 void AITransform::setStatusMessage(const QString &message)
@@ -113,20 +188,21 @@ void AITransform::setStatusMessage(const QString &message)
 void AITransform::setSelection(int start, int end)
 {
     if (!m_editor) return;
-    
+    ensureStarted();
+
     // Validate bounds
-    QString content = m_editor->content();
-    start = qBound(0, start, content.length());
-    end = qBound(0, end, content.length());
-    
+    int length = m_editor->length();
+    start = qBound(0, start, length);
+    end = qBound(0, end, length);
+
     if (start > end) {
         qSwap(start, end);
     }
-    
+
     m_selectionStart = start;
     m_selectionEnd = end;
-    m_selectedText = content.mid(start, end - start);
-    
+    m_selectedText = m_editor->textRange(start, end - start);
+
     emit selectionChanged();
 }
 
@@ -144,77 +220,263 @@ void AITransform::transform(const QString &promptTemplateId, const QString &cust
         emit showError("No text selected");
         return;
     }
-    
+
     if (!isConfigured()) {
         emit showSettings();
         return;
     }
-    
+
     // Hide palette and start transform
     emit hidePromptPalette();
-    
-    m_client->transform(m_selectedText, promptTemplateId, customPrompt);
+
+    ensureStarted();
+    int requestId = m_client->transform(m_selectedText, promptTemplateId, customPrompt);
+    if (requestId < 0) return; // Rejected; transformError says why
+
+    // Diagram templates will need the render server once the answer is in
+    const PromptTemplate *pt = m_config->promptTemplate(promptTemplateId);
+    if (pt && pt->expectsMermaid) {
+        m_renderer->prewarm();
+    }
+
+    Job job;
+    job.state = Job::Running;
+    job.start = m_selectionStart;
+    job.end = m_selectionEnd;
+    job.isMermaid = false;
+    job.renderId = -1;
+    m_jobs.insert(requestId, job);
+    m_jobOrder.append(requestId);
+
+    emit resultChanged();
+}
+
+void AITransform::prewarm()
+{
+    ensureStarted();
+    m_client->prewarm();
 }
 
 void AITransform::cancel()
 {
-    m_client->cancel();
-    m_renderer->cancel();
+    if (m_client) {
+        m_client->cancel();
+        m_renderer->cancel();
+    }
+
+    m_jobs.clear();
+    m_jobOrder.clear();
+    m_renderJobs.clear();
+    stopPartialUpdates();
+
     setStatusMessage("");
+    presentShownJob();
 }
 
-void AITransform::onTransformComplete(const AIResponse &response)
+AITransform::Job *AITransform::shownJob()
+{
+    if (m_jobOrder.isEmpty()) return nullptr;
+    auto it = m_jobs.find(m_jobOrder.first());
+    return it != m_jobs.end() ? &it.value() : nullptr;
+}
+
+const AITransform::Job *AITransform::shownJob() const
+{
+    if (m_jobOrder.isEmpty()) return nullptr;
+    auto it = m_jobs.constFind(m_jobOrder.first());
+    return it != m_jobs.constEnd() ? &it.value() : nullptr;
+}
+
+void AITransform::presentShownJob()
 {
-    m_lastResult = response.content;
-    m_lastResultIsMermaid = response.isMermaid;
-    m_lastMermaidCode = response.mermaidCode;
-    m_lastMermaidImagePath.clear();
-    
     emit resultChanged();
-    
+
+    const Job *job = shownJob();
+    if (job && job->state == Job::Ready) {
+        emit showResult(job->result, job->isMermaid, job->mermaidImagePath);
+    } else if (job && !job->result.isEmpty()) {
+        publishPartialResult();
+    } else {
+        emit hideResult();
+    }
+}
+
+void AITransform::removeJob(int requestId)
+{
+    if (!m_jobs.contains(requestId)) return;
+
+    if (!m_jobOrder.isEmpty() && m_jobOrder.first() == requestId) {
+        stopPartialUpdates();
+    }
+
+    // Does nothing if the request already finished
+    m_client->cancel(requestId);
+
+    const Job &job = m_jobs.value(requestId);
+    if (job.state == Job::Rendering && job.renderId >= 0) {
+        // Other jobs may still be waiting for the same diagram
+        m_renderer->cancel(job.renderId);
+        m_renderJobs.remove(job.renderId);
+    }
+
+    m_jobs.remove(requestId);
+    m_jobOrder.removeAll(requestId);
+}
+
+void AITransform::finishShownJob()
+{
+    if (m_jobOrder.isEmpty()) return;
+    removeJob(m_jobOrder.first());
+    presentShownJob();
+}
+
+void AITransform::markReady(int requestId)
+{
+    auto it = m_jobs.find(requestId);
+    if (it == m_jobs.end()) return;
+
+    it->state = Job::Ready;
+    if (m_jobOrder.first() == requestId) {
+        presentShownJob();
+    } else {
+        emit resultChanged();
+    }
+    emit transformComplete();
+}
+
+void AITransform::onTransformChunk(int requestId, const QString &chunk)
+{
+    auto it = m_jobs.find(requestId);
+    if (it == m_jobs.end()) return;
+
+    it->result += chunk;
+
+    // Only the result on screen is redrawn; others just accumulate
+    if (m_jobOrder.first() != requestId) return;
+
+    // First token goes out immediately, later ones once per refresh interval
+    if (m_streamRefreshTimer->isActive()) {
+        m_partialPending = true;
+    } else {
+        publishPartialResult();
+    }
+}
+
+void AITransform::publishPartialResult()
+{
+    const Job *job = shownJob();
+    if (!job) return;
+
+    m_partialPending = false;
+    emit showPartialResult(job->result);
+    m_streamRefreshTimer->start();
+}
+
+void AITransform::stopPartialUpdates()
+{
+    m_streamRefreshTimer->stop();
+    m_partialPending = false;
+}
+
+void AITransform::onTransformComplete(const AIResponse &response)
+{
+    auto it = m_jobs.find(response.requestId);
+    if (it == m_jobs.end()) return; // Discarded meanwhile
+
+    if (m_jobOrder.first() == response.requestId) {
+        stopPartialUpdates();
+    }
+
+    it->result = response.content;
+    it->isMermaid = response.isMermaid;
+    it->mermaidCode = response.mermaidCode;
+    it->mermaidImagePath.clear();
+
     if (response.isMermaid && !response.mermaidCode.isEmpty()) {
         // Render the Mermaid diagram
-        setStatusMessage("Rendering diagram...");
-        m_renderer->render(response.mermaidCode, "svg");
+        int renderId = m_renderer->render(response.mermaidCode, "svg");
+        if (renderId >= 0) {
+            it->state = Job::Rendering;
+            it->renderId = renderId;
+            m_renderJobs.insert(renderId, response.requestId);
+            setStatusMessage("Rendering diagram...");
+        } else {
+            it->result = m_renderer->renderToText(response.mermaidCode);
+            it->isMermaid = false;
+            markReady(response.requestId);
+        }
     } else {
-        // Show text result directly
-        emit showResult(m_lastResult, false, QString());
-        emit transformComplete();
+        // Text result is final as it is
+        markReady(response.requestId);
     }
 }
 
-void AITransform::onTransformError(const QString &error)
+void AITransform::onTransformError(int requestId, const QString &error)
 {
+    if (m_jobs.contains(requestId)) {
+        bool wasShown = m_jobOrder.first() == requestId;
+        removeJob(requestId);
+        if (wasShown) {
+            presentShownJob();
+        } else {
+            emit resultChanged();
+        }
+    }
+
     setStatusMessage("");
     emit showError(error);
 }
 
-void AITransform::onRenderComplete(const QString &imagePath)
+void AITransform::onRenderComplete(int renderId, const QString &imagePath)
 {
+    if (!m_renderJobs.contains(renderId)) return;
+
+    int requestId = m_renderJobs.take(renderId);
+    auto it = m_jobs.find(requestId);
+    if (it == m_jobs.end()) return;
+
     setStatusMessage("");
-    m_lastMermaidImagePath = imagePath;
-    emit resultChanged();
-    emit showResult(m_lastResult, true, imagePath);
-    emit transformComplete();
+    it->renderId = -1;
+    it->mermaidImagePath = imagePath;
+    markReady(requestId);
 }
 
-void AITransform::onRenderError(const QString &error)
+void AITransform::onRenderError(int renderId, const QString &error)
 {
+    if (!m_renderJobs.contains(renderId)) return;
+
+    int requestId = m_renderJobs.take(renderId);
+    auto it = m_jobs.find(requestId);
+    if (it == m_jobs.end()) return;
+
     setStatusMessage("");
-    
+    it->renderId = -1;
+
     // Fall back to text representation of Mermaid
-    if (!m_lastMermaidCode.isEmpty()) {
-        QString textFallback = m_renderer->renderToText(m_lastMermaidCode);
-        m_lastResult = textFallback;
-        m_lastResultIsMermaid = false;
-        emit resultChanged();
-        emit showResult(m_lastResult, false, QString());
-        emit transformComplete();
+    if (!it->mermaidCode.isEmpty()) {
+        it->result = m_renderer->renderToText(it->mermaidCode);
+        it->isMermaid = false;
+        markReady(requestId);
     } else {
+        bool wasShown = m_jobOrder.first() == requestId;
+        removeJob(requestId);
+        if (wasShown) {
+            presentShownJob();
+        }
         emit showError("Diagram rendering failed: " + error);
     }
 }
 
+void AITransform::onContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    // Keep every pending transform pointing at the text it was started on
+    for (Job &job : m_jobs) {
+        job.start = adjustedPosition(job.start, false, position, charsRemoved, charsAdded);
+        job.end = qMax(job.start,
+                       adjustedPosition(job.end, true, position, charsRemoved, charsAdded));
+    }
+}
+
 void AITransform::acceptResult()
 {
     replaceSelection();
@@ -222,74 +484,58 @@ void AITransform::acceptResult()
 
 void AITransform::replaceSelection()
 {
-    if (!m_editor || !hasSelection() || m_lastResult.isEmpty()) return;
-    
-    // Get current content
-    QString content = m_editor->content();
-    
-    // Replace selection
-    QString before = content.left(m_selectionStart);
-    QString after = content.mid(m_selectionEnd);
-    
+    const Job *job = shownJob();
+    if (!m_editor || !job || job->state != Job::Ready || job->result.isEmpty()) return;
+
+    // Take the job off the list first so the edit below does not move it
+    Job applied = *job;
+    removeJob(m_jobOrder.first());
+
     // For Mermaid with image, insert markdown image reference or the code block
     QString insertText;
-    if (m_lastResultIsMermaid && !m_lastMermaidImagePath.isEmpty()) {
+    if (applied.isMermaid && !applied.mermaidImagePath.isEmpty()) {
         // Insert as markdown image and code block
         insertText = QString("![diagram](%1)\n\n```mermaid\n%2\n```")
-            .arg(m_lastMermaidImagePath, m_lastMermaidCode);
+            .arg(applied.mermaidImagePath, applied.mermaidCode);
     } else {
-        insertText = m_lastResult;
+        insertText = applied.result;
     }
-    
-    m_editor->setContent(before + insertText + after);
-    m_editor->setCursorPosition(m_selectionStart + insertText.length());
-    
-    // Clear state
+
+    m_editor->replaceRange(applied.start, applied.end, insertText);
+
+    // Clear state and bring up the next result, if any
     clearSelection();
-    m_lastResult.clear();
-    m_lastMermaidCode.clear();
-    m_lastMermaidImagePath.clear();
-    m_lastResultIsMermaid = false;
-    emit resultChanged();
+    presentShownJob();
 }
 
 void AITransform::insertAfterSelection()
 {
-    if (!m_editor || !hasSelection() || m_lastResult.isEmpty()) return;
-    
-    QString content = m_editor->content();
-    
-    // Insert after selection
-    QString before = content.left(m_selectionEnd);
-    QString after = content.mid(m_selectionEnd);
-    
+    const Job *job = shownJob();
+    if (!m_editor || !job || job->state != Job::Ready || job->result.isEmpty()) return;
+
+    Job applied = *job;
+    removeJob(m_jobOrder.first());
+
     // Add separator
-    QString insertText = "\n\n" + m_lastResult;
-    
-    if (m_lastResultIsMermaid && !m_lastMermaidImagePath.isEmpty()) {
+    QString insertText = "\n\n" + applied.result;
+
+    if (applied.isMermaid && !applied.mermaidImagePath.isEmpty()) {
         insertText = QString("\n\n![diagram](%1)\n\n```mermaid\n%2\n```")
-            .arg(m_lastMermaidImagePath, m_lastMermaidCode);
+            .arg(applied.mermaidImagePath, applied.mermaidCode);
     }
-    
-    m_editor->setContent(before + insertText + after);
-    m_editor->setCursorPosition(m_selectionEnd + insertText.length());
-    
-    // Clear state
+
+    // Insert after selection
+    m_editor->replaceRange(applied.end, applied.end, insertText);
+
+    // Clear state and bring up the next result, if any
     clearSelection();
-    m_lastResult.clear();
-    m_lastMermaidCode.clear();
-    m_lastMermaidImagePath.clear();
-    m_lastResultIsMermaid = false;
-    emit resultChanged();
+    presentShownJob();
 }
 
 void AITransform::discardResult()
 {
-    m_lastResult.clear();
-    m_lastMermaidCode.clear();
-    m_lastMermaidImagePath.clear();
-    m_lastResultIsMermaid = false;
-    emit resultChanged();
+    // Also cancels the request if it is still running
+    finishShownJob();
 }
 
 void AITransform::openSettings()
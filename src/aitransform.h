@@ -13,12 +13,16 @@
 #include <QObject>
 #include <QString>
 #include <QVariantList>
+#include <QHash>
+#include <QList>
 
 #include "aiconfig.h"
 #include "aiclient.h"
 #include "mermaidrenderer.h"
 
 class Editor;
+class NetworkSession;
+class QTimer;
 
 /**
  * @brief The AITransform class coordinates AI-powered text transformations.
@@ -26,6 +30,23 @@ class Editor;
  * This class serves as the main coordinator between the UI, AI client,
  * Mermaid renderer, and editor. It manages the complete workflow:
  * 1. Text selection → 2. Prompt selection → 3. AI call → 4. Result processing → 5. Injection
+ *
+ * Several transforms can be in flight at once. Each one remembers the range
+ * it was started on; the range follows later edits, so a result still lands
+ * on the right text after the user kept typing or accepted an earlier result.
+ * Results are shown one at a time in the order they were requested, and
+ * accepting or discarding one brings up the next.
+ *
+ * While the result on screen streams in, the partial text is pushed to the
+ * UI through showPartialResult(), at most once per STREAM_REFRESH_MS so the
+ * e-ink panel is not asked to redraw for every token.
+ *
+ * The client and renderer share one NetworkSession. prewarm() connects to
+ * the current provider while the user is still choosing a prompt.
+ *
+ * Only the configuration exists from the start. The session, client and
+ * renderer are created by the first selection, prewarm or transform, so
+ * launching the app does not pay for AI features that may never be used.
  */
 class AITransform : public QObject
 {
@@ -39,6 +60,8 @@ class AITransform : public QObject
     Q_PROPERTY(QString lastResult READ lastResult NOTIFY resultChanged)
     Q_PROPERTY(bool lastResultIsMermaid READ lastResultIsMermaid NOTIFY resultChanged)
     Q_PROPERTY(QString lastMermaidImagePath READ lastMermaidImagePath NOTIFY resultChanged)
+    Q_PROPERTY(bool resultReady READ isResultReady NOTIFY resultChanged)
+    Q_PROPERTY(int queuedResults READ queuedResults NOTIFY resultChanged)
 
 public:
     explicit AITransform(QObject *parent = nullptr);
@@ -47,7 +70,7 @@ public:
     void setEditor(Editor *editor);
     void setConfigDirectory(const QString &path);
 
-    // Components access
+    // Components access; client and renderer are null until first used
     AIConfig* config() const { return m_config; }
     AIClient* client() const { return m_client; }
     MermaidRenderer* renderer() const { return m_renderer; }
@@ -62,22 +85,25 @@ public:
     QString lastResult() const;
     bool lastResultIsMermaid() const;
     QString lastMermaidImagePath() const;
+    bool isResultReady() const;
+    int queuedResults() const;
 
 public slots:
     // Selection management
     void setSelection(int start, int end);
     void clearSelection();
-    
+
     // Transform operations
     void transform(const QString &promptTemplateId, const QString &customPrompt = QString());
+    void prewarm();
     void cancel();
-    
-    // Result handling
+
+    // Result handling (all act on the result currently shown)
     void acceptResult();
     void replaceSelection();
     void insertAfterSelection();
     void discardResult();
-    
+
     // Configuration
     void openSettings();
 
@@ -87,43 +113,84 @@ signals:
     void statusMessageChanged();
     void configChanged();
     void resultChanged();
-    
+
     // UI signals
     void showPromptPalette();
     void hidePromptPalette();
     void showResult(const QString &result, bool isMermaid, const QString &imagePath);
+    void showPartialResult(const QString &result);
+    void hideResult();
     void showSettings();
     void showError(const QString &error);
     void transformComplete();
 
 private slots:
+    void onTransformChunk(int requestId, const QString &chunk);
     void onTransformComplete(const AIResponse &response);
-    void onTransformError(const QString &error);
-    void onRenderComplete(const QString &imagePath);
-    void onRenderError(const QString &error);
+    void onTransformError(int requestId, const QString &error);
+    void onRenderComplete(int renderId, const QString &imagePath);
+    void onRenderError(int renderId, const QString &error);
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
 
 private:
+    /**
+     * One requested transform, from the AI call until it is applied or discarded.
+     */
+    struct Job {
+        enum State {
+            Running,   // Waiting for or streaming the AI response
+            Rendering, // Waiting for the Mermaid renderer
+            Ready      // Final; can be inserted
+        };
+
+        State state;
+        int start;     // Range the transform was started on,
+        int end;       // kept in step with later edits
+        QString result;
+        bool isMermaid;
+        QString mermaidCode;
+        QString mermaidImagePath;
+        int renderId;  // While Rendering
+    };
+
+    void ensureStarted();
     void setStatusMessage(const QString &message);
-    
+    Job *shownJob();
+    const Job *shownJob() const;
+    void finishShownJob();
+    void presentShownJob();
+    void removeJob(int requestId);
+    void markReady(int requestId);
+    void publishPartialResult();
+    void stopPartialUpdates();
+
     Editor *m_editor;
+    NetworkSession *m_network;
     AIConfig *m_config;
     AIClient *m_client;
     MermaidRenderer *m_renderer;
-    
+    QString m_configDirectory;
+
     // Selection state
     int m_selectionStart;
     int m_selectionEnd;
     QString m_selectedText;
-    
-    // Result state
-    QString m_lastResult;
-    bool m_lastResultIsMermaid;
-    QString m_lastMermaidCode;
-    QString m_lastMermaidImagePath;
-    
+
+    // Transforms by request id; m_jobOrder.first() is the one on screen
+    QHash<int, Job> m_jobs;
+    QList<int> m_jobOrder;
+
+    // Request id of the job each render id belongs to
+    QHash<int, int> m_renderJobs;
+
+    // Throttled partial updates for the job on screen
+    bool m_partialPending;
+    QTimer *m_streamRefreshTimer;
+
     // Status
     QString m_statusMessage;
-    bool m_busy;
+
+    static const int STREAM_REFRESH_MS = 300;
 };
 
 #endif // AITRANSFORM_H
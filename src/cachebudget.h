@@ -0,0 +1,112 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * cachebudget.h - Least-recently-used byte accounting for the disk caches
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#ifndef CACHEBUDGET_H
+#define CACHEBUDGET_H
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <algorithm>
+
+/**
+ * @brief The CacheBudget class tracks the size and last use of cache entries.
+ *
+ * It owns no files: DiskCache and MermaidCache report what they store and
+ * drop, and ask overBudget() which entries to delete, least recently used
+ * first, to get the total back under maxBytes().
+ */
+template <typename Key>
+class CacheBudget
+{
+public:
+    explicit CacheBudget(qint64 maxBytes)
+        : m_bytes(0)
+        , m_maxBytes(maxBytes)
+    {
+    }
+
+    bool contains(const Key &key) const { return m_entries.contains(key); }
+    int count() const { return m_entries.size(); }
+    QList<Key> keys() const { return m_entries.keys(); }
+
+    qint64 bytes() const { return m_bytes; }
+    qint64 maxBytes() const { return m_maxBytes; }
+    void setMaxBytes(qint64 bytes) { m_maxBytes = bytes; }
+
+    qint64 lastUsed(const Key &key) const { return m_entries.value(key).lastUsed; }
+
+    /**
+     * @brief set - Record key at size bytes, replacing what it had before
+     */
+    void set(const Key &key, qint64 size, qint64 lastUsed)
+    {
+        Entry &entry = m_entries[key];
+        m_bytes += size - entry.size;
+        entry.size = size;
+        entry.lastUsed = lastUsed;
+    }
+
+    void touch(const Key &key, qint64 lastUsed)
+    {
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) it->lastUsed = lastUsed;
+    }
+
+    void remove(const Key &key)
+    {
+        auto it = m_entries.find(key);
+        if (it == m_entries.end()) return;
+        m_bytes -= it->size;
+        m_entries.erase(it);
+    }
+
+    void clear()
+    {
+        m_entries.clear();
+        m_bytes = 0;
+    }
+
+    /**
+     * @brief overBudget - Entries to evict, oldest first, sparing keep
+     */
+    QList<Key> overBudget(const Key &keep = Key()) const
+    {
+        QList<Key> evict;
+        if (m_bytes <= m_maxBytes) return evict;
+
+        QList<QPair<qint64, Key>> byAge;
+        byAge.reserve(m_entries.size());
+        for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+            byAge.append(qMakePair(it->lastUsed, it.key()));
+        }
+        std::sort(byAge.begin(), byAge.end());
+
+        qint64 bytes = m_bytes;
+        for (const auto &entry : byAge) {
+            if (bytes <= m_maxBytes) break;
+            if (entry.second == keep) continue;
+            bytes -= m_entries.value(entry.second).size;
+            evict.append(entry.second);
+        }
+        return evict;
+    }
+
+private:
+    struct Entry {
+        qint64 size = 0;
+        qint64 lastUsed = 0; // msecs since epoch
+    };
+
+    QHash<Key, Entry> m_entries;
+    qint64 m_bytes;
+    qint64 m_maxBytes;
+};
+
+#endif // CACHEBUDGET_H
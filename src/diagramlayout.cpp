@@ -0,0 +1,739 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * diagramlayout.cpp - Native layout for Mermaid flowcharts and sequence diagrams
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#include "diagramlayout.h"
+#include <QFontMetricsF>
+#include <QHash>
+#include <QRegularExpression>
+#include <QtMath>
+#include <algorithm>
+#include <climits>
+#include <functional>
+
+namespace {
+
+const qreal DUMMY_WIDTH = 8;
+const int ORDER_SWEEPS = 8;
+const int PLACEMENT_SWEEPS = 8;
+
+QString cleanLabel(QString label)
+{
+    label = label.trimmed();
+    if (label.size() >= 2 && label.startsWith('"') && label.endsWith('"')) {
+        label = label.mid(1, label.size() - 2);
+    }
+    label.replace(QRegularExpression("<br\\s*/?>", QRegularExpression::CaseInsensitiveOption), "\n");
+    return label;
+}
+
+QSizeF labelSize(const QFontMetricsF &fm, const QString &label)
+{
+    QRectF rect = fm.boundingRect(QRectF(0, 0, DiagramLayout::MAX_LABEL_WIDTH, 10000),
+                                  Qt::AlignCenter | Qt::TextWordWrap, label);
+    return rect.size();
+}
+
+// Number of edge crossings between two neighbouring layers
+int countCrossings(const QVector<int> &upper, const QVector<QVector<int>> &down,
+                   const QVector<int> &position)
+{
+    QVector<QPair<int, int>> links;
+    for (int u : upper) {
+        for (int v : down[u]) {
+            links.append(qMakePair(position[u], position[v]));
+        }
+    }
+
+    int crossings = 0;
+    for (int i = 0; i < links.size(); ++i) {
+        for (int j = i + 1; j < links.size(); ++j) {
+            if ((links[i].first - links[j].first) * (links[i].second - links[j].second) < 0) {
+                ++crossings;
+            }
+        }
+    }
+    return crossings;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Parsing
+// ---------------------------------------------------------------------------
+
+QStringList DiagramLayout::splitStatements(const QString &code)
+{
+    QStringList statements;
+    for (const QString &line : code.split('\n')) {
+        for (const QString &part : line.split(';')) {
+            QString statement = part.trimmed();
+            if (!statement.isEmpty() && !statement.startsWith("%%")) {
+                statements << statement;
+            }
+        }
+    }
+    return statements;
+}
+
+int DiagramLayout::nodeIndex(FlowchartDiagram *diagram, const QString &id)
+{
+    for (int i = 0; i < diagram->nodes.size(); ++i) {
+        if (diagram->nodes[i].id == id) return i;
+    }
+
+    FlowchartDiagram::Node node;
+    node.id = id;
+    node.label = id;
+    diagram->nodes.append(node);
+    return diagram->nodes.size() - 1;
+}
+
+bool DiagramLayout::parseFlowchart(const QString &code, FlowchartDiagram *diagram)
+{
+    QStringList statements = splitStatements(code);
+    if (statements.isEmpty()) return false;
+
+    QRegularExpression headerRe(R"(^(graph|flowchart)\b\s*(\w+)?)");
+    QRegularExpressionMatch header = headerRe.match(statements.takeFirst());
+    if (!header.hasMatch()) return false;
+
+    QString direction = header.captured(2).toUpper();
+    if (direction == "LR") diagram->direction = FlowchartDiagram::LeftRight;
+    else if (direction == "RL") diagram->direction = FlowchartDiagram::RightLeft;
+    else if (direction == "BT") diagram->direction = FlowchartDiagram::BottomUp;
+    else diagram->direction = FlowchartDiagram::TopDown;
+
+    // Node shapes, longest delimiters first
+    struct ShapeSyntax { QRegularExpression re; FlowchartDiagram::Shape shape; };
+    static const QVector<ShapeSyntax> shapes = {
+        { QRegularExpression(R"(\(\((.*?)\)\))"), FlowchartDiagram::Circle },
+        { QRegularExpression(R"(\(\[(.*?)\]\))"), FlowchartDiagram::Stadium },
+        { QRegularExpression(R"(\[\((.*?)\)\])"), FlowchartDiagram::Box },
+        { QRegularExpression(R"(\[\[(.*?)\]\])"), FlowchartDiagram::Box },
+        { QRegularExpression(R"(\{\{(.*?)\}\})"), FlowchartDiagram::Diamond },
+        { QRegularExpression(R"(\[(.*?)\])"), FlowchartDiagram::Box },
+        { QRegularExpression(R"(\((.*?)\))"), FlowchartDiagram::Rounded },
+        { QRegularExpression(R"(\{(.*?)\})"), FlowchartDiagram::Diamond },
+        { QRegularExpression(R"(>(.*?)\])"), FlowchartDiagram::Box },
+    };
+    static const QRegularExpression idRe(R"(\s*(\w+))");
+    static const QRegularExpression linkRe(
+        R"(\s*(<-->|-->|---|==>|===|-\.->|-\.-|--[ox]|==[ox])\s*(?:\|([^|]*)\|)?)");
+    static const QRegularExpression textLinkRe(
+        R"(\s*(--|==|-\.)\s+(.+?)\s+(-->|---|==>|===|\.->|\.-))");
+    static const QRegularExpression ignoredRe(
+        R"(^(subgraph|end|direction|classDef|class|style|linkStyle|click)\b)");
+
+    const auto match = [](const QRegularExpression &re, const QString &s, int pos) {
+        return re.match(s, pos, QRegularExpression::NormalMatch,
+                        QRegularExpression::AnchoredMatchOption);
+    };
+
+    // Reads a node reference at pos; returns its index or -1
+    const auto readNode = [&](const QString &s, int *pos) {
+        QRegularExpressionMatch id = match(idRe, s, *pos);
+        if (!id.hasMatch()) return -1;
+        *pos = id.capturedEnd();
+
+        int index = nodeIndex(diagram, id.captured(1));
+        for (const ShapeSyntax &syntax : shapes) {
+            QRegularExpressionMatch shape = match(syntax.re, s, *pos);
+            if (shape.hasMatch()) {
+                diagram->nodes[index].label = cleanLabel(shape.captured(1));
+                diagram->nodes[index].shape = syntax.shape;
+                *pos = shape.capturedEnd();
+                break;
+            }
+        }
+        return index;
+    };
+
+    for (const QString &statement : statements) {
+        if (ignoredRe.match(statement).hasMatch()) continue;
+
+        int pos = 0;
+        int previous = readNode(statement, &pos);
+        if (previous < 0) continue;
+
+        // A --> B -- text --> C ...
+        while (pos < statement.size()) {
+            QString arrow;
+            QString label;
+
+            QRegularExpressionMatch link = match(linkRe, statement, pos);
+            if (link.hasMatch()) {
+                arrow = link.captured(1);
+                label = link.captured(2);
+                pos = link.capturedEnd();
+            } else {
+                QRegularExpressionMatch textLink = match(textLinkRe, statement, pos);
+                if (!textLink.hasMatch()) break;
+                arrow = textLink.captured(1) + textLink.captured(3);
+                label = textLink.captured(2);
+                pos = textLink.capturedEnd();
+            }
+
+            int next = readNode(statement, &pos);
+            if (next < 0) break;
+
+            FlowchartDiagram::Edge edge;
+            edge.from = previous;
+            edge.to = next;
+            edge.label = cleanLabel(label);
+            edge.arrow = arrow.endsWith('>');
+            if (arrow.contains('.')) edge.style = FlowchartDiagram::Dotted;
+            else if (arrow.contains('=')) edge.style = FlowchartDiagram::Thick;
+            diagram->edges.append(edge);
+
+            previous = next;
+        }
+    }
+
+    return !diagram->nodes.isEmpty();
+}
+
+bool DiagramLayout::parseMindmap(const QString &code, FlowchartDiagram *diagram)
+{
+    QStringList lines = code.split('\n');
+    while (!lines.isEmpty() && lines.first().trimmed().isEmpty()) {
+        lines.removeFirst();
+    }
+    if (lines.isEmpty() || lines.takeFirst().trimmed() != "mindmap") return false;
+
+    diagram->direction = FlowchartDiagram::LeftRight;
+
+    struct ShapeSyntax { QRegularExpression re; FlowchartDiagram::Shape shape; };
+    static const QVector<ShapeSyntax> shapes = {
+        { QRegularExpression(R"(^[\w-]*\(\((.*)\)\)$)"), FlowchartDiagram::Circle },
+        { QRegularExpression(R"(^[\w-]*\)\)(.*)\(\($)"), FlowchartDiagram::Circle },
+        { QRegularExpression(R"(^[\w-]*\{\{(.*)\}\}$)"), FlowchartDiagram::Diamond },
+        { QRegularExpression(R"(^[\w-]*\[(.*)\]$)"), FlowchartDiagram::Box },
+        { QRegularExpression(R"(^[\w-]*\((.*)\)$)"), FlowchartDiagram::Rounded },
+        { QRegularExpression(R"(^[\w-]*\)(.*)\($)"), FlowchartDiagram::Rounded },
+    };
+
+    // Indentation of each open ancestor, innermost last
+    QVector<QPair<int, int>> stack;
+
+    for (const QString &line : lines) {
+        QString text = line.trimmed();
+        if (text.isEmpty() || text.startsWith("%%") || text.startsWith("::")) continue;
+
+        int indent = 0;
+        while (indent < line.size() && line.at(indent).isSpace()) ++indent;
+
+        FlowchartDiagram::Node node;
+        node.shape = FlowchartDiagram::Stadium;
+        node.label = text;
+        for (const ShapeSyntax &syntax : shapes) {
+            QRegularExpressionMatch shape = syntax.re.match(text);
+            if (shape.hasMatch()) {
+                node.label = shape.captured(1);
+                node.shape = syntax.shape;
+                break;
+            }
+        }
+        node.label = cleanLabel(node.label);
+        node.id = QString::number(diagram->nodes.size());
+        if (diagram->nodes.isEmpty()) {
+            node.shape = FlowchartDiagram::Circle;
+        }
+        diagram->nodes.append(node);
+        int index = diagram->nodes.size() - 1;
+
+        while (!stack.isEmpty() && stack.last().first >= indent) {
+            stack.removeLast();
+        }
+        if (!stack.isEmpty()) {
+            FlowchartDiagram::Edge edge;
+            edge.from = stack.last().second;
+            edge.to = index;
+            edge.arrow = false;
+            diagram->edges.append(edge);
+        }
+        stack.append(qMakePair(indent, index));
+    }
+
+    return !diagram->nodes.isEmpty();
+}
+
+bool DiagramLayout::parseSequence(const QString &code, SequenceDiagram *diagram)
+{
+    QStringList statements = splitStatements(code);
+    if (statements.isEmpty() || !statements.takeFirst().startsWith("sequenceDiagram")) {
+        return false;
+    }
+
+    static const QRegularExpression participantRe(
+        R"(^(?:participant|actor)\s+(\S+)(?:\s+as\s+(.+))?$)");
+    static const QRegularExpression messageRe(
+        R"(^([^\s:+-]+)\s*(-->>|->>|-->|->|--x|-x|--\)|-\))\s*[+-]?\s*([^\s:]+)\s*:\s*(.*)$)");
+
+    const auto participantIndex = [diagram](const QString &id) {
+        for (int i = 0; i < diagram->participants.size(); ++i) {
+            if (diagram->participants[i].id == id) return i;
+        }
+        SequenceDiagram::Participant participant;
+        participant.id = id;
+        participant.label = id;
+        diagram->participants.append(participant);
+        return diagram->participants.size() - 1;
+    };
+
+    for (const QString &statement : statements) {
+        QRegularExpressionMatch participant = participantRe.match(statement);
+        if (participant.hasMatch()) {
+            int index = participantIndex(participant.captured(1));
+            if (!participant.captured(2).isEmpty()) {
+                diagram->participants[index].label = cleanLabel(participant.captured(2));
+            }
+            continue;
+        }
+
+        QRegularExpressionMatch message = messageRe.match(statement);
+        if (message.hasMatch()) {
+            SequenceDiagram::Message entry;
+            entry.from = participantIndex(message.captured(1));
+            entry.to = participantIndex(message.captured(3));
+            entry.text = cleanLabel(message.captured(4));
+            entry.dashed = message.captured(2).startsWith("--");
+            entry.arrow = message.captured(2).contains(">>") || message.captured(2).endsWith(')');
+            diagram->messages.append(entry);
+        }
+        // Notes, loops, activations and the like are not drawn
+    }
+
+    return !diagram->participants.isEmpty();
+}
+
+// ---------------------------------------------------------------------------
+// Flowchart layout
+// ---------------------------------------------------------------------------
+
+QPointF DiagramLayout::clipToBorder(const FlowchartDiagram::Node &node, const QPointF &toward)
+{
+    const QPointF c = node.rect.center();
+    const QPointF d = toward - c;
+    const qreal hw = node.rect.width() / 2;
+    const qreal hh = node.rect.height() / 2;
+    if (qFuzzyIsNull(d.x()) && qFuzzyIsNull(d.y())) return c;
+
+    qreal t;
+    switch (node.shape) {
+    case FlowchartDiagram::Diamond:
+        t = 1.0 / (qAbs(d.x()) / hw + qAbs(d.y()) / hh);
+        break;
+    case FlowchartDiagram::Circle:
+        t = hw / qSqrt(d.x() * d.x() + d.y() * d.y());
+        break;
+    default:
+        t = qMin(qFuzzyIsNull(d.x()) ? 1e9 : hw / qAbs(d.x()),
+                 qFuzzyIsNull(d.y()) ? 1e9 : hh / qAbs(d.y()));
+        break;
+    }
+    return c + d * qMin(t, 1.0);
+}
+
+void DiagramLayout::layout(FlowchartDiagram *diagram, const QFont &font)
+{
+    QFontMetricsF fm(font);
+    const int n = diagram->nodes.size();
+    const bool horizontal = diagram->direction == FlowchartDiagram::LeftRight
+                         || diagram->direction == FlowchartDiagram::RightLeft;
+    if (n == 0) {
+        diagram->size = QSizeF(2 * MARGIN, 2 * MARGIN);
+        return;
+    }
+
+    // Node sizes; "across" runs along a layer, "along" from layer to layer
+    QVector<qreal> across, along;
+    for (FlowchartDiagram::Node &node : diagram->nodes) {
+        QSizeF text = labelSize(fm, node.label);
+        qreal w = text.width() + 2 * NODE_PADDING;
+        qreal h = text.height() + NODE_PADDING;
+        switch (node.shape) {
+        case FlowchartDiagram::Diamond:
+            w *= 1.6;
+            h *= 2.2;
+            break;
+        case FlowchartDiagram::Circle:
+            w = h = qSqrt(w * w + h * h);
+            break;
+        case FlowchartDiagram::Stadium:
+            w += h / 2;
+            break;
+        default:
+            break;
+        }
+        node.rect = QRectF(0, 0, w, h);
+        across.append(horizontal ? h : w);
+        along.append(horizontal ? w : h);
+    }
+
+    // 1. Break cycles: edges back to a node on the DFS stack are reversed
+    const int edgeCount = diagram->edges.size();
+    QVector<bool> reversed(edgeCount, false);
+    {
+        QVector<QVector<int>> outgoing(n);
+        for (int e = 0; e < edgeCount; ++e) {
+            outgoing[diagram->edges[e].from].append(e);
+        }
+        QVector<int> state(n, 0); // 0 new, 1 on stack, 2 done
+        std::function<void(int)> visit = [&](int u) {
+            state[u] = 1;
+            for (int e : outgoing[u]) {
+                int v = diagram->edges[e].to;
+                if (state[v] == 1) reversed[e] = true;
+                else if (state[v] == 0) visit(v);
+            }
+            state[u] = 2;
+        };
+        for (int u = 0; u < n; ++u) {
+            if (state[u] == 0) visit(u);
+        }
+    }
+
+    const auto source = [&](int e) { return reversed[e] ? diagram->edges[e].to : diagram->edges[e].from; };
+    const auto target = [&](int e) { return reversed[e] ? diagram->edges[e].from : diagram->edges[e].to; };
+
+    // 2. Layers by longest path, then sources moved down next to their successors
+    QVector<int> layer(n, 0);
+    {
+        QVector<int> indegree(n, 0);
+        QVector<QVector<int>> succ(n);
+        for (int e = 0; e < edgeCount; ++e) {
+            if (source(e) == target(e)) continue;
+            succ[source(e)].append(target(e));
+            ++indegree[target(e)];
+        }
+        QVector<int> queue;
+        for (int u = 0; u < n; ++u) {
+            if (indegree[u] == 0) queue.append(u);
+        }
+        for (int i = 0; i < queue.size(); ++i) {
+            int u = queue[i];
+            for (int v : succ[u]) {
+                layer[v] = qMax(layer[v], layer[u] + 1);
+                if (--indegree[v] == 0) queue.append(v);
+            }
+        }
+        for (int u = 0; u < n; ++u) {
+            bool isSource = true;
+            for (int e = 0; e < edgeCount; ++e) {
+                if (target(e) == u && source(e) != u) isSource = false;
+            }
+            if (!isSource || succ[u].isEmpty()) continue;
+            int lowest = INT_MAX;
+            for (int v : succ[u]) lowest = qMin(lowest, layer[v]);
+            layer[u] = qMax(layer[u], lowest - 1);
+        }
+    }
+
+    // 3. Dummy nodes so every edge joins neighbouring layers
+    QVector<int> vlayer = layer;
+    QVector<qreal> vacross = across;
+    QVector<qreal> valong = along;
+    QVector<QVector<int>> up(n), down(n);
+    QVector<QVector<int>> chains(edgeCount);
+    for (int e = 0; e < edgeCount; ++e) {
+        int u = source(e);
+        int v = target(e);
+        if (u == v) continue;
+
+        QVector<int> &chain = chains[e];
+        chain.append(u);
+        for (int l = layer[u] + 1; l < layer[v]; ++l) {
+            int dummy = vlayer.size();
+            vlayer.append(l);
+            vacross.append(DUMMY_WIDTH);
+            valong.append(0);
+            up.append(QVector<int>());
+            down.append(QVector<int>());
+            chain.append(dummy);
+        }
+        chain.append(v);
+        for (int i = 0; i + 1 < chain.size(); ++i) {
+            down[chain[i]].append(chain[i + 1]);
+            up[chain[i + 1]].append(chain[i]);
+        }
+    }
+    const int vcount = vlayer.size();
+    const int layerCount = *std::max_element(vlayer.begin(), vlayer.end()) + 1;
+
+    // 4. Order within layers: DFS order, then barycenter sweeps
+    QVector<QVector<int>> layers(layerCount);
+    {
+        QVector<bool> seen(vcount, false);
+        std::function<void(int)> place = [&](int u) {
+            seen[u] = true;
+            layers[vlayer[u]].append(u);
+            for (int v : down[u]) {
+                if (!seen[v]) place(v);
+            }
+        };
+        for (int u = 0; u < vcount; ++u) {
+            if (!seen[u] && up[u].isEmpty()) place(u);
+        }
+        for (int u = 0; u < vcount; ++u) {
+            if (!seen[u]) place(u);
+        }
+    }
+
+    QVector<int> position(vcount, 0);
+    const auto updatePositions = [&]() {
+        for (const QVector<int> &nodes : layers) {
+            for (int i = 0; i < nodes.size(); ++i) position[nodes[i]] = i;
+        }
+    };
+    const auto totalCrossings = [&]() {
+        int crossings = 0;
+        for (int l = 0; l + 1 < layerCount; ++l) {
+            crossings += countCrossings(layers[l], down, position);
+        }
+        return crossings;
+    };
+
+    updatePositions();
+    QVector<QVector<int>> bestLayers = layers;
+    int bestCrossings = totalCrossings();
+
+    for (int sweep = 0; sweep < ORDER_SWEEPS && bestCrossings > 0; ++sweep) {
+        const bool downward = sweep % 2 == 0;
+        for (int step = 1; step < layerCount; ++step) {
+            int l = downward ? step : layerCount - 1 - step;
+            QVector<int> &nodes = layers[l];
+
+            QHash<int, qreal> barycenter;
+            for (int u : nodes) {
+                const QVector<int> &neighbours = downward ? up[u] : down[u];
+                if (neighbours.isEmpty()) {
+                    barycenter[u] = position[u];
+                    continue;
+                }
+                qreal sum = 0;
+                for (int v : neighbours) sum += position[v];
+                barycenter[u] = sum / neighbours.size();
+            }
+            std::stable_sort(nodes.begin(), nodes.end(), [&](int a, int b) {
+                return barycenter[a] < barycenter[b];
+            });
+            for (int i = 0; i < nodes.size(); ++i) position[nodes[i]] = i;
+        }
+
+        int crossings = totalCrossings();
+        if (crossings < bestCrossings) {
+            bestCrossings = crossings;
+            bestLayers = layers;
+        }
+    }
+    layers = bestLayers;
+    updatePositions();
+
+    // 5. Coordinates: pack each layer, then pull nodes towards their neighbours
+    qreal labelGap = 0;
+    for (const FlowchartDiagram::Edge &edge : diagram->edges) {
+        if (edge.label.isEmpty()) continue;
+        QSizeF size = labelSize(fm, edge.label);
+        labelGap = qMax(labelGap, horizontal ? size.width() : size.height());
+    }
+    const qreal layerSpacing = LAYER_SPACING + labelGap;
+
+    const auto separation = [&](int a, int b) {
+        bool dummy = a >= n || b >= n;
+        return (vacross[a] + vacross[b]) / 2 + (dummy ? NODE_SPACING / 2.0 : NODE_SPACING);
+    };
+
+    QVector<qreal> x(vcount, 0);
+    for (const QVector<int> &nodes : layers) {
+        qreal cursor = 0;
+        for (int i = 0; i < nodes.size(); ++i) {
+            if (i > 0) cursor += separation(nodes[i - 1], nodes[i]);
+            x[nodes[i]] = cursor;
+        }
+        // Centre the layer on zero
+        for (int u : nodes) x[u] -= cursor / 2;
+    }
+
+    for (int sweep = 0; sweep < PLACEMENT_SWEEPS; ++sweep) {
+        const bool downward = sweep % 2 == 0;
+        for (int step = 0; step < layerCount; ++step) {
+            int l = downward ? step : layerCount - 1 - step;
+            const QVector<int> &nodes = layers[l];
+            if (nodes.isEmpty()) continue;
+
+            QVector<qreal> wanted(nodes.size());
+            for (int i = 0; i < nodes.size(); ++i) {
+                int u = nodes[i];
+                QVector<int> neighbours = up[u] + down[u];
+                if (neighbours.isEmpty()) {
+                    wanted[i] = x[u];
+                    continue;
+                }
+                qreal sum = 0;
+                for (int v : neighbours) sum += x[v];
+                wanted[i] = sum / neighbours.size();
+            }
+
+            // Closest positions keeping the order and spacing, from either side
+            QVector<qreal> left(nodes.size()), right(nodes.size());
+            for (int i = 0; i < nodes.size(); ++i) {
+                left[i] = i == 0 ? wanted[i]
+                                 : qMax(wanted[i], left[i - 1] + separation(nodes[i - 1], nodes[i]));
+            }
+            for (int i = nodes.size() - 1; i >= 0; --i) {
+                right[i] = i == nodes.size() - 1 ? wanted[i]
+                                 : qMin(wanted[i], right[i + 1] - separation(nodes[i], nodes[i + 1]));
+            }
+            for (int i = 0; i < nodes.size(); ++i) {
+                x[nodes[i]] = (left[i] + right[i]) / 2;
+            }
+        }
+    }
+
+    QVector<qreal> layerStart(layerCount, 0), layerThickness(layerCount, 0);
+    for (int u = 0; u < vcount; ++u) {
+        layerThickness[vlayer[u]] = qMax(layerThickness[vlayer[u]], valong[u]);
+    }
+    for (int l = 1; l < layerCount; ++l) {
+        layerStart[l] = layerStart[l - 1] + layerThickness[l - 1] + layerSpacing;
+    }
+    const qreal totalAlong = layerStart[layerCount - 1] + layerThickness[layerCount - 1];
+
+    // Centre of every (virtual) node in diagram coordinates
+    QVector<QPointF> centre(vcount);
+    for (int u = 0; u < vcount; ++u) {
+        qreal a = x[u];
+        qreal b = layerStart[vlayer[u]] + layerThickness[vlayer[u]] / 2;
+        if (diagram->direction == FlowchartDiagram::BottomUp
+                || diagram->direction == FlowchartDiagram::RightLeft) {
+            b = totalAlong - b;
+        }
+        centre[u] = horizontal ? QPointF(b, a) : QPointF(a, b);
+    }
+    for (int u = 0; u < n; ++u) {
+        diagram->nodes[u].rect.moveCenter(centre[u]);
+    }
+
+    // 6. Edges as polylines through their dummy nodes
+    for (int e = 0; e < edgeCount; ++e) {
+        FlowchartDiagram::Edge &edge = diagram->edges[e];
+        edge.points.clear();
+
+        if (edge.from == edge.to) {
+            // Small loop on the side of the node
+            QRectF r = diagram->nodes[edge.from].rect;
+            qreal offset = r.height() / 4;
+            edge.points << QPointF(r.right(), r.center().y() - offset)
+                        << QPointF(r.right() + 20, r.center().y() - offset)
+                        << QPointF(r.right() + 20, r.center().y() + offset)
+                        << QPointF(r.right(), r.center().y() + offset);
+            edge.labelPos = QPointF(r.right() + 24 + labelSize(fm, edge.label).width() / 2,
+                                    r.center().y());
+            continue;
+        }
+
+        const QVector<int> &chain = chains[e];
+        QVector<QPointF> points;
+        for (int u : chain) points.append(centre[u]);
+        points.first() = clipToBorder(diagram->nodes[chain.first()], points[1]);
+        points.last() = clipToBorder(diagram->nodes[chain.last()], points[points.size() - 2]);
+        if (reversed[e]) std::reverse(points.begin(), points.end());
+        edge.points = points;
+
+        int mid = points.size() / 2;
+        edge.labelPos = points.size() % 2 == 1 ? points[mid] : (points[mid - 1] + points[mid]) / 2;
+    }
+
+    // Move everything to start at the margin
+    QRectF bounds;
+    for (const FlowchartDiagram::Node &node : diagram->nodes) {
+        bounds = bounds.united(node.rect);
+    }
+    for (const FlowchartDiagram::Edge &edge : diagram->edges) {
+        for (const QPointF &p : edge.points) {
+            bounds = bounds.united(QRectF(p, QSizeF(1, 1)));
+        }
+        if (!edge.label.isEmpty()) {
+            QRectF label(QPointF(), labelSize(fm, edge.label));
+            label.moveCenter(edge.labelPos);
+            bounds = bounds.united(label);
+        }
+    }
+
+    const QPointF shift = QPointF(MARGIN, MARGIN) - bounds.topLeft();
+    for (FlowchartDiagram::Node &node : diagram->nodes) {
+        node.rect.translate(shift);
+    }
+    for (FlowchartDiagram::Edge &edge : diagram->edges) {
+        for (QPointF &p : edge.points) p += shift;
+        edge.labelPos += shift;
+    }
+    diagram->size = bounds.size() + QSizeF(2 * MARGIN, 2 * MARGIN);
+}
+
+// ---------------------------------------------------------------------------
+// Sequence layout
+// ---------------------------------------------------------------------------
+
+void DiagramLayout::layout(SequenceDiagram *diagram, const QFont &font)
+{
+    QFontMetricsF fm(font);
+    const int count = diagram->participants.size();
+
+    QVector<qreal> widths;
+    qreal boxHeight = 0;
+    for (const SequenceDiagram::Participant &participant : diagram->participants) {
+        QSizeF text = labelSize(fm, participant.label);
+        widths.append(text.width() + 2 * NODE_PADDING);
+        boxHeight = qMax(boxHeight, text.height() + NODE_PADDING);
+    }
+
+    // Gap between neighbouring lifelines, wide enough for the messages across it
+    QVector<qreal> gaps(qMax(0, count - 1), 0);
+    for (int i = 0; i + 1 < count; ++i) {
+        gaps[i] = (widths[i] + widths[i + 1]) / 2 + NODE_SPACING;
+    }
+    qreal selfOverhang = 0;
+    for (const SequenceDiagram::Message &message : diagram->messages) {
+        qreal width = labelSize(fm, message.text).width() + 2 * NODE_PADDING;
+        int first = qMin(message.from, message.to);
+        int last = qMax(message.from, message.to);
+        if (first == last) {
+            // Self messages loop out to the right
+            if (first < count - 1) gaps[first] = qMax(gaps[first], width + 30);
+            else selfOverhang = qMax(selfOverhang, width + 30);
+            continue;
+        }
+        for (int i = first; i < last; ++i) {
+            gaps[i] = qMax(gaps[i], width / (last - first));
+        }
+    }
+
+    qreal centre = MARGIN + (count > 0 ? widths[0] / 2 : 0);
+    qreal right = MARGIN;
+    for (int i = 0; i < count; ++i) {
+        if (i > 0) centre += gaps[i - 1];
+        QRectF box(0, 0, widths[i], boxHeight);
+        box.moveCenter(QPointF(centre, MARGIN + boxHeight / 2));
+        diagram->participants[i].box = box;
+        right = qMax(right, box.right());
+    }
+    if (count > 0) right = qMax(right, centre + selfOverhang);
+
+    // One row per message; self messages need a little more room
+    qreal y = MARGIN + boxHeight + MESSAGE_SPACING * 0.8;
+    for (SequenceDiagram::Message &message : diagram->messages) {
+        message.y = y;
+        y += MESSAGE_SPACING;
+        if (message.from == message.to) y += MESSAGE_SPACING / 2;
+    }
+    diagram->lifelineBottom = y - MESSAGE_SPACING * 0.2;
+
+    diagram->size = QSizeF(right + MARGIN, diagram->lifelineBottom + MARGIN);
+}
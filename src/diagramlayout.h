@@ -0,0 +1,117 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * diagramlayout.h - Native layout for Mermaid flowcharts and sequence diagrams
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#ifndef DIAGRAMLAYOUT_H
+#define DIAGRAMLAYOUT_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QPointF>
+#include <QRectF>
+#include <QSizeF>
+#include <QFont>
+
+/**
+ * @brief A flowchart (or mind map) as nodes and edges, with its layout.
+ *
+ * parseFlowchart()/parseMindmap() fill in the graph; DiagramLayout::layout()
+ * fills in rect, points and size.
+ */
+struct FlowchartDiagram {
+    enum Direction { TopDown, BottomUp, LeftRight, RightLeft };
+    enum Shape { Box, Rounded, Stadium, Diamond, Circle };
+    enum LineStyle { Solid, Dotted, Thick };
+
+    struct Node {
+        QString id;
+        QString label;
+        Shape shape = Box;
+        QRectF rect;
+    };
+
+    struct Edge {
+        int from = -1;
+        int to = -1;
+        QString label;
+        LineStyle style = Solid;
+        bool arrow = true;
+        QVector<QPointF> points;  // From the source border to the target border
+        QPointF labelPos;         // Centre of the label
+    };
+
+    Direction direction = TopDown;
+    QVector<Node> nodes;
+    QVector<Edge> edges;
+    QSizeF size;
+};
+
+/**
+ * @brief A sequence diagram as participants and messages, with its layout.
+ */
+struct SequenceDiagram {
+    struct Participant {
+        QString id;
+        QString label;
+        QRectF box;               // Head box; the lifeline runs down from it
+    };
+
+    struct Message {
+        int from = -1;
+        int to = -1;
+        QString text;
+        bool dashed = false;
+        bool arrow = true;
+        qreal y = 0;              // Height of the arrow
+    };
+
+    QVector<Participant> participants;
+    QVector<Message> messages;
+    qreal lifelineBottom = 0;
+    QSizeF size;
+};
+
+/**
+ * @brief The DiagramLayout class parses Mermaid code and lays it out natively.
+ *
+ * Flowcharts use a layered (Sugiyama) layout: cycles are broken by reversing
+ * back edges, nodes are assigned to layers by longest path, edges spanning
+ * several layers get dummy nodes, the order within each layer is improved by
+ * barycenter sweeps, and nodes are then pulled towards their neighbours
+ * without overlapping. Mind maps are laid out the same way as a left-to-right
+ * tree. Sequence diagrams are a simple timeline: one column per participant,
+ * one row per message.
+ *
+ * All sizes are in pixels for the given font.
+ */
+class DiagramLayout
+{
+public:
+    static bool parseFlowchart(const QString &code, FlowchartDiagram *diagram);
+    static bool parseMindmap(const QString &code, FlowchartDiagram *diagram);
+    static bool parseSequence(const QString &code, SequenceDiagram *diagram);
+
+    static void layout(FlowchartDiagram *diagram, const QFont &font);
+    static void layout(SequenceDiagram *diagram, const QFont &font);
+
+    // Spacing, in pixels
+    static const int MARGIN = 24;
+    static const int NODE_PADDING = 14;
+    static const int NODE_SPACING = 36;    // Between nodes in a layer
+    static const int LAYER_SPACING = 64;   // Between layers
+    static const int MESSAGE_SPACING = 44; // Between messages
+    static const int MAX_LABEL_WIDTH = 220; // Longer labels wrap
+
+private:
+    static int nodeIndex(FlowchartDiagram *diagram, const QString &id);
+    static QStringList splitStatements(const QString &code);
+    static QPointF clipToBorder(const FlowchartDiagram::Node &node, const QPointF &toward);
+};
+
+#endif // DIAGRAMLAYOUT_H
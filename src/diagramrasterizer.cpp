@@ -0,0 +1,322 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * diagramrasterizer.cpp - Draw laid-out diagrams into e-ink friendly images
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#include "diagramrasterizer.h"
+#include <QPainter>
+#include <QPainterPath>
+#include <QFontMetricsF>
+#include <QPolygonF>
+#include <QtMath>
+
+namespace {
+
+const qreal LINE_WIDTH = 2;
+const qreal THICK_LINE_WIDTH = 4;
+const qreal ARROW_LENGTH = 12;
+
+} // namespace
+
+bool DiagramRasterizer::canRender(const QString &mermaidCode)
+{
+    QString code = mermaidCode.trimmed();
+    return code.startsWith("graph ") || code.startsWith("flowchart ")
+        || code.startsWith("sequenceDiagram") || code.startsWith("mindmap");
+}
+
+QImage DiagramRasterizer::render(const QString &mermaidCode, Depth depth)
+{
+    const bool antialias = depth == Gray16;
+
+    QFont font("Noto Sans");
+    font.setStyleHint(QFont::SansSerif);
+    font.setPixelSize(FONT_PIXEL_SIZE);
+    if (!antialias) {
+        font.setStyleStrategy(QFont::NoAntialias);
+    }
+
+    QString code = mermaidCode.trimmed();
+    QImage image;
+
+    if (code.startsWith("sequenceDiagram")) {
+        SequenceDiagram diagram;
+        if (DiagramLayout::parseSequence(code, &diagram)) {
+            DiagramLayout::layout(&diagram, font);
+            image = paint(diagram, font, antialias);
+        }
+    } else if (code.startsWith("mindmap")) {
+        FlowchartDiagram diagram;
+        if (DiagramLayout::parseMindmap(code, &diagram)) {
+            DiagramLayout::layout(&diagram, font);
+            image = paint(diagram, font, antialias);
+        }
+    } else if (canRender(code)) {
+        FlowchartDiagram diagram;
+        if (DiagramLayout::parseFlowchart(code, &diagram)) {
+            DiagramLayout::layout(&diagram, font);
+            image = paint(diagram, font, antialias);
+        }
+    }
+
+    return image.isNull() ? image : quantize(image, depth);
+}
+
+qreal DiagramRasterizer::scaleFor(const QSizeF &size)
+{
+    qreal longest = qMax(size.width(), size.height());
+    return longest > MAX_SIDE ? MAX_SIDE / longest : 1.0;
+}
+
+void DiagramRasterizer::setUpPainter(QPainter *painter, const QFont &font, qreal scale, bool antialias)
+{
+    painter->setRenderHint(QPainter::Antialiasing, antialias);
+    painter->setRenderHint(QPainter::TextAntialiasing, antialias);
+    painter->scale(scale, scale);
+    painter->setFont(font);
+    painter->setPen(QPen(Qt::black, LINE_WIDTH, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+    painter->setBrush(Qt::white);
+}
+
+QImage DiagramRasterizer::paint(const FlowchartDiagram &diagram, const QFont &font, bool antialias)
+{
+    const qreal scale = scaleFor(diagram.size);
+    QImage image(qCeil(diagram.size.width() * scale), qCeil(diagram.size.height() * scale),
+                 QImage::Format_Grayscale8);
+    image.fill(Qt::white);
+
+    QPainter painter(&image);
+    setUpPainter(&painter, font, scale, antialias);
+
+    // Edges first, so nodes cover their ends
+    for (const FlowchartDiagram::Edge &edge : diagram.edges) {
+        if (edge.points.size() < 2) continue;
+
+        QPen pen = painter.pen();
+        pen.setWidthF(edge.style == FlowchartDiagram::Thick ? THICK_LINE_WIDTH : LINE_WIDTH);
+        pen.setStyle(edge.style == FlowchartDiagram::Dotted ? Qt::DashLine : Qt::SolidLine);
+        painter.setPen(pen);
+        painter.setBrush(Qt::NoBrush);
+
+        QVector<QPointF> points = edge.points;
+        if (edge.arrow) {
+            // Stop the line at the base of the arrow head
+            QPointF tip = points.last();
+            QPointF from = points[points.size() - 2];
+            QLineF last(tip, from);
+            if (last.length() > ARROW_LENGTH) {
+                last.setLength(ARROW_LENGTH);
+                points.last() = last.p2();
+            }
+        }
+        painter.drawPolyline(points.constData(), points.size());
+
+        pen.setStyle(Qt::SolidLine);
+        painter.setPen(pen);
+        if (edge.arrow) {
+            drawArrowHead(&painter, edge.points[edge.points.size() - 2], edge.points.last());
+        }
+        if (!edge.label.isEmpty()) {
+            drawLabel(&painter, edge.labelPos, edge.label, true);
+        }
+    }
+
+    painter.setPen(QPen(Qt::black, LINE_WIDTH));
+    for (const FlowchartDiagram::Node &node : diagram.nodes) {
+        painter.setBrush(Qt::white);
+        const QRectF r = node.rect;
+
+        switch (node.shape) {
+        case FlowchartDiagram::Box:
+            painter.drawRect(r);
+            break;
+        case FlowchartDiagram::Rounded:
+            painter.drawRoundedRect(r, 8, 8);
+            break;
+        case FlowchartDiagram::Stadium:
+            painter.drawRoundedRect(r, r.height() / 2, r.height() / 2);
+            break;
+        case FlowchartDiagram::Diamond: {
+            QPolygonF diamond;
+            diamond << QPointF(r.center().x(), r.top()) << QPointF(r.right(), r.center().y())
+                    << QPointF(r.center().x(), r.bottom()) << QPointF(r.left(), r.center().y());
+            painter.drawPolygon(diamond);
+            break;
+        }
+        case FlowchartDiagram::Circle:
+            painter.drawEllipse(r);
+            break;
+        }
+
+        drawLabel(&painter, r.center(), node.label, false);
+    }
+
+    painter.end();
+    return image;
+}
+
+QImage DiagramRasterizer::paint(const SequenceDiagram &diagram, const QFont &font, bool antialias)
+{
+    const qreal scale = scaleFor(diagram.size);
+    QImage image(qCeil(diagram.size.width() * scale), qCeil(diagram.size.height() * scale),
+                 QImage::Format_Grayscale8);
+    image.fill(Qt::white);
+
+    QPainter painter(&image);
+    setUpPainter(&painter, font, scale, antialias);
+
+    // Participants and their lifelines
+    for (const SequenceDiagram::Participant &participant : diagram.participants) {
+        const QRectF box = participant.box;
+        painter.setPen(QPen(Qt::black, LINE_WIDTH, Qt::DashLine));
+        painter.drawLine(QPointF(box.center().x(), box.bottom()),
+                         QPointF(box.center().x(), diagram.lifelineBottom));
+
+        painter.setPen(QPen(Qt::black, LINE_WIDTH));
+        painter.setBrush(Qt::white);
+        painter.drawRect(box);
+        drawLabel(&painter, box.center(), participant.label, false);
+    }
+
+    // Messages, top to bottom
+    const QFontMetricsF fm(font);
+    for (const SequenceDiagram::Message &message : diagram.messages) {
+        const qreal fromX = diagram.participants[message.from].box.center().x();
+        const qreal toX = diagram.participants[message.to].box.center().x();
+        const qreal textHeight = fm.height();
+
+        painter.setPen(QPen(Qt::black, LINE_WIDTH, message.dashed ? Qt::DashLine : Qt::SolidLine));
+        painter.setBrush(Qt::NoBrush);
+
+        QPointF tipFrom, tip;
+        if (message.from == message.to) {
+            const qreal loopWidth = 30;
+            const qreal loopDrop = DiagramLayout::MESSAGE_SPACING / 2.0;
+            QPolygonF loop;
+            loop << QPointF(fromX, message.y) << QPointF(fromX + loopWidth, message.y)
+                 << QPointF(fromX + loopWidth, message.y + loopDrop)
+                 << QPointF(fromX + (message.arrow ? ARROW_LENGTH : 0), message.y + loopDrop);
+            painter.drawPolyline(loop);
+            tipFrom = QPointF(fromX + loopWidth, message.y + loopDrop);
+            tip = QPointF(fromX, message.y + loopDrop);
+
+            qreal width = fm.boundingRect(message.text).width();
+            drawLabel(&painter, QPointF(fromX + loopWidth + 8 + width / 2,
+                                        message.y + loopDrop / 2), message.text, false);
+        } else {
+            const qreal direction = toX > fromX ? 1 : -1;
+            const qreal end = message.arrow ? toX - direction * ARROW_LENGTH : toX;
+            painter.drawLine(QPointF(fromX, message.y), QPointF(end, message.y));
+            tipFrom = QPointF(fromX, message.y);
+            tip = QPointF(toX, message.y);
+
+            drawLabel(&painter, QPointF((fromX + toX) / 2, message.y - textHeight / 2 - 4),
+                      message.text, false);
+        }
+
+        if (message.arrow) {
+            painter.setPen(QPen(Qt::black, LINE_WIDTH));
+            drawArrowHead(&painter, tipFrom, tip);
+        }
+    }
+
+    painter.end();
+    return image;
+}
+
+void DiagramRasterizer::drawArrowHead(QPainter *painter, const QPointF &from, const QPointF &tip)
+{
+    QLineF shaft(tip, from);
+    if (qFuzzyIsNull(shaft.length())) return;
+
+    QLineF left = shaft;
+    left.setLength(ARROW_LENGTH);
+    left.setAngle(shaft.angle() + 25);
+    QLineF right = shaft;
+    right.setLength(ARROW_LENGTH);
+    right.setAngle(shaft.angle() - 25);
+
+    QPolygonF head;
+    head << tip << left.p2() << right.p2();
+
+    painter->save();
+    painter->setBrush(Qt::black);
+    painter->drawPolygon(head);
+    painter->restore();
+}
+
+void DiagramRasterizer::drawLabel(QPainter *painter, const QPointF &centre, const QString &text,
+                                  bool background)
+{
+    if (text.isEmpty()) return;
+
+    const int flags = Qt::AlignCenter | Qt::TextWordWrap;
+    QRectF bounds = painter->fontMetrics().boundingRect(
+        QRect(0, 0, DiagramLayout::MAX_LABEL_WIDTH, 10000), flags, text);
+    bounds.moveCenter(centre);
+
+    painter->save();
+    if (background) {
+        // Keep edge labels readable where they sit on the line
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(Qt::white);
+        painter->drawRect(bounds.adjusted(-3, -1, 3, 1));
+    }
+    painter->setPen(Qt::black);
+    painter->drawText(bounds, flags, text);
+    painter->restore();
+}
+
+QImage DiagramRasterizer::quantize(const QImage &image, Depth depth)
+{
+    if (depth == Mono) {
+        return image.convertToFormat(QImage::Format_Mono, Qt::MonoOnly | Qt::ThresholdDither);
+    }
+
+    // Snap to the 16 levels the panel can show, so nothing is dithered later
+    QImage result = image;
+    for (int y = 0; y < result.height(); ++y) {
+        uchar *line = result.scanLine(y);
+        for (int x = 0; x < result.width(); ++x) {
+            line[x] = static_cast<uchar>(((line[x] + 8) / 17) * 17);
+        }
+    }
+    return result;
+}
+
+QImage DiagramRasterizer::dither(const QImage &image, Depth depth)
+{
+    QImage gray = image.convertToFormat(QImage::Format_Grayscale8);
+    const int levels = depth == Mono ? 2 : 16;
+    const int step = 255 / (levels - 1);
+    const int width = gray.width();
+
+    // Error carried to this row and the next, with one pixel of slack each side
+    QVector<int> current(width + 2, 0), next(width + 2, 0);
+
+    for (int y = 0; y < gray.height(); ++y) {
+        uchar *line = gray.scanLine(y);
+        for (int x = 0; x < width; ++x) {
+            int value = qBound(0, line[x] + current[x + 1] / 16, 255);
+            int snapped = ((value + step / 2) / step) * step;
+            int error = value - snapped;
+            line[x] = static_cast<uchar>(snapped);
+
+            current[x + 2] += error * 7;
+            next[x] += error * 3;
+            next[x + 1] += error * 5;
+            next[x + 2] += error;
+        }
+        current.swap(next);
+        next.fill(0);
+    }
+
+    if (depth == Mono) {
+        return gray.convertToFormat(QImage::Format_Mono, Qt::MonoOnly | Qt::ThresholdDither);
+    }
+    return gray;
+}
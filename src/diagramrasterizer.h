@@ -0,0 +1,61 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * diagramrasterizer.h - Draw laid-out diagrams into e-ink friendly images
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#ifndef DIAGRAMRASTERIZER_H
+#define DIAGRAMRASTERIZER_H
+
+#include "diagramlayout.h"
+#include <QImage>
+#include <QString>
+
+class QPainter;
+
+/**
+ * @brief The DiagramRasterizer class renders Mermaid code without a browser.
+ *
+ * Flowcharts, sequence diagrams and mind maps are laid out by DiagramLayout
+ * and painted in black on white with 2px lines, which stay crisp on e-ink.
+ * The result is quantised to the display's 16 gray levels, or to pure black
+ * and white for the fast 1-bit waveform. Other diagram types are not
+ * supported; render() then returns a null image.
+ *
+ * Rendering takes milliseconds and needs neither the network nor Node.js.
+ */
+class DiagramRasterizer
+{
+public:
+    enum Depth {
+        Gray16, // 16 gray levels, antialiased
+        Mono    // Black and white only
+    };
+
+    static bool canRender(const QString &mermaidCode);
+    static QImage render(const QString &mermaidCode, Depth depth = Gray16);
+
+    /**
+     * @brief dither - Convert any image to depth with Floyd-Steinberg
+     *        error diffusion, so shaded fills survive the reduced palette
+     */
+    static QImage dither(const QImage &image, Depth depth = Gray16);
+
+    static const int FONT_PIXEL_SIZE = 22;
+    static const int MAX_SIDE = 4096;     // Larger diagrams are scaled down
+
+private:
+    static QImage paint(const FlowchartDiagram &diagram, const QFont &font, bool antialias);
+    static QImage paint(const SequenceDiagram &diagram, const QFont &font, bool antialias);
+    static qreal scaleFor(const QSizeF &size);
+    static void setUpPainter(QPainter *painter, const QFont &font, qreal scale, bool antialias);
+    static void drawArrowHead(QPainter *painter, const QPointF &from, const QPointF &tip);
+    static void drawLabel(QPainter *painter, const QPointF &centre, const QString &text,
+                          bool background);
+    static QImage quantize(const QImage &image, Depth depth);
+};
+
+#endif // DIAGRAMRASTERIZER_H
@@ -0,0 +1,135 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * diskcache.cpp - Size-bounded, content-addressed file cache implementation
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#include "diskcache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+DiskCache::DiskCache()
+    : m_budget(DEFAULT_MAX_BYTES)
+{
+}
+
+void DiskCache::setDirectory(const QString &path, const QString &suffix)
+{
+    m_directory = path;
+    m_suffix = suffix;
+    m_budget.clear();
+
+    QDir dir(path);
+    dir.mkpath(".");
+
+    const QFileInfoList files = dir.entryInfoList({"*." + suffix}, QDir::Files);
+    for (const QFileInfo &info : files) {
+        m_budget.set(info.completeBaseName().toLatin1(), info.size(),
+                     info.lastModified().toMSecsSinceEpoch());
+    }
+
+    trimToBudget();
+}
+
+QString DiskCache::directory() const
+{
+    return m_directory;
+}
+
+QByteArray DiskCache::keyFor(const QStringList &parts)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    for (const QString &part : parts) {
+        hash.addData(part.toUtf8());
+        hash.addData("\0", 1);
+    }
+    return hash.result().toHex();
+}
+
+QString DiskCache::pathFor(const QByteArray &key) const
+{
+    return m_directory + "/" + key + "." + m_suffix;
+}
+
+bool DiskCache::contains(const QByteArray &key) const
+{
+    return m_budget.contains(key);
+}
+
+bool DiskCache::lookup(const QByteArray &key, QByteArray *data)
+{
+    if (!m_budget.contains(key)) return false;
+
+    QFile file(pathFor(key));
+    if (!file.open(QIODevice::ReadWrite)) {
+        // Deleted behind our back
+        m_budget.remove(key);
+        return false;
+    }
+
+    *data = file.readAll();
+
+    QDateTime now = QDateTime::currentDateTime();
+    file.setFileTime(now, QFileDevice::FileModificationTime);
+    m_budget.touch(key, now.toMSecsSinceEpoch());
+    return true;
+}
+
+void DiskCache::store(const QByteArray &key, const QByteArray &data)
+{
+    if (m_directory.isEmpty() || data.size() > m_budget.maxBytes()) return;
+
+    QSaveFile file(pathFor(key));
+    if (!file.open(QIODevice::WriteOnly)) return;
+    file.write(data);
+    if (!file.commit()) return;
+
+    m_budget.set(key, data.size(), QDateTime::currentMSecsSinceEpoch());
+    trimToBudget();
+}
+
+void DiskCache::remove(const QByteArray &key)
+{
+    if (!m_budget.contains(key)) return;
+
+    QFile::remove(pathFor(key));
+    m_budget.remove(key);
+}
+
+void DiskCache::clear()
+{
+    for (const QByteArray &key : m_budget.keys()) {
+        QFile::remove(pathFor(key));
+    }
+    m_budget.clear();
+}
+
+qint64 DiskCache::bytes() const
+{
+    return m_budget.bytes();
+}
+
+qint64 DiskCache::maxBytes() const
+{
+    return m_budget.maxBytes();
+}
+
+void DiskCache::setMaxBytes(qint64 bytes)
+{
+    m_budget.setMaxBytes(bytes);
+    trimToBudget();
+}
+
+void DiskCache::trimToBudget()
+{
+    for (const QByteArray &key : m_budget.overBudget()) {
+        remove(key);
+    }
+}
@@ -0,0 +1,72 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * diskcache.h - Size-bounded, content-addressed file cache
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#ifndef DISKCACHE_H
+#define DISKCACHE_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include "cachebudget.h"
+
+/**
+ * @brief The DiskCache class stores blobs in a directory, one file per key.
+ *
+ * Keys are SHA-256 hashes of whatever identifies the value (see keyFor()),
+ * so the file name is the key, as in the Mermaid cache. An in-memory index of
+ * sizes and last-use times is built when the directory is set; the least
+ * recently used entries are evicted once the total size exceeds maxBytes().
+ * Use times are kept in the file modification times so the order survives
+ * a restart.
+ */
+class DiskCache
+{
+public:
+    DiskCache();
+
+    /**
+     * @brief setDirectory - Use (and create) path, indexing what is already there
+     */
+    void setDirectory(const QString &path, const QString &suffix);
+    QString directory() const;
+
+    /**
+     * @brief keyFor - Hash the parts into a key; the parts are kept apart so
+     *        ("ab", "c") and ("a", "bc") differ
+     */
+    static QByteArray keyFor(const QStringList &parts);
+
+    bool contains(const QByteArray &key) const;
+
+    /**
+     * @brief lookup - Read the value for key into data and mark it as used
+     * @return false on a miss or if the file could not be read
+     */
+    bool lookup(const QByteArray &key, QByteArray *data);
+    void store(const QByteArray &key, const QByteArray &data);
+    void remove(const QByteArray &key);
+    void clear();
+
+    // Size accounting
+    qint64 bytes() const;
+    qint64 maxBytes() const;
+    void setMaxBytes(qint64 bytes);
+
+private:
+    QString pathFor(const QByteArray &key) const;
+    void trimToBudget();
+
+    QString m_directory;
+    QString m_suffix;
+    CacheBudget<QByteArray> m_budget;
+
+    static const qint64 DEFAULT_MAX_BYTES = 8 * 1024 * 1024;
+};
+
+#endif // DISKCACHE_H
@@ -0,0 +1,223 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * documentlistmodel.cpp - List model of the documents and their metadata
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#include "documentlistmodel.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QSaveFile>
+#include <algorithm>
+
+DocumentListModel::DocumentListModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int DocumentListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+QVariant DocumentListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() < 0 || index.row() >= m_rows.size()) {
+        return QVariant();
+    }
+
+    const DocumentInfo &document = m_rows.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+    case NameRole:
+        return document.name;
+    case ModifiedRole:
+        return QDateTime::fromMSecsSinceEpoch(document.modified);
+    case SizeRole:
+        return document.size;
+    case WordCountRole:
+        return document.wordCount;
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> DocumentListModel::roleNames() const
+{
+    return {
+        { NameRole, "name" },
+        { ModifiedRole, "modified" },
+        { SizeRole, "size" },
+        { WordCountRole, "wordCount" }
+    };
+}
+
+bool DocumentListModel::lessThan(const DocumentInfo &a, const DocumentInfo &b)
+{
+    // Newest first, then by name
+    if (a.modified != b.modified) return a.modified > b.modified;
+    return a.name < b.name;
+}
+
+int DocumentListModel::insertPosition(const DocumentInfo &document) const
+{
+    auto it = std::lower_bound(m_rows.constBegin(), m_rows.constEnd(), document, lessThan);
+    return int(it - m_rows.constBegin());
+}
+
+int DocumentListModel::rowOf(const QString &name) const
+{
+    auto it = m_modified.constFind(name);
+    if (it == m_modified.constEnd()) return -1;
+
+    DocumentInfo key;
+    key.name = name;
+    key.modified = it.value();
+    int row = insertPosition(key);
+    return row < m_rows.size() && m_rows.at(row).name == name ? row : -1;
+}
+
+void DocumentListModel::reset(const QVector<DocumentInfo> &documents)
+{
+    beginResetModel();
+    m_rows = documents;
+    std::sort(m_rows.begin(), m_rows.end(), lessThan);
+    m_modified.clear();
+    for (const DocumentInfo &document : m_rows) {
+        m_modified.insert(document.name, document.modified);
+    }
+    endResetModel();
+    emit countChanged();
+}
+
+void DocumentListModel::upsert(const DocumentInfo &document)
+{
+    int row = rowOf(document.name);
+    if (row < 0) {
+        int position = insertPosition(document);
+        beginInsertRows(QModelIndex(), position, position);
+        m_rows.insert(position, document);
+        m_modified.insert(document.name, document.modified);
+        endInsertRows();
+        emit countChanged();
+        return;
+    }
+
+    if (m_rows.at(row).modified != document.modified) {
+        // Its place in the order may change; work out where it lands once
+        // taken out of its current row
+        int position = insertPosition(document);
+        int target = position > row ? position - 1 : position;
+
+        if (target != row) {
+            int destination = target > row ? target + 1 : target;
+            beginMoveRows(QModelIndex(), row, row, QModelIndex(), destination);
+            m_rows.remove(row);
+            m_rows.insert(target, document);
+            m_modified.insert(document.name, document.modified);
+            endMoveRows();
+            row = target;
+        } else {
+            m_rows[row] = document;
+            m_modified.insert(document.name, document.modified);
+        }
+    } else {
+        m_rows[row] = document;
+    }
+
+    QModelIndex changed = index(row);
+    emit dataChanged(changed, changed);
+}
+
+void DocumentListModel::remove(const QString &name)
+{
+    int row = rowOf(name);
+    if (row < 0) return;
+
+    beginRemoveRows(QModelIndex(), row, row);
+    m_rows.remove(row);
+    m_modified.remove(name);
+    endRemoveRows();
+    emit countChanged();
+}
+
+void DocumentListModel::rename(const QString &oldName, const QString &newName)
+{
+    int row = rowOf(oldName);
+    if (row < 0) return;
+
+    DocumentInfo document = m_rows.at(row);
+    remove(oldName);
+    document.name = newName;
+    upsert(document);
+}
+
+bool DocumentListModel::contains(const QString &name) const
+{
+    return m_modified.contains(name);
+}
+
+DocumentInfo DocumentListModel::document(const QString &name) const
+{
+    int row = rowOf(name);
+    return row >= 0 ? m_rows.at(row) : DocumentInfo();
+}
+
+QStringList DocumentListModel::names() const
+{
+    QStringList names;
+    names.reserve(m_rows.size());
+    for (const DocumentInfo &document : m_rows) {
+        names.append(document.name);
+    }
+    return names;
+}
+
+bool DocumentListModel::load(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_15);
+
+    quint32 magic, version;
+    qint32 count;
+    in >> magic >> version >> count;
+    if (magic != FILE_MAGIC || version != FILE_VERSION || count < 0) return false;
+    // A corrupt count must not allocate or loop beyond what the file holds
+    if (qint64(count) * MIN_ENTRY_BYTES > file.size() - file.pos()) return false;
+
+    QVector<DocumentInfo> documents;
+    documents.reserve(count);
+    for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        DocumentInfo document;
+        qint32 wordCount;
+        in >> document.name >> document.modified >> document.size >> wordCount;
+        document.wordCount = wordCount;
+        documents.append(document);
+    }
+    if (in.status() != QDataStream::Ok) return false;
+
+    reset(documents);
+    return true;
+}
+
+bool DocumentListModel::save(const QString &path) const
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << FILE_MAGIC << FILE_VERSION << qint32(m_rows.size());
+    for (const DocumentInfo &document : m_rows) {
+        out << document.name << document.modified << document.size << qint32(document.wordCount);
+    }
+
+    return file.commit();
+}
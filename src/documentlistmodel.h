@@ -0,0 +1,89 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * documentlistmodel.h - List model of the documents and their metadata
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#ifndef DOCUMENTLISTMODEL_H
+#define DOCUMENTLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QVector>
+
+/**
+ * @brief Metadata of one document, as listed and cached.
+ */
+struct DocumentInfo {
+    QString name;          // Without the extension
+    qint64 modified = 0;   // msecs since epoch
+    qint64 size = 0;
+    int wordCount = -1;    // -1 until the document has been read
+};
+
+/**
+ * @brief The DocumentListModel class lists the documents, newest first.
+ *
+ * Changes arrive one document at a time through upsert(), remove() and
+ * rename(), and are reported as single-row inserts, moves, updates and
+ * removals, so views update in place instead of rebuilding.
+ *
+ * The metadata can be saved to and loaded from a cache file, so the list is
+ * complete at start-up before a single document has been stat'ed.
+ */
+class DocumentListModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+
+public:
+    enum Roles {
+        NameRole = Qt::UserRole + 1,
+        ModifiedRole,
+        SizeRole,
+        WordCountRole
+    };
+
+    explicit DocumentListModel(QObject *parent = nullptr);
+
+    // QAbstractListModel
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    // Maintenance
+    void reset(const QVector<DocumentInfo> &documents);
+    void upsert(const DocumentInfo &document);
+    void remove(const QString &name);
+    void rename(const QString &oldName, const QString &newName);
+
+    bool contains(const QString &name) const;
+    DocumentInfo document(const QString &name) const;
+    QStringList names() const;
+
+    // Metadata cache
+    bool load(const QString &path);
+    bool save(const QString &path) const;
+
+signals:
+    void countChanged();
+
+private:
+    int rowOf(const QString &name) const;
+    int insertPosition(const DocumentInfo &document) const;
+    static bool lessThan(const DocumentInfo &a, const DocumentInfo &b);
+
+    QVector<DocumentInfo> m_rows;          // Sorted by lessThan
+    QHash<QString, qint64> m_modified;     // Name -> modified, to find a row
+
+    static const quint32 FILE_MAGIC = 0x4757444c; // "GWDL"
+    static const quint32 FILE_VERSION = 1;
+    static const int MIN_ENTRY_BYTES = 24; // Empty name, modified, size and word count
+};
+
+#endif // DOCUMENTLISTMODEL_H
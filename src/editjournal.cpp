@@ -0,0 +1,202 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * editjournal.cpp - Append-only journal of unsaved edits
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#include "editjournal.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QDebug>
+#include <fcntl.h>
+#include <unistd.h>
+
+EditJournal::EditJournal()
+    : m_baseSize(0)
+    , m_baseModified(0)
+    , m_fileSize(0)
+{
+}
+
+EditJournal::~EditJournal()
+{
+    flush();
+}
+
+QString EditJournal::journalPath(const QString &documentPath)
+{
+    QFileInfo fileInfo(documentPath);
+    return fileInfo.path() + "/." + fileInfo.fileName() + ".journal";
+}
+
+void EditJournal::rebase()
+{
+    QFileInfo fileInfo(m_documentPath);
+    m_baseSize = fileInfo.exists() ? fileInfo.size() : 0;
+    m_baseModified = fileInfo.exists() ? fileInfo.lastModified().toMSecsSinceEpoch() : 0;
+}
+
+QList<EditJournal::Edit> EditJournal::open(const QString &documentPath)
+{
+    close();
+    m_documentPath = documentPath;
+    m_path = journalPath(documentPath);
+    rebase();
+
+    QList<Edit> edits;
+    QFile file(m_path);
+    if (!file.exists() || !file.open(QIODevice::ReadOnly)) {
+        return edits; // No journal: nothing was left unsaved
+    }
+
+    const QByteArray data = file.readAll();
+    file.close();
+    {
+        QDataStream header(data);
+        quint32 magic = 0, version = 0;
+        qint64 baseSize = -1, baseModified = -1;
+        header >> magic >> version >> baseSize >> baseModified;
+        if (magic != FILE_MAGIC || version != FILE_VERSION
+                || baseSize != m_baseSize || baseModified != m_baseModified) {
+            // Written against another version of the document
+            file.remove();
+            return edits;
+        }
+    }
+
+    int offset = HEADER_SIZE;
+    while (offset + RECORD_HEADER_SIZE <= data.size()) {
+        QDataStream frame(data.mid(offset, RECORD_HEADER_SIZE));
+        quint32 length;
+        quint16 checksum;
+        frame >> length >> checksum;
+        if (length > quint32(MAX_RECORD_SIZE)
+                || offset + RECORD_HEADER_SIZE + int(length) > data.size()) {
+            break;
+        }
+
+        const char *payload = data.constData() + offset + RECORD_HEADER_SIZE;
+        if (qChecksum(payload, length) != checksum) break;
+
+        QDataStream in(QByteArray::fromRawData(payload, int(length)));
+        Edit edit;
+        qint32 position, removed;
+        in >> position >> removed >> edit.inserted;
+        if (in.status() != QDataStream::Ok) break;
+        edit.position = position;
+        edit.removed = removed;
+        edits.append(edit);
+
+        offset += RECORD_HEADER_SIZE + int(length);
+    }
+
+    if (offset < data.size()) {
+        // The tail was torn by a crash; new records go after the last good one
+        qWarning() << "Dropping" << data.size() - offset << "damaged bytes from" << m_path;
+        if (!QFile::resize(m_path, offset)) {
+            // Appending after the damage would hide every later record;
+            // the next flush rewrites the journal from the good ones
+            m_pending = data.mid(HEADER_SIZE, offset - HEADER_SIZE);
+            m_fileSize = 0;
+            return edits;
+        }
+    }
+    m_fileSize = offset;
+
+    return edits;
+}
+
+void EditJournal::close()
+{
+    flush();
+    m_documentPath.clear();
+    m_path.clear();
+    m_fileSize = 0;
+    m_pending.clear();
+}
+
+bool EditJournal::isOpen() const
+{
+    return !m_path.isEmpty();
+}
+
+void EditJournal::append(int position, int removed, const QString &inserted)
+{
+    if (!isOpen() || (removed == 0 && inserted.isEmpty())) return;
+
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out << qint32(position) << qint32(removed) << inserted;
+
+    QDataStream frame(&m_pending, QIODevice::WriteOnly | QIODevice::Append);
+    frame << quint32(payload.size()) << qChecksum(payload.constData(), uint(payload.size()));
+    m_pending.append(payload);
+}
+
+bool EditJournal::hasPending() const
+{
+    return !m_pending.isEmpty();
+}
+
+bool EditJournal::flush()
+{
+    if (!isOpen() || m_pending.isEmpty()) return true;
+
+    QFile file(m_path);
+    bool created = m_fileSize == 0;
+    if (!file.open(created ? QIODevice::WriteOnly | QIODevice::Truncate
+                           : QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Could not write journal:" << m_path;
+        return false;
+    }
+
+    if (created) {
+        QDataStream header(&file);
+        header << FILE_MAGIC << FILE_VERSION << m_baseSize << m_baseModified;
+    }
+
+    qint64 written = file.write(m_pending);
+    if (written != m_pending.size() || !file.flush() || ::fsync(file.handle()) != 0) {
+        qWarning() << "Could not sync journal:" << m_path;
+        // Take back whatever made it out; the edits stay buffered for the next try
+        if (created) {
+            file.remove();
+        } else {
+            file.resize(m_fileSize);
+        }
+        return false;
+    }
+
+    if (created) {
+        // Make the new directory entry durable too, or a crash can lose the file
+        int dir = ::open(QFile::encodeName(QFileInfo(m_path).path()).constData(), O_RDONLY | O_DIRECTORY);
+        if (dir >= 0) {
+            ::fsync(dir);
+            ::close(dir);
+        }
+    }
+
+    m_fileSize = file.size();
+    m_pending.clear();
+    return true;
+}
+
+void EditJournal::reset()
+{
+    if (!isOpen()) return;
+
+    m_pending.clear();
+    QFile::remove(m_path);
+    m_fileSize = 0;
+    rebase();
+}
+
+qint64 EditJournal::size() const
+{
+    return m_fileSize + m_pending.size();
+}
@@ -0,0 +1,89 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * editjournal.h - Append-only journal of unsaved edits
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+
+/**
+ * @brief The EditJournal class logs a document's edits since it was last written.
+ *
+ * The journal is a hidden file next to the document. It starts with a header
+ * naming the size and modification time of the document it applies to,
+ * followed by one record per edit: position, number of characters removed
+ * and the inserted text, with a length and checksum so that a record torn by
+ * a crash is recognised and dropped.
+ *
+ * Edits are buffered by append() and written and fsynced by flush(), so the
+ * cost of keeping unsaved work safe is proportional to what was typed. When
+ * the document itself has been written, reset() discards the journal.
+ */
+class EditJournal
+{
+public:
+    struct Edit {
+        int position;
+        int removed;        // Characters removed at position
+        QString inserted;
+    };
+
+    EditJournal();
+    ~EditJournal();
+
+    /**
+     * @brief open - Journal edits to the document at documentPath
+     *
+     * Returns the edits journaled since the document was last written, for
+     * the caller to replay. A journal left over from another version of the
+     * document is discarded. The journal file is only created by the first
+     * flush().
+     */
+    QList<Edit> open(const QString &documentPath);
+    void close();
+    bool isOpen() const;
+
+    void append(int position, int removed, const QString &inserted);
+    bool hasPending() const;
+
+    /**
+     * @brief flush - Write buffered edits to the journal and fsync it
+     */
+    bool flush();
+
+    /**
+     * @brief reset - The document was written; start over from it
+     */
+    void reset();
+
+    // Bytes in the journal, including what is still buffered
+    qint64 size() const;
+
+    static QString journalPath(const QString &documentPath);
+
+private:
+    void rebase();
+
+    QString m_documentPath;
+    QString m_path;
+    qint64 m_baseSize;          // Document the journal applies to
+    qint64 m_baseModified;
+    qint64 m_fileSize;          // Valid bytes in the journal file; 0 if it does not exist
+    QByteArray m_pending;
+
+    static const quint32 FILE_MAGIC = 0x47574a4c; // "GWJL"
+    static const quint32 FILE_VERSION = 1;
+    static const int HEADER_SIZE = 24;
+    static const int RECORD_HEADER_SIZE = 6;
+    static const int MAX_RECORD_SIZE = 64 * 1024 * 1024;
+};
+
+#endif // EDITJOURNAL_H
@@ -8,9 +8,13 @@
  */
 
 #include "editor.h"
+#include "metrics.h"
 #include <QFile>
+#include <QSaveFile>
 #include <QTextStream>
+#include <QTextCodec>
 #include <QFileInfo>
+#include <QTimer>
 #include <QDebug>
 
 Editor::Editor(QObject *parent)
@@ -20,12 +24,53 @@ Editor::Editor(QObject *parent)
     , m_fontSize(DEFAULT_FONT_SIZE)
     , m_selectionStart(-1)
     , m_selectionEnd(-1)
+    , m_journalTimer(new QTimer(this))
+    , m_compactTimer(new QTimer(this))
+    , m_loadFile(nullptr)
+    , m_loadData(nullptr)
+    , m_loadSize(0)
+    , m_loadOffset(0)
+    , m_loadCarriageReturn(false)
+    , m_loadTimer(new QTimer(this))
+{
+    m_journalTimer->setSingleShot(true);
+    m_journalTimer->setInterval(JOURNAL_SYNC_MS);
+    connect(m_journalTimer, &QTimer::timeout, this, [this]() {
+        m_journal.flush();
+    });
+
+    m_compactTimer->setSingleShot(true);
+    m_compactTimer->setInterval(COMPACT_IDLE_MS);
+    connect(m_compactTimer, &QTimer::timeout, this, [this]() {
+        if (m_modified && !m_currentFile.isEmpty()) {
+            saveDocument();
+        }
+    });
+
+    // Decode the rest of a large document between events
+    m_loadTimer->setInterval(0);
+    connect(m_loadTimer, &QTimer::timeout, this, &Editor::loadNextChunk);
+}
+
+Editor::~Editor()
 {
+    // Unsaved edits stay in the journal and are recovered on the next load
+    m_journal.flush();
 }
 
 QString Editor::content() const
 {
-    return m_content;
+    return m_buffer.text();
+}
+
+int Editor::length() const
+{
+    return m_buffer.length();
+}
+
+QString Editor::textRange(int position, int length) const
+{
+    return m_buffer.text(position, length);
 }
 
 int Editor::cursorPosition() const
@@ -50,18 +95,41 @@ int Editor::fontSize() const
 
 void Editor::setContent(const QString &content)
 {
-    if (m_content != content) {
-        addToHistory();
-        m_content = content;
-        m_cursorPosition = qMin(m_cursorPosition, m_content.length());
-        emit contentChanged();
-        markModified();
+    QString current = m_buffer.text();
+    if (current == content) return;
+
+    // Record only the span that actually differs
+    int prefix = 0;
+    int maxPrefix = qMin(current.length(), content.length());
+    while (prefix < maxPrefix && current.at(prefix) == content.at(prefix)) {
+        prefix++;
+    }
+    int suffix = 0;
+    int maxSuffix = maxPrefix - prefix;
+    while (suffix < maxSuffix &&
+           current.at(current.length() - 1 - suffix) == content.at(content.length() - 1 - suffix)) {
+        suffix++;
     }
+
+    QString removed = current.mid(prefix, current.length() - prefix - suffix);
+    QString inserted = content.mid(prefix, content.length() - prefix - suffix);
+
+    m_history.closeGroup();
+    m_history.record(prefix, removed, inserted, m_cursorPosition);
+    m_history.closeGroup();
+
+    m_buffer.remove(prefix, removed.length());
+    m_buffer.insert(prefix, inserted);
+    journalEdit(prefix, removed.length(), inserted);
+    m_cursorPosition = qMin(m_cursorPosition, m_buffer.length());
+    emit contentsChange(prefix, removed.length(), inserted.length());
+    emit contentChanged();
+    markModified();
 }
 
 void Editor::setCursorPosition(int position)
 {
-    position = qBound(0, position, m_content.length());
+    position = qBound(0, position, m_buffer.length());
     if (m_cursorPosition != position) {
         m_cursorPosition = position;
         emit cursorPositionChanged();
@@ -77,15 +145,25 @@ void Editor::setFontSize(int size)
     }
 }
 
+bool Editor::isLoading() const
+{
+    return m_loadFile != nullptr;
+}
+
 void Editor::newDocument()
 {
-    m_content.clear();
+    stopLoading();
+    int oldLength = m_buffer.length();
+    m_buffer.clear();
     m_cursorPosition = 0;
     m_currentFile.clear();
     m_modified = false;
-    m_undoStack.clear();
-    m_redoStack.clear();
+    m_history.clear();
+    m_journal.close();
+    m_journalTimer->stop();
+    m_compactTimer->stop();
 
+    emit contentsChange(0, oldLength, 0);
     emit contentChanged();
     emit cursorPositionChanged();
     emit currentFileChanged();
@@ -94,31 +172,81 @@ void Editor::newDocument()
 
 bool Editor::loadDocument(const QString &filePath)
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    QFile *file = new QFile(filePath, this);
+    if (!file->open(QIODevice::ReadOnly)) {
+        delete file;
         emit errorOccurred(tr("Could not open file: %1").arg(filePath));
         return false;
     }
 
-    QTextStream in(&file);
-    in.setCodec("UTF-8");
-    m_content = in.readAll();
-    file.close();
+    stopLoading();
+    m_loadFile = file;
+    m_loadSize = file->size();
+    m_loadData = m_loadSize > 0 ? file->map(0, m_loadSize) : nullptr;
+    if (!m_loadData) {
+        // Not mappable: read it up front, decode it in chunks all the same
+        m_loadBytes = file->readAll();
+        m_loadSize = m_loadBytes.size();
+        m_loadData = reinterpret_cast<const uchar *>(m_loadBytes.constData());
+    }
+    m_loadOffset = 0;
+    m_loadDecoder.reset(QTextCodec::codecForName("UTF-8")->makeDecoder());
+    m_loadCarriageReturn = false;
+
+    m_journalTimer->stop();
+    m_compactTimer->stop();
+    const QList<EditJournal::Edit> edits = m_journal.open(filePath);
+
+    int oldLength = m_buffer.length();
+    m_buffer.clear();
+    if (edits.isEmpty()) {
+        // The first screen now, the rest in the background
+        if (!decodeChunk(FIRST_CHUNK_BYTES)) {
+            stopLoading();
+        }
+    } else {
+        // Journaled edits are positioned in the whole text
+        while (decodeChunk(LOAD_CHUNK_BYTES)) {}
+        stopLoading();
+    }
+
+    // Replay whatever was typed after the last write
+    int replayed = 0;
+    for (const EditJournal::Edit &edit : edits) {
+        if (edit.position < 0 || edit.removed < 0
+                || edit.position + edit.removed > m_buffer.length()) {
+            break;
+        }
+        m_buffer.remove(edit.position, edit.removed);
+        m_buffer.insert(edit.position, edit.inserted);
+        ++replayed;
+    }
 
     m_cursorPosition = 0;
     m_currentFile = filePath;
     m_modified = false;
-    m_undoStack.clear();
-    m_redoStack.clear();
+    m_history.clear();
 
+    emit contentsChange(0, oldLength, m_buffer.length());
     emit contentChanged();
     emit cursorPositionChanged();
     emit currentFileChanged();
     emit modifiedChanged();
+    if (isLoading()) {
+        emit loadingChanged();
+        m_loadTimer->start();
+    }
 
     QFileInfo fileInfo(filePath);
     emit documentLoaded(fileInfo.fileName());
 
+    if (!edits.isEmpty()) {
+        // Make the recovered text the document proper
+        qWarning() << "Recovered" << replayed << "of" << edits.size() << "unsaved edits to" << filePath;
+        markModified();
+        saveDocument();
+    }
+
     return true;
 }
 
@@ -133,7 +261,12 @@ bool Editor::saveDocument()
 
 bool Editor::saveDocumentAs(const QString &filePath)
 {
-    QFile file(filePath);
+    // Never write out half a document
+    finishLoading();
+
+    // Written to a temporary file and renamed over the old one, so a crash
+    // mid-save leaves the previous version intact
+    QSaveFile file(filePath);
     if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
         emit errorOccurred(tr("Could not save file: %1").arg(filePath));
         return false;
@@ -141,8 +274,20 @@ bool Editor::saveDocumentAs(const QString &filePath)
 
     QTextStream out(&file);
     out.setCodec("UTF-8");
-    out << m_content;
-    file.close();
+    out << m_buffer.text();
+    out.flush();
+    if (!file.commit()) {
+        emit errorOccurred(tr("Could not save file: %1").arg(filePath));
+        return false;
+    }
+
+    // Everything journaled is in the file now
+    m_journalTimer->stop();
+    m_compactTimer->stop();
+    m_journal.reset();
+    if (filePath != m_currentFile) {
+        m_journal.open(filePath);
+    }
 
     m_currentFile = filePath;
     m_modified = false;
@@ -158,11 +303,39 @@ void Editor::insertText(const QString &text)
 {
     if (text.isEmpty()) return;
 
-    addToHistory();
+    m_history.record(m_cursorPosition, QString(), text, m_cursorPosition);
 
-    m_content.insert(m_cursorPosition, text);
+    m_buffer.insert(m_cursorPosition, text);
+    journalEdit(m_cursorPosition, 0, text);
     m_cursorPosition += text.length();
 
+    emit contentsChange(m_cursorPosition - text.length(), 0, text.length());
+    emit contentChanged();
+    emit cursorPositionChanged();
+    markModified();
+}
+
+void Editor::replaceRange(int start, int end, const QString &text)
+{
+    start = qBound(0, start, m_buffer.length());
+    end = qBound(0, end, m_buffer.length());
+    if (start > end) {
+        qSwap(start, end);
+    }
+    if (start == end && text.isEmpty()) return;
+
+    QString removed = m_buffer.text(start, end - start);
+
+    m_history.closeGroup();
+    m_history.record(start, removed, text, m_cursorPosition);
+    m_history.closeGroup();
+
+    m_buffer.remove(start, removed.length());
+    m_buffer.insert(start, text);
+    journalEdit(start, removed.length(), text);
+    m_cursorPosition = start + text.length();
+
+    emit contentsChange(start, removed.length(), text.length());
     emit contentChanged();
     emit cursorPositionChanged();
     markModified();
@@ -170,12 +343,14 @@ void Editor::insertText(const QString &text)
 
 void Editor::deleteChar()
 {
-    if (m_cursorPosition >= m_content.length()) return;
+    if (m_cursorPosition >= m_buffer.length()) return;
 
-    addToHistory();
+    m_history.record(m_cursorPosition, m_buffer.text(m_cursorPosition, 1), QString(), m_cursorPosition);
 
-    m_content.remove(m_cursorPosition, 1);
+    m_buffer.remove(m_cursorPosition, 1);
+    journalEdit(m_cursorPosition, 1, QString());
 
+    emit contentsChange(m_cursorPosition, 1, 0);
     emit contentChanged();
     markModified();
 }
@@ -184,11 +359,13 @@ void Editor::backspace()
 {
     if (m_cursorPosition <= 0) return;
 
-    addToHistory();
+    m_history.record(m_cursorPosition - 1, m_buffer.text(m_cursorPosition - 1, 1), QString(), m_cursorPosition);
 
     m_cursorPosition--;
-    m_content.remove(m_cursorPosition, 1);
+    m_buffer.remove(m_cursorPosition, 1);
+    journalEdit(m_cursorPosition, 1, QString());
 
+    emit contentsChange(m_cursorPosition, 1, 0);
     emit contentChanged();
     emit cursorPositionChanged();
     markModified();
@@ -209,7 +386,7 @@ void Editor::moveCursorLeft()
 
 void Editor::moveCursorRight()
 {
-    if (m_cursorPosition < m_content.length()) {
+    if (m_cursorPosition < m_buffer.length()) {
         m_cursorPosition++;
         emit cursorPositionChanged();
     }
@@ -217,12 +394,11 @@ void Editor::moveCursorRight()
 
 void Editor::moveCursorUp()
 {
-    // Find current line start
-    int lineStart = m_content.lastIndexOf('\n', m_cursorPosition - 1) + 1;
-    if (lineStart <= 0) return; // Already on first line
+    int line = m_buffer.lineForPosition(m_cursorPosition);
+    if (line == 0) return; // Already on first line
 
-    // Find previous line start
-    int prevLineStart = m_content.lastIndexOf('\n', lineStart - 2) + 1;
+    int lineStart = m_buffer.positionForLine(line);
+    int prevLineStart = m_buffer.positionForLine(line - 1);
 
     // Calculate column in current line
     int column = m_cursorPosition - lineStart;
@@ -237,23 +413,17 @@ void Editor::moveCursorUp()
 
 void Editor::moveCursorDown()
 {
-    // Find next line start
-    int nextLineStart = m_content.indexOf('\n', m_cursorPosition);
-    if (nextLineStart == -1) return; // Already on last line
-    nextLineStart++; // Move past the newline
+    int line = m_buffer.lineForPosition(m_cursorPosition);
+    if (line + 1 >= m_buffer.lineCount()) return; // Already on last line
 
-    // Find current line start
-    int lineStart = m_content.lastIndexOf('\n', m_cursorPosition - 1) + 1;
+    int lineStart = m_buffer.positionForLine(line);
+    int nextLineStart = m_buffer.positionForLine(line + 1);
 
     // Calculate column in current line
     int column = m_cursorPosition - lineStart;
 
-    // Find next line end
-    int nextLineEnd = m_content.indexOf('\n', nextLineStart);
-    if (nextLineEnd == -1) nextLineEnd = m_content.length();
-
     // Calculate next line length
-    int nextLineLength = nextLineEnd - nextLineStart;
+    int nextLineLength = lineEndPosition(line + 1) - nextLineStart;
 
     // Move to same column in next line, or end if shorter
     m_cursorPosition = nextLineStart + qMin(column, nextLineLength);
@@ -262,7 +432,7 @@ void Editor::moveCursorDown()
 
 void Editor::moveCursorToLineStart()
 {
-    int lineStart = m_content.lastIndexOf('\n', m_cursorPosition - 1) + 1;
+    int lineStart = m_buffer.positionForLine(m_buffer.lineForPosition(m_cursorPosition));
     if (m_cursorPosition != lineStart) {
         m_cursorPosition = lineStart;
         emit cursorPositionChanged();
@@ -271,22 +441,62 @@ void Editor::moveCursorToLineStart()
 
 void Editor::moveCursorToLineEnd()
 {
-    int lineEnd = m_content.indexOf('\n', m_cursorPosition);
-    if (lineEnd == -1) lineEnd = m_content.length();
+    int lineEnd = lineEndPosition(m_buffer.lineForPosition(m_cursorPosition));
     if (m_cursorPosition != lineEnd) {
         m_cursorPosition = lineEnd;
         emit cursorPositionChanged();
     }
 }
 
+int Editor::lineCount() const
+{
+    return m_buffer.lineCount();
+}
+
+int Editor::cursorLine() const
+{
+    return m_buffer.lineForPosition(m_cursorPosition);
+}
+
+int Editor::cursorColumn() const
+{
+    return m_cursorPosition - m_buffer.positionForLine(cursorLine());
+}
+
+int Editor::lineForPosition(int position) const
+{
+    return m_buffer.lineForPosition(position);
+}
+
+int Editor::positionForLine(int line) const
+{
+    return m_buffer.positionForLine(line);
+}
+
+void Editor::goToLine(int line)
+{
+    setCursorPosition(m_buffer.positionForLine(line));
+}
+
+int Editor::lineEndPosition(int line) const
+{
+    if (line + 1 < m_buffer.lineCount()) {
+        return m_buffer.positionForLine(line + 1) - 1;
+    }
+    return m_buffer.length();
+}
+
 void Editor::undo()
 {
-    if (m_undoStack.isEmpty()) return;
+    if (!m_history.canUndo()) return;
 
-    m_redoStack.append(m_content);
-    m_content = m_undoStack.takeLast();
-    m_cursorPosition = qMin(m_cursorPosition, m_content.length());
+    EditDelta delta = m_history.undo();
+    m_buffer.remove(delta.position, delta.inserted.length());
+    m_buffer.insert(delta.position, delta.removed);
+    journalEdit(delta.position, delta.inserted.length(), delta.removed);
+    m_cursorPosition = qBound(0, delta.cursorBefore, m_buffer.length());
 
+    emit contentsChange(delta.position, delta.inserted.length(), delta.removed.length());
     emit contentChanged();
     emit cursorPositionChanged();
     markModified();
@@ -294,12 +504,15 @@ void Editor::undo()
 
 void Editor::redo()
 {
-    if (m_redoStack.isEmpty()) return;
+    if (!m_history.canRedo()) return;
 
-    m_undoStack.append(m_content);
-    m_content = m_redoStack.takeLast();
-    m_cursorPosition = qMin(m_cursorPosition, m_content.length());
+    EditDelta delta = m_history.redo();
+    m_buffer.remove(delta.position, delta.removed.length());
+    m_buffer.insert(delta.position, delta.inserted);
+    journalEdit(delta.position, delta.removed.length(), delta.inserted);
+    m_cursorPosition = qBound(0, delta.position + delta.inserted.length(), m_buffer.length());
 
+    emit contentsChange(delta.position, delta.removed.length(), delta.inserted.length());
     emit contentChanged();
     emit cursorPositionChanged();
     markModified();
@@ -307,12 +520,12 @@ void Editor::redo()
 
 bool Editor::canUndo() const
 {
-    return !m_undoStack.isEmpty();
+    return m_history.canUndo();
 }
 
 bool Editor::canRedo() const
 {
-    return !m_redoStack.isEmpty();
+    return m_history.canRedo();
 }
 
 void Editor::increaseFontSize()
@@ -325,23 +538,90 @@ void Editor::decreaseFontSize()
     setFontSize(m_fontSize - 2);
 }
 
-void Editor::addToHistory()
-{
-    m_undoStack.append(m_content);
-    if (m_undoStack.size() > MAX_HISTORY) {
-        m_undoStack.removeFirst();
-    }
-    m_redoStack.clear();
-}
-
 void Editor::markModified()
 {
+    // Every edit comes through here, so this is where a keystroke has landed
+    Metrics::instance().inputApplied();
+    static Metrics::Gauge &undoBytes = Metrics::instance().gauge("editor.undo_bytes");
+    undoBytes.set(m_history.bytes());
+
     if (!m_modified) {
         m_modified = true;
         emit modifiedChanged();
     }
 }
 
+bool Editor::decodeChunk(qint64 bytes)
+{
+    qint64 count = qMin(bytes, m_loadSize - m_loadOffset);
+    QString text = m_loadDecoder->toUnicode(reinterpret_cast<const char *>(m_loadData) + m_loadOffset, int(count));
+    m_loadOffset += count;
+    bool more = m_loadOffset < m_loadSize;
+
+    // Line endings as a text-mode read would give them
+    if (m_loadCarriageReturn) {
+        text.prepend(QLatin1Char('\r'));
+        m_loadCarriageReturn = false;
+    }
+    if (more && text.endsWith(QLatin1Char('\r'))) {
+        text.chop(1);
+        m_loadCarriageReturn = true;
+    }
+    text.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+
+    // Edits made meanwhile all lie before the end, so the rest goes there
+    m_buffer.appendOriginal(text);
+    return more;
+}
+
+void Editor::loadNextChunk()
+{
+    int oldLength = m_buffer.length();
+    bool more = decodeChunk(LOAD_CHUNK_BYTES);
+    if (!more) {
+        stopLoading();
+    }
+
+    emit contentsChange(oldLength, 0, m_buffer.length() - oldLength);
+    emit contentChanged();
+}
+
+void Editor::finishLoading()
+{
+    if (!isLoading()) return;
+
+    int oldLength = m_buffer.length();
+    while (decodeChunk(LOAD_CHUNK_BYTES)) {}
+    stopLoading();
+
+    emit contentsChange(oldLength, 0, m_buffer.length() - oldLength);
+    emit contentChanged();
+}
+
+void Editor::stopLoading()
+{
+    if (!isLoading()) return;
+
+    m_loadTimer->stop();
+    m_loadDecoder.reset();
+    m_loadData = nullptr;
+    m_loadBytes.clear();
+    delete m_loadFile; // Unmaps it
+    m_loadFile = nullptr;
+    emit loadingChanged();
+}
+
+void Editor::journalEdit(int position, int removed, const QString &inserted)
+{
+    if (!m_journal.isOpen()) return; // Not saved anywhere yet
+
+    m_journal.append(position, removed, inserted);
+    if (!m_journalTimer->isActive()) {
+        m_journalTimer->start();
+    }
+    m_compactTimer->start();
+}
+
 // Selection implementation
 
 int Editor::selectionStart() const
@@ -362,12 +642,12 @@ bool Editor::hasSelection() const
 QString Editor::selectedText() const
 {
     if (!hasSelection()) return QString();
-    return m_content.mid(m_selectionStart, m_selectionEnd - m_selectionStart);
+    return m_buffer.text(m_selectionStart, m_selectionEnd - m_selectionStart);
 }
 
 void Editor::setSelectionStart(int position)
 {
-    position = qBound(0, position, m_content.length());
+    position = qBound(0, position, m_buffer.length());
     if (m_selectionStart != position) {
         m_selectionStart = position;
         emit selectionChanged();
@@ -376,7 +656,7 @@ void Editor::setSelectionStart(int position)
 
 void Editor::setSelectionEnd(int position)
 {
-    position = qBound(0, position, m_content.length());
+    position = qBound(0, position, m_buffer.length());
     if (m_selectionEnd != position) {
         m_selectionEnd = position;
         emit selectionChanged();
@@ -385,8 +665,8 @@ void Editor::setSelectionEnd(int position)
 
 void Editor::setSelection(int start, int end)
 {
-    start = qBound(0, start, m_content.length());
-    end = qBound(0, end, m_content.length());
+    start = qBound(0, start, m_buffer.length());
+    end = qBound(0, end, m_buffer.length());
     
     if (start > end) {
         qSwap(start, end);
@@ -412,24 +692,24 @@ void Editor::clearSelection()
 
 void Editor::selectAll()
 {
-    setSelection(0, m_content.length());
+    setSelection(0, m_buffer.length());
 }
 
 void Editor::selectWord()
 {
-    if (m_content.isEmpty()) return;
+    if (m_buffer.isEmpty()) return;
     
     // Find word boundaries at cursor position
     int start = m_cursorPosition;
     int end = m_cursorPosition;
     
     // Move start backwards to word beginning
-    while (start > 0 && !m_content[start - 1].isSpace()) {
+    while (start > 0 && !m_buffer.at(start - 1).isSpace()) {
         start--;
     }
     
     // Move end forwards to word end
-    while (end < m_content.length() && !m_content[end].isSpace()) {
+    while (end < m_buffer.length() && !m_buffer.at(end).isSpace()) {
         end++;
     }
     
@@ -440,26 +720,20 @@ void Editor::selectWord()
 
 void Editor::selectLine()
 {
-    if (m_content.isEmpty()) return;
+    if (m_buffer.isEmpty()) return;
     
-    // Find line start
-    int start = m_content.lastIndexOf('\n', m_cursorPosition - 1) + 1;
-    
-    // Find line end
-    int end = m_content.indexOf('\n', m_cursorPosition);
-    if (end == -1) end = m_content.length();
-    
-    setSelection(start, end);
+    int line = m_buffer.lineForPosition(m_cursorPosition);
+    setSelection(m_buffer.positionForLine(line), lineEndPosition(line));
 }
 
 void Editor::selectParagraph()
 {
-    if (m_content.isEmpty()) return;
+    if (m_buffer.isEmpty()) return;
     
     // Find paragraph start (double newline or start of content)
     int start = m_cursorPosition;
     while (start > 0) {
-        if (start >= 2 && m_content[start - 1] == '\n' && m_content[start - 2] == '\n') {
+        if (start >= 2 && m_buffer.at(start - 1) == '\n' && m_buffer.at(start - 2) == '\n') {
             break;
         }
         start--;
@@ -467,8 +741,8 @@ void Editor::selectParagraph()
     
     // Find paragraph end (double newline or end of content)
     int end = m_cursorPosition;
-    while (end < m_content.length()) {
-        if (end < m_content.length() - 1 && m_content[end] == '\n' && m_content[end + 1] == '\n') {
+    while (end < m_buffer.length()) {
+        if (end < m_buffer.length() - 1 && m_buffer.at(end) == '\n' && m_buffer.at(end + 1) == '\n') {
             break;
         }
         end++;
@@ -497,10 +771,10 @@ void Editor::extendSelectionRight()
     if (!hasSelection()) {
         // Start selection from cursor
         m_selectionStart = m_cursorPosition;
-        m_selectionEnd = qMin(m_content.length(), m_cursorPosition + 1);
+        m_selectionEnd = qMin(m_buffer.length(), m_cursorPosition + 1);
     } else {
         // Extend selection right
-        m_selectionEnd = qMin(m_content.length(), m_selectionEnd + 1);
+        m_selectionEnd = qMin(m_buffer.length(), m_selectionEnd + 1);
     }
     m_cursorPosition = m_selectionEnd;
     emit selectionChanged();
@@ -510,10 +784,11 @@ void Editor::extendSelectionRight()
 void Editor::extendSelectionUp()
 {
     // Find current line info
-    int lineStart = m_content.lastIndexOf('\n', m_cursorPosition - 1) + 1;
-    if (lineStart <= 0) return;
+    int line = m_buffer.lineForPosition(m_cursorPosition);
+    if (line == 0) return;
     
-    int prevLineStart = m_content.lastIndexOf('\n', lineStart - 2) + 1;
+    int lineStart = m_buffer.positionForLine(line);
+    int prevLineStart = m_buffer.positionForLine(line - 1);
     int column = m_cursorPosition - lineStart;
     int prevLineLength = lineStart - 1 - prevLineStart;
     int targetPos = prevLineStart + qMin(column, prevLineLength);
@@ -532,15 +807,13 @@ void Editor::extendSelectionUp()
 void Editor::extendSelectionDown()
 {
     // Find next line
-    int nextLineStart = m_content.indexOf('\n', m_cursorPosition);
-    if (nextLineStart == -1) return;
-    nextLineStart++;
+    int line = m_buffer.lineForPosition(m_cursorPosition);
+    if (line + 1 >= m_buffer.lineCount()) return;
     
-    int lineStart = m_content.lastIndexOf('\n', m_cursorPosition - 1) + 1;
+    int lineStart = m_buffer.positionForLine(line);
+    int nextLineStart = m_buffer.positionForLine(line + 1);
     int column = m_cursorPosition - lineStart;
-    int nextLineEnd = m_content.indexOf('\n', nextLineStart);
-    if (nextLineEnd == -1) nextLineEnd = m_content.length();
-    int nextLineLength = nextLineEnd - nextLineStart;
+    int nextLineLength = lineEndPosition(line + 1) - nextLineStart;
     int targetPos = nextLineStart + qMin(column, nextLineLength);
     
     if (!hasSelection()) {
@@ -556,7 +829,7 @@ void Editor::extendSelectionDown()
 
 void Editor::extendSelectionToLineStart()
 {
-    int lineStart = m_content.lastIndexOf('\n', m_cursorPosition - 1) + 1;
+    int lineStart = m_buffer.positionForLine(m_buffer.lineForPosition(m_cursorPosition));
     
     if (!hasSelection()) {
         m_selectionEnd = m_cursorPosition;
@@ -571,8 +844,7 @@ void Editor::extendSelectionToLineStart()
 
 void Editor::extendSelectionToLineEnd()
 {
-    int lineEnd = m_content.indexOf('\n', m_cursorPosition);
-    if (lineEnd == -1) lineEnd = m_content.length();
+    int lineEnd = lineEndPosition(m_buffer.lineForPosition(m_cursorPosition));
     
     if (!hasSelection()) {
         m_selectionStart = m_cursorPosition;
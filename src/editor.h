@@ -13,17 +13,38 @@
 #include <QObject>
 #include <QString>
 #include <QStringList>
+#include <QByteArray>
+#include <QScopedPointer>
+
+#include "piecetable.h"
+#include "undohistory.h"
+#include "editjournal.h"
+
+class QTimer;
+class QFile;
+class QTextDecoder;
 
 /**
  * @brief The Editor class provides core text editing functionality.
  *
  * This class manages the document content, cursor position, and edit history.
  * It exposes properties and methods to QML for the user interface.
+ *
+ * Edits to a saved document are appended to an EditJournal and synced to
+ * disk every second or so. After a pause in typing the document is written
+ * out in full, atomically, and the journal discarded. Edits still in a
+ * journal when the document is next loaded are replayed, so a crash loses
+ * at most the last second of typing.
+ *
+ * Documents are memory-mapped and decoded in chunks: the first chunk is shown
+ * straight away and the rest is appended in the background, so opening a
+ * large file takes as long as opening a small one.
  */
 class Editor : public QObject
 {
     Q_OBJECT
     Q_PROPERTY(QString content READ content WRITE setContent NOTIFY contentChanged)
+    Q_PROPERTY(int length READ length NOTIFY contentChanged)
     Q_PROPERTY(int cursorPosition READ cursorPosition WRITE setCursorPosition NOTIFY cursorPositionChanged)
     Q_PROPERTY(QString currentFile READ currentFile NOTIFY currentFileChanged)
     Q_PROPERTY(bool modified READ isModified NOTIFY modifiedChanged)
@@ -32,12 +53,18 @@ class Editor : public QObject
     Q_PROPERTY(int selectionEnd READ selectionEnd WRITE setSelectionEnd NOTIFY selectionChanged)
     Q_PROPERTY(bool hasSelection READ hasSelection NOTIFY selectionChanged)
     Q_PROPERTY(QString selectedText READ selectedText NOTIFY selectionChanged)
+    Q_PROPERTY(int lineCount READ lineCount NOTIFY contentChanged)
+    Q_PROPERTY(int cursorLine READ cursorLine NOTIFY cursorPositionChanged)
+    Q_PROPERTY(int cursorColumn READ cursorColumn NOTIFY cursorPositionChanged)
+    Q_PROPERTY(bool loading READ isLoading NOTIFY loadingChanged)
 
 public:
     explicit Editor(QObject *parent = nullptr);
+    ~Editor();
 
     // Property getters
     QString content() const;
+    int length() const;
     int cursorPosition() const;
     QString currentFile() const;
     bool isModified() const;
@@ -46,6 +73,10 @@ public:
     int selectionEnd() const;
     bool hasSelection() const;
     QString selectedText() const;
+    int lineCount() const;
+    int cursorLine() const;
+    int cursorColumn() const;
+    bool isLoading() const;
 
     // Property setters
     void setContent(const QString &content);
@@ -55,6 +86,9 @@ public:
     void setSelectionEnd(int position);
 
 public slots:
+    // Partial content access, avoids flattening the whole document
+    QString textRange(int position, int length) const;
+
     // Document operations
     void newDocument();
     bool loadDocument(const QString &filePath);
@@ -63,6 +97,12 @@ public slots:
 
     // Edit operations
     void insertText(const QString &text);
+    /**
+     * @brief replaceRange - Replace [start, end) with text as one undo step
+     *
+     * Edits the buffer in place and leaves the cursor after the new text.
+     */
+    void replaceRange(int start, int end, const QString &text);
     void deleteChar();
     void backspace();
     void newLine();
@@ -75,6 +115,11 @@ public slots:
     void moveCursorToLineStart();
     void moveCursorToLineEnd();
 
+    // Line index (0-based lines)
+    int lineForPosition(int position) const;
+    int positionForLine(int line) const;
+    void goToLine(int line);
+
     // Undo/Redo
     void undo();
     void redo();
@@ -100,6 +145,14 @@ public slots:
     void extendSelectionToLineEnd();
 
 signals:
+    /**
+     * @brief contentsChange - Fine-grained edit notification
+     *
+     * Emitted for every edit before contentChanged(). At @p position,
+     * @p charsRemoved characters were replaced by @p charsAdded new ones,
+     * so views can patch their copy instead of re-reading content.
+     */
+    void contentsChange(int position, int charsRemoved, int charsAdded);
     void contentChanged();
     void cursorPositionChanged();
     void currentFileChanged();
@@ -108,13 +161,21 @@ signals:
     void selectionChanged();
     void documentSaved();
     void documentLoaded(const QString &fileName);
+    void loadingChanged();
     void errorOccurred(const QString &message);
 
 private:
-    void addToHistory();
     void markModified();
+    void journalEdit(int position, int removed, const QString &inserted);
+    int lineEndPosition(int line) const;
 
-    QString m_content;
+    // Chunked loading
+    bool decodeChunk(qint64 bytes);
+    void loadNextChunk();
+    void finishLoading();
+    void stopLoading();
+
+    PieceTable m_buffer;
     int m_cursorPosition;
     QString m_currentFile;
     bool m_modified;
@@ -122,15 +183,34 @@ private:
     int m_selectionStart;
     int m_selectionEnd;
 
-    // Undo/Redo stacks
-    QStringList m_undoStack;
-    QStringList m_redoStack;
-    static const int MAX_HISTORY = 100;
+    // Undo/Redo history, stored as deltas
+    UndoHistory m_history;
+
+    // Crash-safe autosave
+    EditJournal m_journal;
+    QTimer *m_journalTimer;     // Syncs the journal
+    QTimer *m_compactTimer;     // Writes the document once typing pauses
+
+    // Document being loaded; the text decoded so far is in m_buffer
+    QFile *m_loadFile;
+    const uchar *m_loadData;    // Mapped file, or m_loadBytes if it cannot be mapped
+    QByteArray m_loadBytes;
+    qint64 m_loadSize;
+    qint64 m_loadOffset;
+    QScopedPointer<QTextDecoder> m_loadDecoder;
+    bool m_loadCarriageReturn;  // Chunk ended in '\r'; held back in case '\n' follows
+    QTimer *m_loadTimer;
 
     // Font size limits
     static const int MIN_FONT_SIZE = 12;
     static const int MAX_FONT_SIZE = 48;
     static const int DEFAULT_FONT_SIZE = 18;
+
+    static const int JOURNAL_SYNC_MS = 1000;
+    static const int COMPACT_IDLE_MS = 15000;
+
+    static const int FIRST_CHUNK_BYTES = 64 * 1024;    // Well over a screenful
+    static const int LOAD_CHUNK_BYTES = 512 * 1024;
 };
 
 #endif // EDITOR_H
@@ -0,0 +1,233 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * evdevreader.cpp - Blocking evdev reader implementation
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#include "evdevreader.h"
+#include "metrics.h"
+#include <QDebug>
+
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <linux/input.h>
+
+static const char INPUT_DIR[] = "/dev/input";
+
+EvdevReader::EvdevReader(QObject *parent)
+    : QObject(parent)
+    , m_inotifyFd(-1)
+    , m_wakeFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+    , m_running(1)
+    , m_rescanRequested(0)
+{
+    if (m_wakeFd < 0) {
+        qWarning() << "EvdevReader: could not create eventfd, stop() will wait for input";
+    }
+}
+
+EvdevReader::~EvdevReader()
+{
+    if (m_wakeFd >= 0) {
+        close(m_wakeFd);
+    }
+}
+
+void EvdevReader::stop()
+{
+    m_running.storeRelease(0);
+    wake();
+}
+
+void EvdevReader::rescan()
+{
+    m_rescanRequested.storeRelease(1);
+    wake();
+}
+
+void EvdevReader::wake()
+{
+    if (m_wakeFd >= 0) {
+        eventfd_write(m_wakeFd, 1);
+    }
+}
+
+void EvdevReader::run()
+{
+    // Creating a node or fixing its permissions both mean "try opening it"
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd < 0 || inotify_add_watch(m_inotifyFd, INPUT_DIR, IN_CREATE | IN_ATTRIB) < 0) {
+        qWarning() << "EvdevReader: cannot watch" << INPUT_DIR << "- hotplug disabled:" << strerror(errno);
+    }
+
+    scanDirectory();
+
+    QVector<InputKeyEvent> batch;
+    QVector<struct pollfd> fds;
+
+    while (m_running.loadAcquire()) {
+        if (m_rescanRequested.fetchAndStoreAcquire(0)) {
+            scanDirectory();
+        }
+
+        // poll() skips negative descriptors, so missing fds need no special case
+        fds.resize(2 + m_devices.size());
+        fds[0] = {m_wakeFd, POLLIN, 0};
+        fds[1] = {m_inotifyFd, POLLIN, 0};
+        for (int i = 0; i < m_devices.size(); ++i) {
+            fds[2 + i] = {m_devices[i].fd, POLLIN, 0};
+        }
+
+        int rc = poll(fds.data(), fds.size(), -1);
+        if (rc < 0) {
+            if (errno == EINTR) continue;
+            qWarning() << "EvdevReader: poll failed:" << strerror(errno);
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            eventfd_t value;
+            eventfd_read(m_wakeFd, &value);
+            continue; // stop() or rescan(), both handled at the top
+        }
+
+        // Walk backwards so closing a device keeps earlier indices valid
+        for (int i = m_devices.size() - 1; i >= 0; --i) {
+            short revents = fds[2 + i].revents;
+            if (!revents) continue;
+
+            bool alive = readDevice(m_devices[i], batch);
+            if (!alive || (revents & (POLLERR | POLLHUP | POLLNVAL))) {
+                closeDevice(i);
+            }
+        }
+
+        if (!batch.isEmpty()) {
+            static Metrics::Histogram &batchSize = Metrics::instance().histogram("input.batch_size");
+            batchSize.record(batch.size());
+            Metrics::instance().markInput();
+            emit keyEventsRead(batch);
+            batch.clear();
+        }
+
+        if (fds[1].revents & POLLIN) {
+            readInotify();
+        }
+    }
+
+    while (!m_devices.isEmpty()) {
+        closeDevice(m_devices.size() - 1);
+    }
+    if (m_inotifyFd >= 0) {
+        close(m_inotifyFd);
+        m_inotifyFd = -1;
+    }
+
+    emit finished();
+}
+
+void EvdevReader::scanDirectory()
+{
+    DIR *dir = opendir(INPUT_DIR);
+    if (!dir) {
+        qWarning() << "EvdevReader: cannot open" << INPUT_DIR;
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (strncmp(entry->d_name, "event", 5) != 0) continue;
+        openDevice(QString("%1/%2").arg(INPUT_DIR, entry->d_name));
+    }
+
+    closedir(dir);
+}
+
+void EvdevReader::readInotify()
+{
+    alignas(struct inotify_event) char buffer[4096];
+
+    for (;;) {
+        ssize_t size = read(m_inotifyFd, buffer, sizeof(buffer));
+        if (size <= 0) break; // EAGAIN: drained
+
+        for (char *ptr = buffer; ptr < buffer + size; ) {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(ptr);
+            if (event->len > 0 && strncmp(event->name, "event", 5) == 0) {
+                openDevice(QString("%1/%2").arg(INPUT_DIR, event->name));
+            }
+            ptr += sizeof(struct inotify_event) + event->len;
+        }
+    }
+}
+
+void EvdevReader::openDevice(const QString &path)
+{
+    for (const Device &device : m_devices) {
+        if (device.path == path) return;
+    }
+
+    int fd = open(path.toUtf8().constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) return; // Not ready yet; IN_ATTRIB will bring us back
+
+    struct libevdev *evdev = nullptr;
+    if (libevdev_new_from_fd(fd, &evdev) < 0) {
+        close(fd);
+        return;
+    }
+
+    // Keyboards have letter keys; pedals and small keypads usually send
+    // Enter or Space
+    if (!libevdev_has_event_code(evdev, EV_KEY, KEY_A)
+        && !libevdev_has_event_code(evdev, EV_KEY, KEY_ENTER)
+        && !libevdev_has_event_code(evdev, EV_KEY, KEY_SPACE)) {
+        libevdev_free(evdev);
+        close(fd);
+        return;
+    }
+
+    Device device;
+    device.path = path;
+    device.fd = fd;
+    device.evdev = evdev;
+    m_devices.append(device);
+
+    QString name = QString::fromUtf8(libevdev_get_name(evdev));
+    qDebug() << "Found keyboard:" << name << "at" << path;
+    emit keyboardAdded(path, name);
+}
+
+void EvdevReader::closeDevice(int index)
+{
+    Device device = m_devices.takeAt(index);
+    libevdev_free(device.evdev);
+    close(device.fd);
+    emit keyboardRemoved(device.path);
+}
+
+bool EvdevReader::readDevice(const Device &device, QVector<InputKeyEvent> &batch)
+{
+    // Drain everything the kernel has queued. After a SYN_DROPPED the
+    // device state is resynced before normal reading resumes.
+    struct input_event ev;
+    unsigned int flags = LIBEVDEV_READ_FLAG_NORMAL;
+    int status;
+    while ((status = libevdev_next_event(device.evdev, flags, &ev)) >= 0) {
+        flags = (status == LIBEVDEV_READ_STATUS_SYNC)
+            ? LIBEVDEV_READ_FLAG_SYNC : LIBEVDEV_READ_FLAG_NORMAL;
+        if (ev.type == EV_KEY) {
+            batch.append({static_cast<quint16>(ev.code), ev.value});
+        }
+    }
+
+    return status != -ENODEV;
+}
@@ -0,0 +1,100 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * evdevreader.h - Blocking evdev reader for the input thread
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#ifndef EVDEVREADER_H
+#define EVDEVREADER_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QMetaType>
+#include <QAtomicInt>
+
+#include <libevdev/libevdev.h>
+
+/**
+ * @brief The InputKeyEvent struct is one EV_KEY event read from a device.
+ *
+ * value: 0 = release, 1 = press, 2 = repeat
+ */
+struct InputKeyEvent {
+    quint16 code;
+    qint32 value;
+};
+
+Q_DECLARE_METATYPE(InputKeyEvent)
+Q_DECLARE_METATYPE(QVector<InputKeyEvent>)
+
+/**
+ * @brief The EvdevReader class owns the keyboards and reads them on a dedicated thread.
+ *
+ * The reader blocks in poll() on every open keyboard, so it causes no
+ * wakeups while nothing is typed and picks events up as soon as the kernel
+ * delivers them. Everything drained in one wakeup is posted to the GUI
+ * thread as a single batch.
+ *
+ * /dev/input is probed once at startup and then watched with inotify, so
+ * only nodes that appear later are opened. Any number of keyboards (say a
+ * keyboard and a foot pedal) can be connected at once and feed the same
+ * batches. An eventfd lets stop() and rescan() interrupt the poll.
+ */
+class EvdevReader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EvdevReader(QObject *parent = nullptr);
+    ~EvdevReader();
+
+    /**
+     * @brief stop - Ask run() to return; safe to call from any thread
+     */
+    void stop();
+
+    /**
+     * @brief rescan - Probe every node in /dev/input again; safe to call from any thread
+     */
+    void rescan();
+
+public slots:
+    /**
+     * @brief run - Blocking read loop, started from QThread::started
+     */
+    void run();
+
+signals:
+    void keyEventsRead(const QVector<InputKeyEvent> &events);
+    void keyboardAdded(const QString &path, const QString &name);
+    void keyboardRemoved(const QString &path);
+    void finished();
+
+private:
+    struct Device {
+        QString path;
+        int fd;
+        struct libevdev *evdev;
+    };
+
+    void scanDirectory();
+    void readInotify();
+    void openDevice(const QString &path);
+    void closeDevice(int index);
+    bool readDevice(const Device &device, QVector<InputKeyEvent> &batch);
+    void wake();
+
+    // Only touched from run(), i.e. on the input thread
+    QVector<Device> m_devices;
+    int m_inotifyFd;
+
+    int m_wakeFd;
+    QAtomicInt m_running;
+    QAtomicInt m_rescanRequested;
+};
+
+#endif // EVDEVREADER_H
@@ -8,16 +8,68 @@
  */
 
 #include "filemanager.h"
+#include "editjournal.h"
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QSet>
+#include <QTextStream>
+#include <QTimer>
 #include <QDebug>
 
 const QString FileManager::FILE_EXTENSION = ".md";
+const QString FileManager::INDEX_FILE = ".search-index";
+const QString FileManager::METADATA_FILE = ".documents-cache";
+
+namespace {
+
+int countWords(const QString &text)
+{
+    int words = 0;
+    bool inWord = false;
+    for (const QChar &ch : text) {
+        if (ch.isSpace()) {
+            inWord = false;
+        } else if (!inWord) {
+            inWord = true;
+            ++words;
+        }
+    }
+    return words;
+}
+
+} // namespace
 
 FileManager::FileManager(QObject *parent)
     : QObject(parent)
+    , m_model(new DocumentListModel(this))
+    , m_watcher(new QFileSystemWatcher(this))
+    , m_rescanTimer(new QTimer(this))
+    , m_listDirty(false)
+    , m_indexTimer(new QTimer(this))
+    , m_saveTimer(new QTimer(this))
+{
+    // A burst of directory changes gives one rescan
+    m_rescanTimer->setSingleShot(true);
+    m_rescanTimer->setInterval(RESCAN_DELAY_MS);
+    connect(m_rescanTimer, &QTimer::timeout, this, &FileManager::rescanDirectory);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, m_rescanTimer, [this]() {
+        m_rescanTimer->start();
+    });
+
+    // Check and index in small batches between events
+    m_indexTimer->setInterval(0);
+    connect(m_indexTimer, &QTimer::timeout, this, &FileManager::processIndexQueue);
+
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(SAVE_DELAY_MS);
+    connect(m_saveTimer, &QTimer::timeout, this, &FileManager::saveState);
+}
+
+FileManager::~FileManager()
 {
+    saveState();
 }
 
 QString FileManager::documentDirectory() const
@@ -30,37 +82,118 @@ QStringList FileManager::documents() const
     return m_documents;
 }
 
+QAbstractListModel *FileManager::documentModel() const
+{
+    return m_model;
+}
+
 void FileManager::setDocumentDirectory(const QString &path)
 {
-    if (m_documentDirectory != path) {
-        m_documentDirectory = path;
-        emit documentDirectoryChanged();
-        refreshDocuments();
+    if (m_documentDirectory == path) {
+        return;
+    }
+
+    saveState();
+    m_indexQueue.clear();
+    m_indexTimer->stop();
+    if (!m_watcher->directories().isEmpty()) {
+        m_watcher->removePaths(m_watcher->directories());
+    }
+
+    m_documentDirectory = path;
+    m_index.load(path + "/" + INDEX_FILE);
+    if (!m_model->load(path + "/" + METADATA_FILE)) {
+        m_model->reset(QVector<DocumentInfo>());
     }
+    m_listDirty = false;
+
+    emit documentDirectoryChanged();
+    documentsUpdated();
+
+    // The cached list is shown as is; check every entry against the disk
+    // in the background, and pick up documents that came or went meanwhile
+    refreshDocuments();
 }
 
 void FileManager::refreshDocuments()
 {
-    m_documents.clear();
+    // Known documents may have been edited elsewhere; the check compares
+    // mtime and size and only reads the ones that changed
+    const QSet<QString> queued(m_indexQueue.cbegin(), m_indexQueue.cend());
+    for (const QString &name : m_model->names()) {
+        if (!queued.contains(name)) {
+            m_indexQueue.append(name);
+        }
+    }
 
+    m_listedFiles.clear();
+    rescanDirectory();
+}
+
+void FileManager::rescanDirectory()
+{
     QDir dir(m_documentDirectory);
     if (!dir.exists()) {
         qWarning() << "Document directory does not exist:" << m_documentDirectory;
-        emit documentsChanged();
+        m_listedFiles.clear();
+        if (m_model->rowCount() > 0) {
+            m_model->reset(QVector<DocumentInfo>());
+            m_listDirty = true;
+        }
+        documentsUpdated();
         return;
     }
 
+    if (m_watcher->directories().isEmpty()) {
+        m_watcher->addPath(m_documentDirectory);
+    }
+
+    // Names only; known documents are stat'ed by the background check
     QStringList filters;
     filters << "*" + FILE_EXTENSION;
-    dir.setNameFilters(filters);
-    dir.setSorting(QDir::Time);
+    const QStringList fileNames = dir.entryList(filters, QDir::Files | QDir::Readable, QDir::NoSort);
+
+    // Most changes are our own journals, temp files and caches, which are
+    // hidden or lack the extension: nothing to do if the documents are the same
+    QSet<QString> listed(fileNames.cbegin(), fileNames.cend());
+    if (listed == m_listedFiles) return;
+    m_listedFiles = listed;
+
+    bool changed = false;
+    QSet<QString> present;
+    for (const QString &fileName : fileNames) {
+        const QString name = QFileInfo(fileName).baseName();
+        present.insert(name);
+        if (m_model->contains(name)) {
+            continue;
+        }
 
-    QFileInfoList fileInfoList = dir.entryInfoList(QDir::Files | QDir::Readable);
-    for (const QFileInfo &fileInfo : fileInfoList) {
-        m_documents.append(fileInfo.baseName());
+        QFileInfo fileInfo(dir, fileName);
+        m_model->upsert({ name, fileInfo.lastModified().toMSecsSinceEpoch(), fileInfo.size(), -1 });
+        m_indexQueue.append(name);
+        changed = true;
     }
 
-    emit documentsChanged();
+    for (const QString &name : m_model->names()) {
+        if (!present.contains(name)) {
+            m_model->remove(name);
+            changed = true;
+        }
+    }
+    for (const QString &name : m_index.names()) {
+        if (!present.contains(name)) {
+            m_index.remove(name);
+        }
+    }
+
+    if (changed) {
+        m_listDirty = true;
+        documentsUpdated();
+    }
+    if (!m_indexQueue.isEmpty()) {
+        m_indexTimer->start();
+    }
+    scheduleSave();
 }
 
 QString FileManager::createDocument(const QString &name)
@@ -93,7 +226,12 @@ QString FileManager::createDocument(const QString &name)
     }
     file.close();
 
-    refreshDocuments();
+    qint64 modified = QFileInfo(filePath).lastModified().toMSecsSinceEpoch();
+    m_model->upsert({ safeName, modified, 0, 0 });
+    m_index.update(safeName, QString(), modified);
+    m_listDirty = true;
+    documentsUpdated();
+    scheduleSave();
     emit documentCreated(safeName);
 
     return filePath;
@@ -112,8 +250,13 @@ bool FileManager::deleteDocument(const QString &name)
         emit errorOccurred(tr("Could not delete document: %1").arg(name));
         return false;
     }
+    QFile::remove(EditJournal::journalPath(filePath));
 
-    refreshDocuments();
+    m_index.remove(name);
+    m_model->remove(name);
+    m_listDirty = true;
+    documentsUpdated();
+    scheduleSave();
     emit documentDeleted(name);
 
     return true;
@@ -143,8 +286,13 @@ bool FileManager::renameDocument(const QString &oldName, const QString &newName)
         emit errorOccurred(tr("Could not rename document"));
         return false;
     }
+    QFile::rename(EditJournal::journalPath(oldPath), EditJournal::journalPath(newPath));
 
-    refreshDocuments();
+    m_index.rename(oldName, newName);
+    m_model->rename(oldName, newName);
+    m_listDirty = true;
+    documentsUpdated();
+    scheduleSave();
     emit documentRenamed(oldName, newName);
 
     return true;
@@ -170,20 +318,123 @@ QString FileManager::baseName(const QString &path) const
     return fileInfo.baseName();
 }
 
-QStringList FileManager::searchDocuments(const QString &query) const
+QStringList FileManager::searchDocuments(const QString &query, int limit) const
 {
     if (query.isEmpty()) {
         return m_documents;
     }
 
     QStringList results;
-    QString lowerQuery = query.toLower();
-
-    for (const QString &doc : m_documents) {
-        if (doc.toLower().contains(lowerQuery)) {
-            results.append(doc);
-        }
+    for (const FuzzyMatcher::Match &match : m_matcher.match(query, limit)) {
+        results.append(m_documents.at(match.index));
     }
 
     return results;
 }
+
+QStringList FileManager::searchContent(const QString &query, int limit) const
+{
+    QStringList results;
+    for (const SearchIndex::Hit &hit : m_index.search(query, limit)) {
+        results.append(hit.name);
+    }
+    return results;
+}
+
+void FileManager::documentSaved(const QString &path)
+{
+    QFileInfo fileInfo(path);
+    if (fileInfo.absolutePath() != QFileInfo(m_documentDirectory).absoluteFilePath()
+            || !fileInfo.fileName().endsWith(FILE_EXTENSION)) {
+        return; // Not one of ours
+    }
+
+    m_indexQueue.removeAll(fileInfo.baseName());
+    indexDocument(fileInfo.baseName());
+    documentsUpdated();
+    scheduleSave();
+}
+
+void FileManager::indexDocument(const QString &name)
+{
+    QFile file(fullPath(name));
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        m_index.remove(name);
+        m_model->remove(name);
+        m_listDirty = true;
+        return;
+    }
+
+    QTextStream in(&file);
+    in.setCodec("UTF-8");
+    QString text = in.readAll();
+
+    QFileInfo fileInfo(file);
+    qint64 modified = fileInfo.lastModified().toMSecsSinceEpoch();
+    m_index.update(name, text, modified);
+    m_model->upsert({ name, modified, fileInfo.size(), countWords(text) });
+    m_listDirty = true;
+}
+
+bool FileManager::checkDocument(const QString &name, int *reads)
+{
+    QFileInfo fileInfo(fullPath(name));
+    if (!fileInfo.exists()) {
+        m_index.remove(name);
+        if (!m_model->contains(name)) return false;
+        m_model->remove(name);
+        m_listDirty = true;
+        return true;
+    }
+
+    // Unchanged since it was last read: nothing to do
+    const qint64 modified = fileInfo.lastModified().toMSecsSinceEpoch();
+    const DocumentInfo cached = m_model->document(name);
+    if (cached.modified == modified && cached.size == fileInfo.size()
+            && cached.wordCount >= 0 && m_index.modified(name) == modified) {
+        return false;
+    }
+
+    indexDocument(name);
+    ++*reads;
+    return true;
+}
+
+void FileManager::processIndexQueue()
+{
+    bool changed = false;
+    int reads = 0;
+    for (int checks = 0; checks < CHECK_BATCH && reads < INDEX_BATCH && !m_indexQueue.isEmpty(); ++checks) {
+        changed |= checkDocument(m_indexQueue.takeFirst(), &reads);
+    }
+
+    if (changed) {
+        documentsUpdated();
+    }
+    if (m_indexQueue.isEmpty()) {
+        m_indexTimer->stop();
+        scheduleSave();
+    }
+}
+
+void FileManager::documentsUpdated()
+{
+    m_documents = m_model->names();
+    m_matcher.setCandidates(m_documents);
+    emit documentsChanged();
+}
+
+void FileManager::scheduleSave()
+{
+    if ((m_index.isDirty() || m_listDirty) && !m_saveTimer->isActive()) {
+        m_saveTimer->start();
+    }
+}
+
+void FileManager::saveState()
+{
+    m_index.save();
+    if (m_listDirty && !m_documentDirectory.isEmpty()) {
+        m_listDirty = !m_model->save(m_documentDirectory + "/" + METADATA_FILE);
+    }
+}
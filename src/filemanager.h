@@ -12,32 +12,59 @@
 
 #include <QObject>
 #include <QString>
+#include <QSet>
 #include <QStringList>
+#include "searchindex.h"
+#include "fuzzymatcher.h"
+#include "documentlistmodel.h"
+
+class QTimer;
+class QFileSystemWatcher;
 
 /**
  * @brief The FileManager class handles file system operations.
  *
  * This class provides methods for listing, creating, and deleting documents.
  * It exposes functionality to QML for the file picker interface.
+ *
+ * The documents are listed by a DocumentListModel. Its metadata (mtime, size,
+ * word count) is cached in the document directory, so at start-up the list
+ * is shown straight from the cache. Every document is then checked against
+ * the disk in the background. A QFileSystemWatcher notices documents that
+ * appear or disappear, and the app's own operations update single rows.
+ *
+ * It also keeps a full-text SearchIndex of the documents. Documents are
+ * (re)indexed when created, saved or found changed, a few at a time, so a
+ * large first indexing run does not freeze the UI.
  */
 class FileManager : public QObject
 {
     Q_OBJECT
     Q_PROPERTY(QString documentDirectory READ documentDirectory WRITE setDocumentDirectory NOTIFY documentDirectoryChanged)
     Q_PROPERTY(QStringList documents READ documents NOTIFY documentsChanged)
+    Q_PROPERTY(QAbstractListModel *documentModel READ documentModel CONSTANT)
 
 public:
     explicit FileManager(QObject *parent = nullptr);
+    ~FileManager();
 
     // Property getters
     QString documentDirectory() const;
     QStringList documents() const;
+    QAbstractListModel *documentModel() const;
 
     // Property setters
     void setDocumentDirectory(const QString &path);
 
 public slots:
     // Document operations
+
+    /**
+     * @brief refreshDocuments - Pick up documents added, removed or edited behind our back
+     *
+     * Rechecks every known document; directory changes alone only look for
+     * documents that came or went.
+     */
     void refreshDocuments();
     QString createDocument(const QString &name);
     bool deleteDocument(const QString &name);
@@ -49,7 +76,23 @@ public slots:
     QString baseName(const QString &path) const;
 
     // Search
-    QStringList searchDocuments(const QString &query) const;
+
+    /**
+     * @brief searchDocuments - Document names fuzzy-matching query, best first
+     *
+     * An empty query gives every document, newest first.
+     */
+    QStringList searchDocuments(const QString &query, int limit = 50) const;
+
+    /**
+     * @brief searchContent - Documents whose text matches query, best first
+     */
+    QStringList searchContent(const QString &query, int limit = 20) const;
+
+    /**
+     * @brief documentSaved - Reindex the document at path after it was written
+     */
+    void documentSaved(const QString &path);
 
 signals:
     void documentDirectoryChanged();
@@ -60,10 +103,40 @@ signals:
     void errorOccurred(const QString &message);
 
 private:
+    void rescanDirectory();
+    void indexDocument(const QString &name);
+    void processIndexQueue();
+    bool checkDocument(const QString &name, int *reads);
+    void documentsUpdated();
+    void scheduleSave();
+    void saveState();
+
     QString m_documentDirectory;
-    QStringList m_documents;
+    QStringList m_documents;        // Names in model order
+
+    // Listing
+    DocumentListModel *m_model;
+    QFileSystemWatcher *m_watcher;
+    QTimer *m_rescanTimer;
+    QSet<QString> m_listedFiles;    // Document files at the last rescan
+    bool m_listDirty;               // Metadata cache needs saving
+
+    // Name search; the matcher remembers the last query between calls
+    mutable FuzzyMatcher m_matcher;
+
+    // Full-text search
+    SearchIndex m_index;
+    QStringList m_indexQueue;       // Documents to check, and (re)index if changed
+    QTimer *m_indexTimer;
+    QTimer *m_saveTimer;            // Index and metadata cache
 
     static const QString FILE_EXTENSION;
+    static const QString INDEX_FILE;
+    static const QString METADATA_FILE;
+    static const int INDEX_BATCH = 25;      // Documents read per event-loop turn
+    static const int CHECK_BATCH = 200;     // Documents stat'ed per event-loop turn
+    static const int SAVE_DELAY_MS = 3000;
+    static const int RESCAN_DELAY_MS = 250;
 };
 
 #endif // FILEMANAGER_H
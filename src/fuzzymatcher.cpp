@@ -0,0 +1,178 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * fuzzymatcher.cpp - Ranked fuzzy matching of document names
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#include "fuzzymatcher.h"
+#include <algorithm>
+
+namespace {
+
+bool isSeparator(QChar ch)
+{
+    return ch.isSpace() || ch == '-' || ch == '_' || ch == '.' || ch == '/' || ch == '(';
+}
+
+} // namespace
+
+FuzzyMatcher::FuzzyMatcher()
+    : m_hasLast(false)
+{
+}
+
+void FuzzyMatcher::setCandidates(const QStringList &names)
+{
+    m_chars.clear();
+    m_bonus.clear();
+    m_offsets.clear();
+    m_hasLast = false;
+
+    int total = 0;
+    for (const QString &name : names) total += name.size();
+    m_chars.reserve(total);
+    m_bonus.reserve(total);
+    m_offsets.reserve(names.size() + 1);
+
+    for (const QString &name : names) {
+        m_offsets.append(m_chars.size());
+
+        QChar previous;
+        for (int i = 0; i < name.size(); ++i) {
+            const QChar ch = name.at(i);
+            int bonus = 0;
+            if (i == 0 || isSeparator(previous)) {
+                bonus = BONUS_BOUNDARY;
+            } else if ((previous.isLower() && ch.isUpper())
+                       || (!previous.isDigit() && ch.isDigit())) {
+                bonus = BONUS_CAMEL;
+            }
+
+            m_chars.append(ch.toLower().unicode());
+            m_bonus.append(static_cast<uchar>(bonus));
+            previous = ch;
+        }
+    }
+    m_offsets.append(m_chars.size());
+}
+
+int FuzzyMatcher::candidateCount() const
+{
+    return m_offsets.size() - 1;
+}
+
+int FuzzyMatcher::score(int candidate, const QVector<ushort> &query) const
+{
+    const ushort *text = m_chars.constData() + m_offsets[candidate];
+    const uchar *bonus = m_bonus.constData() + m_offsets[candidate];
+    const int length = m_offsets[candidate + 1] - m_offsets[candidate];
+    const int q = query.size();
+    if (q > length) return -1;
+
+    // Forward: earliest position where the whole query has matched
+    int end = -1;
+    for (int i = 0, j = 0; i < length; ++i) {
+        if (text[i] == query[j] && ++j == q) {
+            end = i;
+            break;
+        }
+    }
+    if (end < 0) return -1;
+
+    // Backward from there: the latest start, i.e. the shortest window
+    int start = end;
+    for (int j = q - 1; start >= 0; --start) {
+        if (text[start] == query[j] && --j < 0) break;
+    }
+
+    // Score the window: matched characters, bonuses, gaps
+    int total = 0;
+    int j = 0;
+    int consecutive = 0;
+    bool inGap = false;
+    for (int i = start; i <= end; ++i) {
+        if (j < q && text[i] == query[j]) {
+            int charBonus = bonus[i];
+            if (consecutive > 0) {
+                charBonus = qMax(charBonus, int(BONUS_CONSECUTIVE));
+            }
+            if (j == 0) {
+                charBonus *= FIRST_CHAR_MULTIPLIER;
+            }
+            total += SCORE_MATCH + charBonus;
+            ++consecutive;
+            inGap = false;
+            ++j;
+        } else {
+            total += inGap ? GAP_EXTENSION : GAP_START;
+            consecutive = 0;
+            inGap = true;
+        }
+    }
+
+    return total;
+}
+
+QList<FuzzyMatcher::Match> FuzzyMatcher::match(const QString &query, int limit)
+{
+    QList<Match> results;
+
+    QVector<ushort> folded;
+    folded.reserve(query.size());
+    for (const QChar &ch : query) {
+        if (!ch.isSpace()) folded.append(ch.toLower().unicode());
+    }
+
+    if (folded.isEmpty()) {
+        // Nothing to rank by; keep the given order
+        m_hasLast = false;
+        for (int candidate = 0; candidate < qMin(limit, candidateCount()); ++candidate) {
+            results.append({ candidate, 0 });
+        }
+        return results;
+    }
+
+    // Typing on: only the names that matched so far can still match
+    const bool extends = m_hasLast && folded.size() >= m_lastQuery.size()
+        && std::equal(m_lastQuery.constBegin(), m_lastQuery.constEnd(), folded.constBegin());
+
+    QVector<int> matches;
+    QVector<Match> scored;
+    const auto consider = [&](int candidate) {
+        int s = score(candidate, folded);
+        if (s >= 0) {
+            matches.append(candidate);
+            scored.append({ candidate, s });
+        }
+    };
+
+    if (extends) {
+        for (int candidate : m_lastMatches) consider(candidate);
+    } else {
+        for (int candidate = 0; candidate < candidateCount(); ++candidate) consider(candidate);
+    }
+
+    m_lastQuery = folded;
+    m_lastMatches = matches;
+    m_hasLast = true;
+
+    // Best first; ties go to the shorter name, then the original order
+    const auto better = [this](const Match &a, const Match &b) {
+        if (a.score != b.score) return a.score > b.score;
+        int lengthA = m_offsets[a.index + 1] - m_offsets[a.index];
+        int lengthB = m_offsets[b.index + 1] - m_offsets[b.index];
+        if (lengthA != lengthB) return lengthA < lengthB;
+        return a.index < b.index;
+    };
+    const int count = qBound(0, limit, scored.size());
+    std::partial_sort(scored.begin(), scored.begin() + count, scored.end(), better);
+
+    results.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        results.append(scored[i]);
+    }
+    return results;
+}
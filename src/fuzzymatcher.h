@@ -0,0 +1,72 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * fuzzymatcher.h - Ranked fuzzy matching of document names
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#ifndef FUZZYMATCHER_H
+#define FUZZYMATCHER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QList>
+
+/**
+ * @brief The FuzzyMatcher class ranks names against a query as it is typed.
+ *
+ * A name matches if it contains the query's characters in order. Matches
+ * are scored in the style of fzf: the shortest window holding the
+ * subsequence is found, then every matched character scores, with bonuses for
+ * the start of a word or a camelCase hump and for runs of consecutive
+ * characters, and penalties for gaps.
+ *
+ * The candidates are folded to lower case once, in setCandidates(), and kept
+ * in one contiguous array together with a per-character bonus table, so a
+ * query only walks flat memory. When the query grows by typing, only the
+ * names that matched the shorter query are scanned again.
+ */
+class FuzzyMatcher
+{
+public:
+    struct Match {
+        int index;  // Into the candidates
+        int score;
+    };
+
+    FuzzyMatcher();
+
+    void setCandidates(const QStringList &names);
+    int candidateCount() const;
+
+    /**
+     * @brief match - The best limit candidates for query, highest score first
+     */
+    QList<Match> match(const QString &query, int limit);
+
+    // Scoring, in the spirit of fzf
+    static const int SCORE_MATCH = 16;
+    static const int GAP_START = -3;
+    static const int GAP_EXTENSION = -1;
+    static const int BONUS_BOUNDARY = 8;
+    static const int BONUS_CAMEL = 7;
+    static const int BONUS_CONSECUTIVE = 4;
+    static const int FIRST_CHAR_MULTIPLIER = 2;
+
+private:
+    int score(int candidate, const QVector<ushort> &query) const;
+
+    QVector<ushort> m_chars;    // All names, lower-cased, back to back
+    QVector<uchar> m_bonus;     // Bonus for a match at each position in m_chars
+    QVector<int> m_offsets;     // Start of each name in m_chars; one extra at the end
+
+    // Previous query and every candidate it matched, for incremental typing
+    QVector<ushort> m_lastQuery;
+    QVector<int> m_lastMatches;
+    bool m_hasLast;
+};
+
+#endif // FUZZYMATCHER_H
@@ -8,15 +8,13 @@
  */
 
 #include "inputhandler.h"
+#include "metrics.h"
 #include <QDebug>
-#include <QDir>
 #include <QTimer>
+#include <QStringList>
 
 #ifdef REMARKABLE_PAPERPRO
-#include <fcntl.h>
-#include <unistd.h>
 #include <linux/input.h>
-#include <dirent.h>
 #endif
 
 InputHandler::InputHandler(QObject *parent)
@@ -24,12 +22,22 @@ InputHandler::InputHandler(QObject *parent)
     , m_running(false)
     , m_connected(false)
     , m_currentModifiers(Qt::NoModifier)
+    , m_keyboardLayout(QStringLiteral("us"))
 #ifdef REMARKABLE_PAPERPRO
-    , m_evdev(nullptr)
-    , m_fd(-1)
     , m_inputThread(nullptr)
+    , m_reader(nullptr)
+    , m_altGrPressed(false)
+    , m_frameTimer(new QTimer(this))
 #endif
 {
+#ifdef REMARKABLE_PAPERPRO
+    qRegisterMetaType<QVector<InputKeyEvent>>("QVector<InputKeyEvent>");
+
+    // Releases text that arrived while the previous flush was on screen
+    m_frameTimer->setSingleShot(true);
+    m_frameTimer->setInterval(FRAME_INTERVAL_MS);
+    connect(m_frameTimer, &QTimer::timeout, this, &InputHandler::flushPendingText);
+#endif
 }
 
 InputHandler::~InputHandler()
@@ -47,25 +55,35 @@ QString InputHandler::keyboardName() const
     return m_keyboardName;
 }
 
+QString InputHandler::keyboardLayout() const
+{
+    return m_keyboardLayout;
+}
+
+void InputHandler::setKeyboardLayout(const QString &layout)
+{
+    if (layout == m_keyboardLayout) return;
+
+#ifdef REMARKABLE_PAPERPRO
+    if (!m_keymap.load(layout)) {
+        emit errorOccurred(tr("Unknown keyboard layout: %1 (available: %2)")
+                           .arg(layout, Keymap::availableLayouts().join(QStringLiteral(", "))));
+        return;
+    }
+    m_keyboardLayout = m_keymap.name();
+#else
+    m_keyboardLayout = layout;
+#endif
+    emit keyboardLayoutChanged();
+}
+
 void InputHandler::start()
 {
 #ifdef REMARKABLE_PAPERPRO
     if (m_running) return;
 
     m_running = true;
-    findKeyboardDevice();
-
-    if (m_connected) {
-        // Start polling for events
-        QTimer *timer = new QTimer(this);
-        connect(timer, &QTimer::timeout, this, &InputHandler::processEvents);
-        timer->start(10); // 10ms polling interval
-    } else {
-        // Retry finding keyboard periodically
-        QTimer *scanTimer = new QTimer(this);
-        connect(scanTimer, &QTimer::timeout, this, &InputHandler::scanForKeyboards);
-        scanTimer->start(2000); // Scan every 2 seconds
-    }
+    startReader();
 #else
     qDebug() << "InputHandler: Running in development mode, using Qt keyboard handling";
     m_running = true;
@@ -76,16 +94,11 @@ void InputHandler::stop()
 {
 #ifdef REMARKABLE_PAPERPRO
     m_running = false;
-
-    if (m_evdev) {
-        libevdev_free(m_evdev);
-        m_evdev = nullptr;
-    }
-
-    if (m_fd >= 0) {
-        close(m_fd);
-        m_fd = -1;
-    }
+    stopReader();
+    flushPendingText();
+    m_frameTimer->stop();
+    m_keyboards.clear();
+    m_keyboardName.clear();
 #endif
 
     m_connected = false;
@@ -94,85 +107,106 @@ void InputHandler::stop()
 
 void InputHandler::scanForKeyboards()
 {
-    if (!m_connected) {
-        findKeyboardDevice();
-    }
+    findKeyboardDevice();
 }
 
 #ifdef REMARKABLE_PAPERPRO
 void InputHandler::findKeyboardDevice()
 {
-    // Scan /dev/input/ for keyboard devices
-    const char *inputDir = "/dev/input";
-    DIR *dir = opendir(inputDir);
-    if (!dir) {
-        emit errorOccurred(tr("Cannot open input device directory"));
-        return;
+    // Hotplug is picked up by the reader; this forces a full probe
+    if (m_reader) {
+        m_reader->rescan();
     }
+}
+
+void InputHandler::startReader()
+{
+    if (m_inputThread) return;
 
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != nullptr) {
-        if (strncmp(entry->d_name, "event", 5) != 0) continue;
+    m_inputThread = new QThread(this);
+    m_reader = new EvdevReader();
+    m_reader->moveToThread(m_inputThread);
 
-        QString devicePath = QString("%1/%2").arg(inputDir, entry->d_name);
-        int fd = open(devicePath.toUtf8().constData(), O_RDONLY | O_NONBLOCK);
-        if (fd < 0) continue;
+    connect(m_inputThread, &QThread::started, m_reader, &EvdevReader::run);
+    connect(m_reader, &EvdevReader::finished, m_inputThread, &QThread::quit);
 
-        struct libevdev *evdev = nullptr;
-        int rc = libevdev_new_from_fd(fd, &evdev);
-        if (rc < 0) {
-            close(fd);
-            continue;
+    // Queued: batches are read on the input thread, handled on ours
+    connect(m_reader, &EvdevReader::keyEventsRead, this,
+            [this](const QVector<InputKeyEvent> &events) {
+        for (const InputKeyEvent &event : events) {
+            handleKeyEvent(event.code, event.value);
+        }
+        // Start of a burst: show it now rather than a frame later
+        if (!m_frameTimer->isActive()) {
+            flushPendingText();
+        }
+        // Nothing left to edit: these keys were releases, modifiers or
+        // shortcuts, and must not be counted against the next keystroke
+        if (m_pendingText.isEmpty()) {
+            Metrics::instance().dropInput();
         }
+    });
+    connect(m_reader, &EvdevReader::keyboardAdded, this, &InputHandler::handleKeyboardAdded);
+    connect(m_reader, &EvdevReader::keyboardRemoved, this, &InputHandler::handleKeyboardRemoved);
 
-        // Check if this is a keyboard (has KEY_A capability)
-        if (libevdev_has_event_code(evdev, EV_KEY, KEY_A)) {
-            m_devicePath = devicePath;
-            m_fd = fd;
-            m_evdev = evdev;
-            m_keyboardName = QString::fromUtf8(libevdev_get_name(evdev));
-            m_connected = true;
+    m_inputThread->start();
+}
 
-            qDebug() << "Found keyboard:" << m_keyboardName << "at" << m_devicePath;
-            emit keyboardConnected(m_keyboardName);
-            emit connectionChanged();
+void InputHandler::stopReader()
+{
+    if (!m_inputThread) return;
 
-            closedir(dir);
-            return;
-        }
+    m_reader->stop();
+    m_inputThread->quit();
+    m_inputThread->wait();
 
-        libevdev_free(evdev);
-        close(fd);
-    }
+    delete m_reader;
+    m_reader = nullptr;
+    delete m_inputThread;
+    m_inputThread = nullptr;
+}
 
-    closedir(dir);
+void InputHandler::handleKeyboardAdded(const QString &path, const QString &name)
+{
+    m_keyboards.insert(path, name);
+    updateConnection();
+    emit keyboardConnected(name);
 }
 
-void InputHandler::processEvents()
+void InputHandler::handleKeyboardRemoved(const QString &path)
 {
-    if (!m_evdev || !m_running) return;
+    if (!m_keyboards.remove(path)) return;
+
+    flushPendingText();
+    // Keys held on the unplugged device will never send their release
+    m_currentModifiers = Qt::NoModifier;
+    m_altGrPressed = false;
+    updateConnection();
+    emit keyboardDisconnected();
+}
 
-    struct input_event ev;
-    int rc;
+void InputHandler::updateConnection()
+{
+    m_connected = !m_keyboards.isEmpty();
+    m_keyboardName = QStringList(m_keyboards.values()).join(QStringLiteral(", "));
+    emit connectionChanged();
+}
 
-    while ((rc = libevdev_next_event(m_evdev, LIBEVDEV_READ_FLAG_NORMAL, &ev)) == 0) {
-        if (ev.type == EV_KEY) {
-            handleKeyEvent(ev.code, ev.value);
-        }
-    }
+void InputHandler::queueText(const QString &text)
+{
+    m_pendingText += text;
+}
 
-    // Check for device disconnection
-    if (rc == -ENODEV) {
-        m_connected = false;
-        m_keyboardName.clear();
-        libevdev_free(m_evdev);
-        m_evdev = nullptr;
-        close(m_fd);
-        m_fd = -1;
-
-        emit keyboardDisconnected();
-        emit connectionChanged();
-    }
+void InputHandler::flushPendingText()
+{
+    if (m_pendingText.isEmpty()) return;
+
+    QString text = m_pendingText;
+    m_pendingText.clear();
+    emit textEntered(text);
+
+    // Anything typed during the next frame is held back and sent together
+    m_frameTimer->start();
 }
 
 void InputHandler::handleKeyEvent(unsigned int keyCode, int value)
@@ -199,17 +233,28 @@ void InputHandler::handleKeyEvent(unsigned int keyCode, int value)
             return;
 
         case KEY_LEFTALT:
-        case KEY_RIGHTALT:
             if (pressed)
                 m_currentModifiers |= Qt::AltModifier;
             else
                 m_currentModifiers &= ~Qt::AltModifier;
             return;
+
+        case KEY_RIGHTALT:
+            // AltGr selects the third level of the layout
+            m_altGrPressed = pressed;
+            return;
     }
 
     // Only handle key presses (not releases) for most keys
     if (!pressed) return;
 
+    // Shortcuts and editing keys act on the document as it is now, so apply
+    // any queued text before them
+    QString keyStr = keyCodeToString(keyCode);
+    if (keyStr.isEmpty() || (m_currentModifiers & Qt::ControlModifier)) {
+        flushPendingText();
+    }
+
     // Check for keyboard shortcuts first
     if (m_currentModifiers & Qt::ControlModifier) {
         switch (keyCode) {
@@ -224,6 +269,12 @@ void InputHandler::handleKeyEvent(unsigned int keyCode, int value)
                     emit undoRequested();
                 return;
             case KEY_Y: emit redoRequested(); return;
+            case KEY_M:
+                if (m_currentModifiers & Qt::ShiftModifier) {
+                    emit metricsOverlayRequested();
+                    return;
+                }
+                break;
             case KEY_EQUAL: // Ctrl++ (= key)
             case KEY_KPPLUS:
                 emit fontIncreaseRequested(); return;
@@ -269,10 +320,10 @@ void InputHandler::handleKeyEvent(unsigned int keyCode, int value)
             return;
     }
 
-    // Convert key code to string and emit
-    QString keyStr = keyCodeToString(keyCode);
+    // Queue the character for the next frame and emit
     if (!keyStr.isEmpty()) {
         if (pressed) {
+            queueText(keyStr);
             emit keyPressed(keyStr, m_currentModifiers);
         } else {
             emit keyReleased(keyStr, m_currentModifiers);
@@ -282,54 +333,13 @@ void InputHandler::handleKeyEvent(unsigned int keyCode, int value)
 
 QString InputHandler::keyCodeToString(unsigned int keyCode) const
 {
-    // Handle shift modifier for uppercase
-    bool shift = (m_currentModifiers & Qt::ShiftModifier);
-
-    // Letter keys
-    if (keyCode >= KEY_Q && keyCode <= KEY_P) {
-        static const char letters[] = "qwertyuiop";
-        char c = letters[keyCode - KEY_Q];
-        return QString(shift ? QChar(c).toUpper() : QChar(c));
-    }
-
-    if (keyCode >= KEY_A && keyCode <= KEY_L) {
-        static const char letters[] = "asdfghjkl";
-        char c = letters[keyCode - KEY_A];
-        return QString(shift ? QChar(c).toUpper() : QChar(c));
-    }
-
-    if (keyCode >= KEY_Z && keyCode <= KEY_M) {
-        static const char letters[] = "zxcvbnm";
-        char c = letters[keyCode - KEY_Z];
-        return QString(shift ? QChar(c).toUpper() : QChar(c));
-    }
-
-    // Number keys
-    if (keyCode >= KEY_1 && keyCode <= KEY_0) {
-        static const char numbers[] = "1234567890";
-        static const char shifted[] = "!@#$%^&*()";
-        int idx = (keyCode == KEY_0) ? 9 : (keyCode - KEY_1);
-        return QString(QChar(shift ? shifted[idx] : numbers[idx]));
+    const Keymap::Level level = (m_currentModifiers & Qt::ShiftModifier) ? Keymap::Shift : Keymap::Plain;
+    if (m_altGrPressed) {
+        // Like xkb, a key without a third level types its usual character
+        const QString &text = m_keymap.text(keyCode, Keymap::AltGr);
+        if (!text.isEmpty()) return text;
     }
-
-    // Other characters
-    switch (keyCode) {
-        case KEY_SPACE: return " ";
-        case KEY_TAB: return "\t";
-        case KEY_MINUS: return shift ? "_" : "-";
-        case KEY_EQUAL: return shift ? "+" : "=";
-        case KEY_LEFTBRACE: return shift ? "{" : "[";
-        case KEY_RIGHTBRACE: return shift ? "}" : "]";
-        case KEY_SEMICOLON: return shift ? ":" : ";";
-        case KEY_APOSTROPHE: return shift ? "\"" : "'";
-        case KEY_GRAVE: return shift ? "~" : "`";
-        case KEY_BACKSLASH: return shift ? "|" : "\\";
-        case KEY_COMMA: return shift ? "<" : ",";
-        case KEY_DOT: return shift ? ">" : ".";
-        case KEY_SLASH: return shift ? "?" : "/";
-    }
-
-    return QString();
+    return m_keymap.text(keyCode, level);
 }
 
 #else // !REMARKABLE_PAPERPRO
@@ -343,11 +353,6 @@ void InputHandler::findKeyboardDevice()
     emit connectionChanged();
 }
 
-void InputHandler::processEvents()
-{
-    // In development mode, Qt handles keyboard events
-}
-
 void InputHandler::handleKeyEvent(unsigned int keyCode, int value)
 {
     Q_UNUSED(keyCode);
@@ -13,23 +13,40 @@
 #include <QObject>
 #include <QThread>
 #include <QString>
+#include <QMap>
 
 #ifdef REMARKABLE_PAPERPRO
-#include <libevdev/libevdev.h>
+#include "evdevreader.h"
+#include "keymap.h"
 #endif
 
+class QTimer;
+
 /**
  * @brief The InputHandler class manages keyboard input on the reMarkable.
  *
  * On the Paper Pro, this class uses libevdev to directly read keyboard events
  * from USB keyboards connected via USB-C OTG. In development builds, it falls
  * back to Qt's built-in keyboard handling.
+ *
+ * Devices are discovered and read on m_inputThread, which blocks until the
+ * kernel has events; batches are then handled here on the GUI thread. Several
+ * keyboards can be connected at once; keyboardName lists all of them.
+ *
+ * Printable characters are delivered through textEntered() at most once per
+ * display frame: the first keystroke of a burst goes out immediately, and
+ * whatever arrives during the following frame is sent as one string. That
+ * keeps fast typing and key repeat to one edit and one refresh per frame.
+ * Any other key flushes the queued text first so ordering is preserved.
+ *
+ * Key codes are translated through the Keymap selected by keyboardLayout.
  */
 class InputHandler : public QObject
 {
     Q_OBJECT
     Q_PROPERTY(bool connected READ isConnected NOTIFY connectionChanged)
     Q_PROPERTY(QString keyboardName READ keyboardName NOTIFY connectionChanged)
+    Q_PROPERTY(QString keyboardLayout READ keyboardLayout WRITE setKeyboardLayout NOTIFY keyboardLayoutChanged)
 
 public:
     explicit InputHandler(QObject *parent = nullptr);
@@ -38,6 +55,10 @@ public:
     // Property getters
     bool isConnected() const;
     QString keyboardName() const;
+    QString keyboardLayout() const;
+
+    // Property setters
+    void setKeyboardLayout(const QString &layout);
 
 public slots:
     void start();
@@ -46,6 +67,7 @@ public slots:
 
 signals:
     // Key events
+    void textEntered(const QString &text); // Coalesced printable input
     void keyPressed(const QString &key, Qt::KeyboardModifiers modifiers);
     void keyReleased(const QString &key, Qt::KeyboardModifiers modifiers);
 
@@ -67,17 +89,17 @@ signals:
     void fontDecreaseRequested(); // Ctrl+-
     void aiTransformRequested(); // Ctrl+T
     void aiSettingsRequested();  // Ctrl+,
+    void metricsOverlayRequested(); // Ctrl+Shift+M
     void selectionArrowPressed(int direction); // Shift+Arrow (0=up, 1=down, 2=left, 3=right)
 
+    void keyboardLayoutChanged();
+
     // Connection status
     void connectionChanged();
     void keyboardConnected(const QString &name);
     void keyboardDisconnected();
     void errorOccurred(const QString &message);
 
-private slots:
-    void processEvents();
-
 private:
     void findKeyboardDevice();
     QString keyCodeToString(unsigned int keyCode) const;
@@ -86,14 +108,30 @@ private:
     bool m_running;
     bool m_connected;
     QString m_keyboardName;
-    QString m_devicePath;
 
     Qt::KeyboardModifiers m_currentModifiers;
+    QString m_keyboardLayout;
 
 #ifdef REMARKABLE_PAPERPRO
-    struct libevdev *m_evdev;
-    int m_fd;
+    void startReader();
+    void stopReader();
+    void handleKeyboardAdded(const QString &path, const QString &name);
+    void handleKeyboardRemoved(const QString &path);
+    void updateConnection();
+    void queueText(const QString &text);
+    void flushPendingText();
+
     QThread *m_inputThread;
+    EvdevReader *m_reader;
+    QMap<QString, QString> m_keyboards; // Device path -> name
+    Keymap m_keymap;
+    bool m_altGrPressed;
+
+    // Text typed since the last flush, released once per frame
+    QString m_pendingText;
+    QTimer *m_frameTimer;
+
+    static const int FRAME_INTERVAL_MS = 16;
 #endif
 };
 
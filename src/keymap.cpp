@@ -0,0 +1,149 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * keymap.cpp - Keyboard layout tables
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#include "keymap.h"
+
+#include <array>
+#include <linux/input.h>
+
+namespace {
+
+using KeyTable = std::array<char16_t, Keymap::KEY_COUNT>;
+
+/**
+ * One modifier level of a layout, written as the characters along each
+ * physical key row from left to right. A space marks a key that types
+ * nothing at this level (the space bar itself is added separately).
+ */
+struct LevelRows {
+    const char16_t *number; // KEY_1 .. KEY_EQUAL, 12 keys
+    const char16_t *top;    // KEY_Q .. KEY_RIGHTBRACE, 12 keys
+    const char16_t *home;   // KEY_A .. KEY_GRAVE, 12 keys
+    char16_t backslash;     // KEY_BACKSLASH
+    const char16_t *bottom; // KEY_Z .. KEY_SLASH, 10 keys
+    char16_t iso;           // KEY_102ND, the extra key on ISO keyboards
+};
+
+struct Layout {
+    const char *name;
+    KeyTable levels[Keymap::LevelCount];
+};
+
+// Not constexpr on purpose: reaching it while building a table is a
+// compile error, which catches rows of the wrong length
+inline void layoutRowHasWrongLength() {}
+
+constexpr int rowLength(const char16_t *row)
+{
+    int length = 0;
+    while (row[length]) ++length;
+    return length;
+}
+
+constexpr void placeKey(KeyTable &table, int keyCode, char16_t ch)
+{
+    if (ch != u' ') table[keyCode] = ch;
+}
+
+constexpr void placeRow(KeyTable &table, int firstKeyCode, const char16_t *row, int keys)
+{
+    if (rowLength(row) != keys) layoutRowHasWrongLength();
+    for (int i = 0; i < keys; ++i) {
+        placeKey(table, firstKeyCode + i, row[i]);
+    }
+}
+
+constexpr KeyTable buildLevel(const LevelRows &rows)
+{
+    KeyTable table{};
+    placeRow(table, KEY_1, rows.number, 12);
+    placeRow(table, KEY_Q, rows.top, 12);
+    placeRow(table, KEY_A, rows.home, 12);
+    placeKey(table, KEY_BACKSLASH, rows.backslash);
+    placeRow(table, KEY_Z, rows.bottom, 10);
+    placeKey(table, KEY_102ND, rows.iso);
+    table[KEY_TAB] = u'\t';
+    table[KEY_SPACE] = u' ';
+    return table;
+}
+
+constexpr LevelRows NO_ALTGR = {
+    u"            ", u"            ", u"            ", u' ', u"          ", u' '
+};
+
+constexpr Layout LAYOUTS[] = {
+    { "us", {
+        buildLevel({ u"1234567890-=", u"qwertyuiop[]", u"asdfghjkl;'`", u'\\', u"zxcvbnm,./", u'\\' }),
+        buildLevel({ u"!@#$%^&*()_+", u"QWERTYUIOP{}", u"ASDFGHJKL:\"~", u'|', u"ZXCVBNM<>?", u'|' }),
+        buildLevel(NO_ALTGR),
+    } },
+    { "de", {
+        buildLevel({ u"1234567890ß´", u"qwertzuiopü+", u"asdfghjklöä^",
+                     u'#', u"yxcvbnm,.-", u'<' }),
+        buildLevel({ u"!\"§$%&/()=?`", u"QWERTZUIOPÜ*", u"ASDFGHJKLÖÄ°",
+                     u'\'', u"YXCVBNM;:_", u'>' }),
+        buildLevel({ u" ²³   {[]}\\ ", u"@ €        ~", u"            ",
+                     u' ', u"      µ   ", u'|' }),
+    } },
+    { "fr", {
+        buildLevel({ u"&é\"'(-è_çà)=", u"azertyuiop^$", u"qsdfghjklmù²",
+                     u'*', u"wxcvbn,;:!", u'<' }),
+        buildLevel({ u"1234567890°+", u"AZERTYUIOP¨£", u"QSDFGHJKLM% ",
+                     u'µ', u"WXCVBN?./§", u'>' }),
+        buildLevel({ u" ~#{[|`\\^@]}", u"  €        ¤", u"            ",
+                     u' ', u"          ", u' ' }),
+    } },
+    { "dvorak", {
+        buildLevel({ u"1234567890[]", u"',.pyfgcrl/=", u"aoeuidhtns-`", u'\\', u";qjkxbmwvz", u'\\' }),
+        buildLevel({ u"!@#$%^&*(){}", u"\"<>PYFGCRL?+", u"AOEUIDHTNS_~", u'|', u":QJKXBMWVZ", u'|' }),
+        buildLevel(NO_ALTGR),
+    } },
+};
+
+static_assert(LAYOUTS[0].levels[Keymap::Shift][KEY_A] == u'A', "US layout is not QWERTY");
+static_assert(LAYOUTS[1].levels[Keymap::Plain][KEY_Y] == u'z', "German layout is not QWERTZ");
+static_assert(LAYOUTS[2].levels[Keymap::Plain][KEY_Q] == u'a', "French layout is not AZERTY");
+
+} // namespace
+
+Keymap::Keymap()
+{
+    load(QStringLiteral("us"));
+}
+
+bool Keymap::load(const QString &name)
+{
+    for (const Layout &layout : LAYOUTS) {
+        if (name.compare(QLatin1String(layout.name), Qt::CaseInsensitive) != 0) continue;
+
+        for (int level = 0; level < LevelCount; ++level) {
+            for (int code = 0; code < KEY_COUNT; ++code) {
+                char16_t ch = layout.levels[level][code];
+                m_strings[level][code] = ch ? QString(QChar(ch)) : QString();
+            }
+        }
+        m_name = QLatin1String(layout.name);
+        return true;
+    }
+    return false;
+}
+
+QString Keymap::name() const
+{
+    return m_name;
+}
+
+QStringList Keymap::availableLayouts()
+{
+    QStringList names;
+    for (const Layout &layout : LAYOUTS) {
+        names << QLatin1String(layout.name);
+    }
+    return names;
+}
@@ -0,0 +1,65 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * keymap.h - Keyboard layouts mapping evdev key codes to text
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#ifndef KEYMAP_H
+#define KEYMAP_H
+
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief The Keymap class translates evdev key codes into typed text.
+ *
+ * Each layout (us, de, fr, dvorak) is a compile-time table indexed by
+ * modifier level and key code. load() turns the chosen table into
+ * preallocated strings once, so looking up a key is a single array index
+ * and never allocates.
+ *
+ * Dead keys (´ ^ ` ¨ on the European layouts) type their spacing
+ * character directly; there is no compose step.
+ */
+class Keymap
+{
+public:
+    enum Level {
+        Plain,
+        Shift,
+        AltGr,
+        LevelCount
+    };
+
+    // Covers every key that produces a character (KEY_102ND is 86)
+    static const int KEY_COUNT = 128;
+
+    Keymap();
+
+    /**
+     * @brief load - Switch to the named layout
+     * @return false (keeping the current layout) if the name is unknown
+     */
+    bool load(const QString &name);
+    QString name() const;
+
+    static QStringList availableLayouts();
+
+    /**
+     * @brief text - Text typed by keyCode at the given level, empty if none
+     */
+    const QString &text(unsigned int keyCode, Level level) const
+    {
+        // KEY_RESERVED (0) never types anything, so it doubles as "empty"
+        return m_strings[level][keyCode < KEY_COUNT ? keyCode : 0];
+    }
+
+private:
+    QString m_name;
+    QString m_strings[LevelCount][KEY_COUNT];
+};
+
+#endif // KEYMAP_H
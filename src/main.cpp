@@ -11,7 +11,10 @@
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
 #include <QQuickStyle>
+#include <QQuickWindow>
+#include <QElapsedTimer>
 #include <QDir>
+#include <memory>
 
 #include "editor.h"
 #include "filemanager.h"
@@ -20,9 +23,34 @@
 #include "aiclient.h"
 #include "aitransform.h"
 #include "mermaidrenderer.h"
+#include "metrics.h"
+#include "refreshscheduler.h"
+
+namespace {
+
+QElapsedTimer startupClock;
+
+/**
+ * Log how long the startup phase that just ended took, when
+ * GHOSTWRITER_TRACE_STARTUP is set.
+ */
+void traceStartup(const char *phase)
+{
+    static const bool enabled = qEnvironmentVariableIsSet("GHOSTWRITER_TRACE_STARTUP");
+    static qint64 last = 0;
+    if (!enabled) return;
+
+    qint64 now = startupClock.elapsed();
+    qInfo("startup: %-16s %5lld ms  (+%lld ms)", phase, now, now - last);
+    last = now;
+}
+
+} // namespace
 
 int main(int argc, char *argv[])
 {
+    startupClock.start();
+
     // Set application attributes
     QCoreApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
 
@@ -33,12 +61,17 @@ int main(int argc, char *argv[])
 
     // Use Basic style for minimal overhead on e-ink
     QQuickStyle::setStyle("Basic");
+    traceStartup("application");
 
-    // Create application components
+    // Create application components; the metrics outlive the rest so that
+    // the last dump has everything
+    MetricsReporter metrics;
     Editor editor;
     FileManager fileManager;
     InputHandler inputHandler;
-    AITransform aiTransform;
+    RefreshScheduler refreshScheduler;
+    AITransform aiTransform;   // AI client and renderer start on first use
+    traceStartup("components");
 
     // Set up default document directory
 #ifdef REMARKABLE_PAPERPRO
@@ -52,10 +85,29 @@ int main(int argc, char *argv[])
         dir.mkpath(".");
     }
     fileManager.setDocumentDirectory(documentDir);
+    traceStartup("documents");
+
+    // GHOSTWRITER_METRICS=<seconds> dumps the metrics next to the documents
+    if (qEnvironmentVariableIsSet("GHOSTWRITER_METRICS")) {
+        int seconds = qEnvironmentVariableIntValue("GHOSTWRITER_METRICS");
+        metrics.setDumpFile(documentDir + "/.metrics.json", seconds * 1000);
+    }
+
+    // Keep the search index current as documents are saved
+    QObject::connect(&editor, &Editor::documentSaved, &fileManager, [&editor, &fileManager]() {
+        fileManager.documentSaved(editor.currentFile());
+    });
+
+    // The editor view redraws when the scheduler says so
+    refreshScheduler.setEditor(&editor);
+#ifdef REMARKABLE_PAPERPRO
+    refreshScheduler.setGhostingCleanup(true);
+#endif
 
     // Set up AI components
     aiTransform.setEditor(&editor);
     aiTransform.setConfigDirectory(documentDir);
+    traceStartup("ai config");
 
     // Set up QML engine
     QQmlApplicationEngine engine;
@@ -67,6 +119,8 @@ int main(int argc, char *argv[])
     engine.rootContext()->setContextProperty("documentDir", documentDir);
     engine.rootContext()->setContextProperty("aiTransform", &aiTransform);
     engine.rootContext()->setContextProperty("aiConfig", aiTransform.config());
+    engine.rootContext()->setContextProperty("metrics", &metrics);
+    engine.rootContext()->setContextProperty("refreshScheduler", &refreshScheduler);
 
     // Load main QML file
     const QUrl url(QStringLiteral("qrc:/qml/main.qml"));
@@ -77,11 +131,27 @@ int main(int argc, char *argv[])
     }, Qt::QueuedConnection);
 
     engine.load(url);
+    traceStartup("qml loaded");
+
+    // The editor is usable once its first frame is on screen
+    if (!engine.rootObjects().isEmpty()) {
+        if (auto *window = qobject_cast<QQuickWindow *>(engine.rootObjects().first())) {
+            auto traced = std::make_shared<QMetaObject::Connection>();
+            *traced = QObject::connect(window, &QQuickWindow::frameSwapped, window, [traced]() {
+                traceStartup("first frame");
+                QObject::disconnect(*traced);
+            });
+        }
+    }
 
     // Start keyboard input handler
 #ifdef REMARKABLE_PAPERPRO
+    if (qEnvironmentVariableIsSet("GHOSTWRITER_KEYBOARD_LAYOUT")) {
+        inputHandler.setKeyboardLayout(qEnvironmentVariable("GHOSTWRITER_KEYBOARD_LAYOUT"));
+    }
     inputHandler.start();
 #endif
+    traceStartup("input");
 
     return app.exec();
 }
@@ -0,0 +1,74 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * mermaid-worker.mjs - Long-lived Mermaid render worker for MermaidRenderer
+ *
+ * Reads one JSON request per line from stdin:
+ *   {"id": "...", "code": "...", "format": "svg"|"png", "output": "/path"}
+ * and answers each with one line on stdout:
+ *   {"id": "...", "ok": true} or {"id": "...", "ok": false, "error": "..."}
+ *
+ * One headless browser is started on the first request and reused for every
+ * diagram after that. Requests are rendered concurrently; answers may come
+ * back in any order.
+ *
+ * Needs: npm install puppeteer @mermaid-js/mermaid-cli
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+import { createInterface } from 'node:readline';
+import { writeFile, rename } from 'node:fs/promises';
+import puppeteer from 'puppeteer';
+import { renderMermaid } from '@mermaid-js/mermaid-cli';
+
+let browserPromise = null;
+
+function browser() {
+    if (!browserPromise) {
+        browserPromise = puppeteer.launch({ headless: 'new' });
+    }
+    return browserPromise;
+}
+
+function reply(message) {
+    process.stdout.write(JSON.stringify(message) + '\n');
+}
+
+async function render(request) {
+    const format = request.format === 'png' ? 'png' : 'svg';
+    const { data } = await renderMermaid(await browser(), request.code, format, {
+        backgroundColor: 'white',
+        mermaidConfig: { theme: 'neutral' },
+    });
+
+    // Readers only ever see a complete file
+    const temp = `${request.output}.${process.pid}.tmp`;
+    await writeFile(temp, data);
+    await rename(temp, request.output);
+}
+
+const input = createInterface({ input: process.stdin });
+
+input.on('line', (line) => {
+    let request;
+    try {
+        request = JSON.parse(line);
+    } catch {
+        return;
+    }
+
+    render(request)
+        .then(() => reply({ id: request.id, ok: true }))
+        .catch((err) => reply({ id: request.id, ok: false, error: String(err.message || err) }));
+});
+
+// The app closed our stdin: finish up and leave
+input.on('close', async () => {
+    if (browserPromise) {
+        const b = await browserPromise.catch(() => null);
+        if (b) await b.close();
+    }
+    process.exit(0);
+});
@@ -0,0 +1,280 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * mermaidcache.cpp - Indexed, size-bounded cache of rendered diagrams
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#include "mermaidcache.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+
+const QString MermaidCache::MANIFEST_FILE = "index.json";
+
+MermaidCache::MermaidCache()
+    : m_budget(DEFAULT_MAX_BYTES)
+    , m_hits(0)
+    , m_misses(0)
+    , m_dirty(false)
+    , m_usageDirty(false)
+{
+}
+
+void MermaidCache::setDirectory(const QString &path)
+{
+    m_directory = path;
+    QDir(path).mkpath(".");
+
+    load();
+    trimToBudget();
+}
+
+QString MermaidCache::directory() const
+{
+    return m_directory;
+}
+
+QString MermaidCache::pathFor(const QString &key, const QString &variant) const
+{
+    QString path = m_directory + "/" + key;
+    if (!variant.isEmpty()) path += "." + variant;
+    return path;
+}
+
+bool MermaidCache::lookup(const QString &key, const QStringList &variants, QString *path)
+{
+    // Use times and counts ride along with the next save; see isDirty()
+    m_usageDirty = true;
+
+    auto it = m_files.constFind(key);
+    if (it != m_files.constEnd()) {
+        for (const QString &variant : variants) {
+            if (it->contains(variant)) {
+                *path = pathFor(key, variant);
+                m_budget.touch(key, QDateTime::currentMSecsSinceEpoch());
+                ++m_hits;
+                return true;
+            }
+        }
+    }
+
+    ++m_misses;
+    return false;
+}
+
+bool MermaidCache::contains(const QString &key, const QString &variant) const
+{
+    auto it = m_files.constFind(key);
+    return it != m_files.constEnd() && it->contains(variant);
+}
+
+void MermaidCache::insert(const QString &key, const QString &variant)
+{
+    QFileInfo info(pathFor(key, variant));
+    if (!info.exists()) return;
+
+    m_files[key].insert(variant, info.size());
+    account(key, QDateTime::currentMSecsSinceEpoch());
+    m_dirty = true;
+
+    // Never evict what was just rendered, however large
+    trimToBudget(key);
+}
+
+void MermaidCache::remove(const QString &key)
+{
+    auto it = m_files.find(key);
+    if (it == m_files.end()) return;
+
+    for (auto file = it->constBegin(); file != it->constEnd(); ++file) {
+        QFile::remove(pathFor(key, file.key()));
+    }
+    m_files.erase(it);
+    m_budget.remove(key);
+    m_dirty = true;
+}
+
+void MermaidCache::clear()
+{
+    // Also takes files the index never knew about
+    QDir dir(m_directory);
+    if (dir.exists()) {
+        dir.removeRecursively();
+        dir.mkpath(".");
+    }
+
+    m_files.clear();
+    m_budget.clear();
+    m_hits = 0;
+    m_misses = 0;
+    m_dirty = true;
+    save();
+}
+
+qint64 MermaidCache::bytes() const
+{
+    return m_budget.bytes();
+}
+
+qint64 MermaidCache::maxBytes() const
+{
+    return m_budget.maxBytes();
+}
+
+void MermaidCache::setMaxBytes(qint64 bytes)
+{
+    m_budget.setMaxBytes(bytes);
+    trimToBudget();
+}
+
+int MermaidCache::count() const
+{
+    return m_budget.count();
+}
+
+int MermaidCache::hits() const
+{
+    return m_hits;
+}
+
+int MermaidCache::misses() const
+{
+    return m_misses;
+}
+
+bool MermaidCache::isDirty() const
+{
+    return m_dirty || (m_usageDirty
+                       && (!m_sinceSave.isValid() || m_sinceSave.hasExpired(USAGE_SAVE_INTERVAL_MS)));
+}
+
+void MermaidCache::save()
+{
+    if ((!m_dirty && !m_usageDirty) || m_directory.isEmpty()) return;
+
+    QJsonObject entries;
+    for (auto it = m_files.constBegin(); it != m_files.constEnd(); ++it) {
+        QJsonObject files;
+        for (auto file = it->constBegin(); file != it->constEnd(); ++file) {
+            files[file.key()] = double(file.value());
+        }
+        QJsonObject entry;
+        entry["lastUsed"] = double(m_budget.lastUsed(it.key()));
+        entry["files"] = files;
+        entries[it.key()] = entry;
+    }
+
+    QJsonObject manifest;
+    manifest["version"] = 1;
+    manifest["hits"] = m_hits;
+    manifest["misses"] = m_misses;
+    manifest["entries"] = entries;
+
+    QSaveFile file(m_directory + "/" + MANIFEST_FILE);
+    if (!file.open(QIODevice::WriteOnly)) return;
+    file.write(QJsonDocument(manifest).toJson(QJsonDocument::Compact));
+    if (file.commit()) {
+        m_dirty = false;
+        m_usageDirty = false;
+        m_sinceSave.start();
+    }
+}
+
+void MermaidCache::load()
+{
+    m_files.clear();
+    m_budget.clear();
+    m_hits = 0;
+    m_misses = 0;
+    m_dirty = false;
+    m_usageDirty = false;
+    m_sinceSave.start();
+
+    QHash<QString, qint64> lastUsed;
+    QFile file(m_directory + "/" + MANIFEST_FILE);
+    if (file.open(QIODevice::ReadOnly)) {
+        QJsonObject manifest = QJsonDocument::fromJson(file.readAll()).object();
+        if (manifest["version"].toInt() == 1) {
+            m_hits = manifest["hits"].toInt();
+            m_misses = manifest["misses"].toInt();
+
+            QJsonObject entries = manifest["entries"].toObject();
+            for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+                QJsonObject object = it.value().toObject();
+                lastUsed.insert(it.key(), qint64(object["lastUsed"].toDouble()));
+                QHash<QString, qint64> &files = m_files[it.key()];
+                QJsonObject listed = object["files"].toObject();
+                for (auto f = listed.constBegin(); f != listed.constEnd(); ++f) {
+                    files.insert(f.key(), qint64(f.value().toDouble()));
+                }
+            }
+        }
+    }
+
+    // One listing to reconcile the manifest with what is really there
+    QHash<QString, QFileInfo> onDisk;
+    const QFileInfoList infos = QDir(m_directory).entryInfoList(QDir::Files);
+    for (const QFileInfo &info : infos) {
+        if (info.fileName() == MANIFEST_FILE) continue;
+        onDisk.insert(info.fileName(), info);
+    }
+
+    for (auto it = m_files.begin(); it != m_files.end(); ) {
+        for (auto f = it->begin(); f != it->end(); ) {
+            QString name = it.key() + (f.key().isEmpty() ? QString() : "." + f.key());
+            if (onDisk.contains(name)) {
+                f.value() = onDisk.take(name).size();
+                ++f;
+            } else {
+                f = it->erase(f);
+                m_dirty = true;
+            }
+        }
+        if (it->isEmpty()) {
+            it = m_files.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // Files the manifest does not know, e.g. from before it existed. Only
+    // "<sha256>.<format>" with an optional ".<name>.<extension>" variant:
+    // QSaveFile leftovers such as "index.json.AbC123" are not diagrams
+    static const QRegularExpression diagramName(
+        QStringLiteral("^([0-9a-f]{64}\\.[a-z]+)(?:\\.([a-z]+\\.[a-z]+))?$"));
+    for (auto it = onDisk.constBegin(); it != onDisk.constEnd(); ++it) {
+        QRegularExpressionMatch match = diagramName.match(it.key());
+        if (!match.hasMatch()) continue;
+
+        const QString key = match.captured(1);
+        m_files[key].insert(match.captured(2), it->size());
+        lastUsed[key] = qMax(lastUsed.value(key), it->lastModified().toMSecsSinceEpoch());
+        m_dirty = true;
+    }
+
+    for (auto it = m_files.constBegin(); it != m_files.constEnd(); ++it) {
+        account(it.key(), lastUsed.value(it.key()));
+    }
+}
+
+void MermaidCache::account(const QString &key, qint64 lastUsed)
+{
+    qint64 size = 0;
+    for (qint64 fileSize : m_files.value(key)) size += fileSize;
+    m_budget.set(key, size, lastUsed);
+}
+
+void MermaidCache::trimToBudget(const QString &keep)
+{
+    for (const QString &key : m_budget.overBudget(keep)) {
+        remove(key);
+    }
+}
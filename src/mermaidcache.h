@@ -0,0 +1,103 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * mermaidcache.h - Indexed, size-bounded cache of rendered diagrams
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#ifndef MERMAIDCACHE_H
+#define MERMAIDCACHE_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QElapsedTimer>
+#include "cachebudget.h"
+
+/**
+ * @brief The MermaidCache class keeps track of the rendered diagrams on disk.
+ *
+ * Each diagram has a key (the hash of its code plus the format, which is also
+ * the file name of the original render) and any number of variants stored
+ * next to it as "<key>.<variant>", such as the pre-dithered e-ink PNG. A
+ * variant is a name and an extension, like "eink.png".
+ *
+ * The index of files, sizes and use times lives in memory, so a lookup never
+ * touches the disk. It is persisted as one manifest file (index.json) by
+ * save() and checked against a single directory listing when loaded. Once the
+ * files exceed maxBytes(), whole diagrams are evicted, least recently used
+ * first. Hits and misses are counted for the statistics; they and the use
+ * times alone only get the manifest rewritten every USAGE_SAVE_INTERVAL_MS.
+ */
+class MermaidCache
+{
+public:
+    MermaidCache();
+
+    /**
+     * @brief setDirectory - Use (and create) path, loading its manifest
+     */
+    void setDirectory(const QString &path);
+    QString directory() const;
+
+    /**
+     * @brief pathFor - Where the variant of key is (or would be) stored;
+     *        an empty variant is the original render
+     */
+    QString pathFor(const QString &key, const QString &variant = QString()) const;
+
+    /**
+     * @brief lookup - Find the first of variants that is cached for key
+     *
+     * Counts one hit or miss and marks the diagram as used on a hit.
+     */
+    bool lookup(const QString &key, const QStringList &variants, QString *path);
+    bool contains(const QString &key, const QString &variant = QString()) const;
+
+    /**
+     * @brief insert - Index a file just written to pathFor(key, variant)
+     */
+    void insert(const QString &key, const QString &variant = QString());
+    void remove(const QString &key);
+    void clear();
+
+    // Size accounting
+    qint64 bytes() const;
+    qint64 maxBytes() const;
+    void setMaxBytes(qint64 bytes);
+    int count() const;
+
+    // Statistics
+    int hits() const;
+    int misses() const;
+
+    /**
+     * @brief save - Write the manifest if anything changed since the last save
+     */
+    void save();
+
+    // Files came or went, or the use times are due to be written
+    bool isDirty() const;
+
+private:
+    void load();
+    void account(const QString &key, qint64 lastUsed);
+    void trimToBudget(const QString &keep = QString());
+
+    QString m_directory;
+    QHash<QString, QHash<QString, qint64>> m_files; // Key -> (variant ("" = original) -> size)
+    CacheBudget<QString> m_budget;                  // Whole diagrams
+    int m_hits;
+    int m_misses;
+    bool m_dirty;
+    bool m_usageDirty;          // Only use times and counts changed
+    QElapsedTimer m_sinceSave;
+
+    static const qint64 DEFAULT_MAX_BYTES = 16 * 1024 * 1024;
+    static const int USAGE_SAVE_INTERVAL_MS = 10 * 60 * 1000;
+    static const QString MANIFEST_FILE;
+};
+
+#endif // MERMAIDCACHE_H
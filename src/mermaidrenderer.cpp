@@ -8,35 +8,77 @@
  */
 
 #include "mermaidrenderer.h"
-#include <QNetworkAccessManager>
+#include "metrics.h"
+#include "networksession.h"
+#include "diagramrasterizer.h"
+#include <QSvgRenderer>
+#include <QPainter>
 #include <QNetworkRequest>
 #include <QNetworkReply>
+#include <QCoreApplication>
 #include <QCryptographicHash>
 #include <QFile>
-#include <QDir>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTimer>
+#include <QImage>
 #include <QUrl>
 #include <QRegularExpression>
 #include <QDebug>
 
 const QString MermaidRenderer::MERMAID_INK_URL = "https://mermaid.ink";
+const QString MermaidRenderer::EINK_VARIANT = "eink.png";
+const QString MermaidRenderer::NATIVE_VARIANT = "native.png";
 
 MermaidRenderer::MermaidRenderer(QObject *parent)
     : QObject(parent)
     , m_rendering(false)
     , m_offlineMode(false)
-    , m_process(nullptr)
+    , m_network(nullptr)
+    , m_nextRenderId(1)
+    , m_worker(nullptr)
+    , m_workerUnavailable(false)
+    , m_indexSaveTimer(new QTimer(this))
 {
+    // Lookups touch the index all the time; write it out in batches
+    m_indexSaveTimer->setSingleShot(true);
+    m_indexSaveTimer->setInterval(INDEX_SAVE_DELAY_MS);
+    connect(m_indexSaveTimer, &QTimer::timeout, this, [this]() {
+        m_cache.save();
+    });
+}
+
+MermaidRenderer::~MermaidRenderer()
+{
+    if (m_worker) {
+        m_worker->disconnect(this);
+        m_worker->closeWriteChannel();
+        if (!m_worker->waitForFinished(1000)) {
+            m_worker->kill();
+            m_worker->waitForFinished(1000);
+        }
+    }
+    qDeleteAll(m_tasks);
+    m_cache.save();
+}
+
+void MermaidRenderer::setNetworkSession(NetworkSession *session)
+{
+    m_network = session;
+}
+
+void MermaidRenderer::prewarm()
+{
+    if (m_network && !m_offlineMode) {
+        m_network->prewarm(QUrl(MERMAID_INK_URL));
+    }
 }
 
 void MermaidRenderer::setCacheDirectory(const QString &path)
 {
     m_cacheDirectory = path;
-    
-    // Ensure cache directory exists
-    QDir dir(path + "/mermaid-cache");
-    if (!dir.exists()) {
-        dir.mkpath(".");
-    }
+    m_cache.setDirectory(path + "/mermaid-cache");
 }
 
 QString MermaidRenderer::cacheDirectory() const
@@ -62,7 +104,16 @@ void MermaidRenderer::setOfflineMode(bool offline)
     }
 }
 
-QString MermaidRenderer::cachePathFor(const QString &mermaidCode, const QString &format) const
+void MermaidRenderer::updateRendering()
+{
+    bool rendering = !m_tasks.isEmpty();
+    if (m_rendering != rendering) {
+        m_rendering = rendering;
+        emit renderingChanged();
+    }
+}
+
+QString MermaidRenderer::cacheKeyFor(const QString &mermaidCode, const QString &format) const
 {
     // Generate hash of Mermaid code for cache key
     QByteArray hash = QCryptographicHash::hash(
@@ -70,176 +121,390 @@ QString MermaidRenderer::cachePathFor(const QString &mermaidCode, const QString
         QCryptographicHash::Sha256
     ).toHex();
     
-    return m_cacheDirectory + "/mermaid-cache/" + hash + "." + format;
+    return hash + "." + format;
 }
 
-bool MermaidRenderer::isCached(const QString &mermaidCode, const QString &format) const
+QVariantMap MermaidRenderer::cacheStats() const
 {
-    return QFile::exists(cachePathFor(mermaidCode, format));
+    QVariantMap stats;
+    stats["hits"] = m_cache.hits();
+    stats["misses"] = m_cache.misses();
+    stats["diagrams"] = m_cache.count();
+    stats["bytes"] = m_cache.bytes();
+    stats["maxBytes"] = m_cache.maxBytes();
+    return stats;
 }
 
-void MermaidRenderer::render(const QString &mermaidCode, const QString &outputFormat)
+void MermaidRenderer::setCacheLimit(qint64 bytes)
 {
-    if (m_rendering) {
-        emit renderError("Already rendering");
-        return;
+    m_cache.setMaxBytes(bytes);
+    indexChanged();
+}
+
+void MermaidRenderer::indexChanged()
+{
+    if (m_cache.isDirty() && !m_indexSaveTimer->isActive()) {
+        m_indexSaveTimer->start();
+    }
+}
+
+QString MermaidRenderer::storeRender(const QString &key, const QString &format)
+{
+    m_cache.insert(key);
+    
+    // Rasterise and dither once now, instead of on every view
+    QImage image;
+    if (format == "svg") {
+        QSvgRenderer svg(m_cache.pathFor(key));
+        if (svg.isValid()) {
+            QSizeF size = svg.defaultSize();
+            qreal scale = qMin<qreal>(MAX_EINK_SCALE, EINK_MAX_SIDE / qMax(size.width(), size.height()));
+            image = QImage((size * scale).toSize(), QImage::Format_ARGB32_Premultiplied);
+            image.fill(Qt::white);
+            QPainter painter(&image);
+            svg.render(&painter);
+        }
+    } else {
+        image.load(m_cache.pathFor(key));
+    }
+    
+    if (!image.isNull()) {
+        QImage eink = DiagramRasterizer::dither(image);
+        if (eink.save(m_cache.pathFor(key, EINK_VARIANT), "PNG")) {
+            m_cache.insert(key, EINK_VARIANT);
+            indexChanged();
+            return m_cache.pathFor(key, EINK_VARIANT);
+        }
     }
     
+    indexChanged();
+    return m_cache.pathFor(key);
+}
+
+int MermaidRenderer::render(const QString &mermaidCode, const QString &outputFormat)
+{
     if (mermaidCode.trimmed().isEmpty()) {
-        emit renderError("Empty Mermaid code");
-        return;
+        emit renderError(-1, "Empty Mermaid code");
+        return -1;
     }
     
-    m_currentCode = mermaidCode;
-    m_currentFormat = outputFormat;
+    const int renderId = m_nextRenderId++;
+    m_waiting.insert(renderId);
+    
+    // Check cache first; the in-process fallback render does not count
+    const QString key = cacheKeyFor(mermaidCode, outputFormat);
+    QString cachedPath;
+    bool cached = m_cache.lookup(key, {EINK_VARIANT, QString()}, &cachedPath);
+    indexChanged();
+    static Metrics::Counter &cacheHits = Metrics::instance().counter("mermaid.cache_hits");
+    static Metrics::Counter &cacheMisses = Metrics::instance().counter("mermaid.cache_misses");
+    (cached ? cacheHits : cacheMisses).add();
+    if (cached) {
+        deliverLater(renderId, cachedPath, QString());
+        return renderId;
+    }
     
-    // Check cache first
-    if (isCached(mermaidCode, outputFormat)) {
-        QString cachePath = cachePathFor(mermaidCode, outputFormat);
-        emit renderComplete(cachePath);
-        return;
+    // Join a render of the same diagram that is already under way
+    if (Task *task = m_tasks.value(key)) {
+        task->renderIds.append(renderId);
+        return renderId;
     }
     
-    // If offline, return text representation
-    if (m_offlineMode) {
-        emit renderError("Offline mode - diagram rendering unavailable");
-        return;
+    Task *task = new Task;
+    task->key = key;
+    task->code = mermaidCode;
+    task->format = outputFormat;
+    task->renderIds.append(renderId);
+    task->running = false;
+    task->reply = nullptr;
+    task->local = false;
+    task->startedUs = 0;
+    m_tasks.insert(key, task);
+    m_pending.append(key);
+    
+    updateRendering();
+    startTasks();
+    return renderId;
+}
+
+void MermaidRenderer::deliverLater(int renderId, const QString &imagePath, const QString &error)
+{
+    // After render() has returned, so the caller knows the id
+    QTimer::singleShot(0, this, [this, renderId, imagePath, error]() {
+        if (!m_waiting.remove(renderId)) return; // Cancelled meanwhile
+        if (error.isEmpty()) {
+            emit renderComplete(renderId, imagePath);
+        } else {
+            emit renderError(renderId, error);
+        }
+    });
+}
+
+int MermaidRenderer::runningCount() const
+{
+    int running = 0;
+    for (const Task *task : m_tasks) {
+        if (task->running) ++running;
+    }
+    return running;
+}
+
+void MermaidRenderer::startTasks()
+{
+    while (!m_pending.isEmpty() && runningCount() < MAX_PARALLEL_RENDERS) {
+        Task *task = m_tasks.value(m_pending.takeFirst());
+        task->running = true;
+        task->startedUs = Metrics::nowUs();
+        
+        if (ensureWorker()) {
+            renderViaLocal(task);
+        } else if (m_offlineMode || !m_network) {
+            // Not from inside render(): its caller does not have the id yet
+            const QString key = task->key;
+            QTimer::singleShot(0, this, [this, key]() {
+                renderNative(m_tasks.value(key), "Offline mode - diagram rendering unavailable");
+            });
+        } else {
+            renderViaServer(task);
+        }
     }
+}
+
+void MermaidRenderer::finishTask(const QString &key, const QString &error,
+                                 const QString &imagePath)
+{
+    Task *task = m_tasks.take(key);
+    if (!task) return;
     
-    m_rendering = true;
-    emit renderingChanged();
+    QString path = imagePath;
+    if (error.isEmpty() && path.isEmpty()) {
+        path = storeRender(key, task->format);
+    }
+    if (error.isEmpty() && task->startedUs > 0) {
+        static Metrics::Histogram &renderTime = Metrics::instance().histogram("mermaid.render_ms");
+        renderTime.record((Metrics::nowUs() - task->startedUs) / 1000);
+    }
+    for (int renderId : task->renderIds) {
+        if (!m_waiting.remove(renderId)) continue;
+        if (error.isEmpty()) {
+            emit renderComplete(renderId, path);
+        } else {
+            emit renderError(renderId, error);
+        }
+    }
+    delete task;
     
-    // Use server-side rendering
-    renderViaServer(mermaidCode, outputFormat);
+    updateRendering();
+    startTasks();
 }
 
-void MermaidRenderer::renderViaServer(const QString &mermaidCode, const QString &outputFormat)
+void MermaidRenderer::dropTask(const QString &key)
+{
+    Task *task = m_tasks.value(key);
+    if (!task) return;
+    
+    if (task->local && task->running) {
+        // The worker cannot be interrupted; let it finish into the cache
+        return;
+    }
+    
+    m_tasks.remove(key);
+    m_pending.removeAll(key);
+    if (task->reply) {
+        task->reply->disconnect(this);
+        task->reply->abort();
+        task->reply->deleteLater();
+    }
+    delete task;
+}
+
+void MermaidRenderer::renderViaServer(Task *task)
 {
     // mermaid.ink accepts base64-encoded diagram definition
-    QByteArray encoded = mermaidCode.toUtf8().toBase64(QByteArray::Base64UrlEncoding);
+    QByteArray encoded = task->code.toUtf8().toBase64(QByteArray::Base64UrlEncoding);
     
-    QString endpoint = (outputFormat == "png") ? "/img/" : "/svg/";
+    QString endpoint = (task->format == "png") ? "/img/" : "/svg/";
     QUrl url(MERMAID_INK_URL + endpoint + encoded);
     
-    QNetworkAccessManager *manager = new QNetworkAccessManager(this);
-    QNetworkRequest request(url);
+    QNetworkRequest request = m_network->request(url);
     
     // Add headers for e-ink optimized output
-    request.setRawHeader("Accept", (outputFormat == "png") ? 
+    request.setRawHeader("Accept", (task->format == "png") ? 
         "image/png" : "image/svg+xml");
     
-    QNetworkReply *reply = manager->get(request);
+    QNetworkReply *reply = m_network->get(request);
+    task->reply = reply;
     
-    connect(reply, &QNetworkReply::finished, this, [this, reply, manager]() {
+    const QString key = task->key;
+    connect(reply, &QNetworkReply::finished, this, [this, reply, key]() {
+        reply->deleteLater();
+        if (Task *task = m_tasks.value(key)) {
+            task->reply = nullptr;
+        }
+        
         if (reply->error() != QNetworkReply::NoError) {
-            m_rendering = false;
-            emit renderingChanged();
-            emit renderError(reply->errorString());
-            reply->deleteLater();
-            manager->deleteLater();
+            renderNative(m_tasks.value(key), reply->errorString());
             return;
         }
         
-        QByteArray data = reply->readAll();
-        reply->deleteLater();
-        manager->deleteLater();
-        
-        // Save to cache
-        QString cachePath = cachePathFor(m_currentCode, m_currentFormat);
-        QFile file(cachePath);
+        // Save to cache; a reader never sees a half-written file
+        QSaveFile file(m_cache.pathFor(key));
         if (file.open(QIODevice::WriteOnly)) {
-            file.write(data);
-            file.close();
-            
-            m_rendering = false;
-            emit renderingChanged();
-            emit renderComplete(cachePath);
+            file.write(reply->readAll());
+        }
+        if (file.commit()) {
+            finishTask(key, QString());
         } else {
-            m_rendering = false;
-            emit renderingChanged();
-            emit renderError("Failed to save rendered diagram");
+            finishTask(key, "Failed to save rendered diagram");
         }
     });
 }
 
-void MermaidRenderer::renderViaLocal(const QString &mermaidCode, const QString &outputFormat)
+void MermaidRenderer::renderNative(Task *task, const QString &error)
 {
-    // Try to use local mmdc (Mermaid CLI) if available
-    // This requires Node.js and @mermaid-js/mermaid-cli
-    // On reMarkable, this is typically not available, so we fall back to server
-    
-    m_process = new QProcess(this);
-    connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &MermaidRenderer::onProcessFinished);
+    if (!task) return;
     
-    // Write Mermaid code to temp file
-    QString tempInput = m_cacheDirectory + "/temp.mmd";
-    QString outputPath = cachePathFor(mermaidCode, outputFormat);
+    // Kept as a variant that lookups skip, so the server's rendering
+    // replaces it once back online
+    QString path = m_cache.pathFor(task->key, NATIVE_VARIANT);
+    QImage image = DiagramRasterizer::render(task->code);
     
-    QFile file(tempInput);
-    if (!file.open(QIODevice::WriteOnly)) {
-        m_rendering = false;
-        emit renderingChanged();
-        emit renderError("Could not create temp file");
-        return;
+    if (!image.isNull() && image.save(path, "PNG")) {
+        m_cache.insert(task->key, NATIVE_VARIANT);
+        indexChanged();
+        finishTask(task->key, QString(), path);
+    } else {
+        finishTask(task->key, error);
+    }
+}
+
+bool MermaidRenderer::ensureWorker()
+{
+    if (m_worker) return true;
+    if (m_workerUnavailable) return false;
+    
+    // Needs Node.js with puppeteer and @mermaid-js/mermaid-cli, which the
+    // reMarkable usually lacks; the server is used then
+    QString script = qEnvironmentVariable("GHOSTWRITER_MERMAID_WORKER",
+        QCoreApplication::applicationDirPath() + "/mermaid-worker.mjs");
+    if (!QFile::exists(script)) {
+        m_workerUnavailable = true;
+        return false;
     }
-    file.write(mermaidCode.toUtf8());
-    file.close();
     
-    // Run mmdc
-    QStringList args;
-    args << "-i" << tempInput;
-    args << "-o" << outputPath;
-    args << "-b" << "white";  // White background for e-ink
+    m_worker = new QProcess(this);
+    m_worker->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    connect(m_worker, &QProcess::readyReadStandardOutput,
+            this, &MermaidRenderer::onWorkerOutput);
+    connect(m_worker, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart || error == QProcess::Crashed) {
+            onWorkerGone();
+        }
+    });
+    connect(m_worker, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &MermaidRenderer::onWorkerGone);
     
-    m_process->start("mmdc", args);
+    // Writes are buffered until the process is up
+    m_worker->start("node", {script});
+    return true;
+}
+
+void MermaidRenderer::renderViaLocal(Task *task)
+{
+    task->local = true;
+    
+    QJsonObject message;
+    message["id"] = task->key;
+    message["code"] = task->code;
+    message["format"] = task->format;
+    message["output"] = m_cache.pathFor(task->key);
+    m_worker->write(QJsonDocument(message).toJson(QJsonDocument::Compact) + '\n');
+}
+
+void MermaidRenderer::onWorkerOutput()
+{
+    m_workerBuffer += m_worker->readAllStandardOutput();
     
-    if (!m_process->waitForStarted(1000)) {
-        // mmdc not available, fall back to server
-        m_process->deleteLater();
-        m_process = nullptr;
-        renderViaServer(mermaidCode, outputFormat);
+    int newline;
+    while ((newline = m_workerBuffer.indexOf('\n')) >= 0) {
+        QByteArray line = m_workerBuffer.left(newline);
+        m_workerBuffer.remove(0, newline + 1);
+        
+        QJsonObject reply = QJsonDocument::fromJson(line).object();
+        QString key = reply["id"].toString();
+        if (key.isEmpty()) continue;
+        
+        if (reply["ok"].toBool()) {
+            finishTask(key, QString());
+        } else {
+            renderNative(m_tasks.value(key), reply["error"].toString("Local rendering failed"));
+        }
     }
 }
 
-void MermaidRenderer::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
+void MermaidRenderer::onWorkerGone()
 {
-    Q_UNUSED(exitStatus);
-    
-    if (m_process) {
-        m_process->deleteLater();
-        m_process = nullptr;
+    if (!m_worker) return;
+    
+    qWarning() << "MermaidRenderer: render worker stopped, using the server from now on";
+    m_worker->disconnect(this);
+    m_worker->deleteLater();
+    m_worker = nullptr;
+    m_workerBuffer.clear();
+    m_workerUnavailable = true;
+    
+    // Whatever the worker had is retried on the server, in the same order
+    QList<QString> retry;
+    for (Task *task : m_tasks) {
+        if (task->local) {
+            task->local = false;
+            task->running = false;
+            retry.append(task->key);
+        }
     }
-    
-    m_rendering = false;
-    emit renderingChanged();
-    
-    if (exitCode == 0) {
-        QString outputPath = cachePathFor(m_currentCode, m_currentFormat);
-        emit renderComplete(outputPath);
-    } else {
-        emit renderError("Local rendering failed");
+    for (int i = retry.size() - 1; i >= 0; --i) {
+        if (m_tasks.value(retry.at(i))->renderIds.isEmpty()) {
+            dropTask(retry.at(i)); // Cancelled while the worker had it
+        } else {
+            m_pending.prepend(retry.at(i));
+        }
     }
+    
+    updateRendering();
+    startTasks();
 }
 
-void MermaidRenderer::cancel()
+void MermaidRenderer::cancel(int renderId)
 {
-    if (m_process) {
-        m_process->kill();
-        m_process->deleteLater();
-        m_process = nullptr;
+    if (renderId < 0) {
+        m_waiting.clear();
+    } else {
+        m_waiting.remove(renderId);
+    }
+    
+    // Abandon every diagram nobody is waiting for any more
+    QList<QString> abandoned;
+    for (Task *task : m_tasks) {
+        if (renderId < 0) {
+            task->renderIds.clear();
+        } else {
+            task->renderIds.removeAll(renderId);
+        }
+        if (task->renderIds.isEmpty()) {
+            abandoned.append(task->key);
+        }
     }
-    m_rendering = false;
-    emit renderingChanged();
+    for (const QString &key : abandoned) {
+        dropTask(key);
+    }
+    
+    updateRendering();
+    startTasks();
 }
 
 void MermaidRenderer::clearCache()
 {
-    QDir cacheDir(m_cacheDirectory + "/mermaid-cache");
-    if (cacheDir.exists()) {
-        cacheDir.removeRecursively();
-        cacheDir.mkpath(".");
-    }
+    m_cache.clear();
 }
 
 QString MermaidRenderer::renderToText(const QString &mermaidCode) const
@@ -12,7 +12,17 @@
 
 #include <QObject>
 #include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QSet>
 #include <QProcess>
+#include <QVariantMap>
+#include "mermaidcache.h"
+
+class NetworkSession;
+class QTimer;
+class QNetworkReply;
 
 /**
  * @brief The MermaidRenderer class handles Mermaid diagram rendering.
@@ -22,8 +32,23 @@
  * or falls back to server-side rendering for complex diagrams.
  *
  * On the reMarkable, we primarily use server-side rendering via mermaid.ink
- * to avoid heavy dependencies. For offline use, diagrams are rendered as
- * formatted text fallback.
+ * to avoid heavy dependencies. Offline, or when the server fails,
+ * flowcharts, sequence diagrams and mind maps are drawn in-process by
+ * DiagramRasterizer; anything else falls back to formatted text.
+ *
+ * Finished renders are indexed by MermaidCache under a byte budget. Each one
+ * also gets a dithered 16-gray PNG variant, which is what is shown, so the
+ * display does not rasterise the SVG on every view.
+ *
+ * Where Node.js and mermaid-worker.mjs are available, diagrams are rendered
+ * locally by one long-lived worker process (a single headless browser), so
+ * there is no per-diagram Chromium start-up. Otherwise they go to the server.
+ *
+ * Every render() gets a render id that tags its signals. Renders are queued
+ * per diagram: asking for a diagram that is already queued or rendering
+ * joins that render instead of starting another, and up to
+ * MAX_PARALLEL_RENDERS diagrams render at once. cancel() withdraws one
+ * render id; the diagram itself is only abandoned once nobody waits for it.
  */
 class MermaidRenderer : public QObject
 {
@@ -33,10 +58,12 @@ class MermaidRenderer : public QObject
 
 public:
     explicit MermaidRenderer(QObject *parent = nullptr);
+    ~MermaidRenderer();
 
     // Configuration
     void setCacheDirectory(const QString &path);
     QString cacheDirectory() const;
+    void setNetworkSession(NetworkSession *session);
 
     // State
     bool isRendering() const;
@@ -45,11 +72,14 @@ public:
 
 public slots:
     /**
-     * @brief render - Render Mermaid code to an image
+     * @brief render - Queue Mermaid code for rendering to an image
      * @param mermaidCode - The Mermaid diagram code
      * @param outputFormat - "svg" or "png" (default: svg for e-ink)
+     * @return The render id, or -1 if the code was rejected (renderError has
+     *         then been emitted with id -1). Results, including cache hits,
+     *         arrive after render() has returned.
      */
-    void render(const QString &mermaidCode, const QString &outputFormat = "svg");
+    int render(const QString &mermaidCode, const QString &outputFormat = "svg");
     
     /**
      * @brief renderToText - Convert Mermaid to ASCII/text representation
@@ -60,36 +90,81 @@ public slots:
     QString renderToText(const QString &mermaidCode) const;
     
     /**
-     * @brief cancel - Cancel any in-progress rendering
+     * @brief prewarm - Connect to the render server ahead of a render
      */
-    void cancel();
+    void prewarm();
+    
+    /**
+     * @brief cancel - Withdraw a render, or all of them if renderId is -1
+     *
+     * Cancelled renders end silently.
+     */
+    void cancel(int renderId = -1);
     
     /**
      * @brief clearCache - Clear the diagram cache
      */
     void clearCache();
+    
+    /**
+     * @brief setCacheLimit - Byte budget for the diagram cache; the least
+     *        recently viewed diagrams are evicted beyond it
+     */
+    void setCacheLimit(qint64 bytes);
+    
+    /**
+     * @brief cacheStats - Hits, misses, diagrams, bytes and maxBytes
+     */
+    QVariantMap cacheStats() const;
 
 signals:
-    void renderComplete(const QString &imagePath);
-    void renderError(const QString &error);
+    void renderComplete(int renderId, const QString &imagePath);
+    void renderError(int renderId, const QString &error);
     void renderingChanged();
     void offlineModeChanged();
 
-private slots:
-    void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
-
 private:
+    /**
+     * One diagram being rendered, shared by every render id asking for it.
+     */
+    struct Task {
+        QString key;              // Cache file name; identifies the diagram
+        QString code;
+        QString format;
+        QList<int> renderIds;     // Waiting for this diagram
+        bool running;
+        QNetworkReply *reply;     // Set while rendering via the server
+        bool local;               // Sent to the worker process
+        qint64 startedUs;         // When it started running, for the metrics
+    };
+
+    // Scheduling
+    void startTasks();
+    int runningCount() const;
+    void finishTask(const QString &key, const QString &error,
+                    const QString &imagePath = QString());
+    void dropTask(const QString &key);
+    void deliverLater(int renderId, const QString &imagePath, const QString &error);
+    void updateRendering();
+
     // Server-side rendering via mermaid.ink
-    void renderViaServer(const QString &mermaidCode, const QString &outputFormat);
+    void renderViaServer(Task *task);
     
-    // Local rendering via mmdc (if available)
-    void renderViaLocal(const QString &mermaidCode, const QString &outputFormat);
+    // In-process rendering (DiagramRasterizer) when offline or the server fails
+    void renderNative(Task *task, const QString &error);
     
-    // Generate cache path for a diagram
-    QString cachePathFor(const QString &mermaidCode, const QString &format) const;
+    // Local rendering through the persistent worker (if available)
+    bool ensureWorker();
+    void renderViaLocal(Task *task);
+    void onWorkerOutput();
+    void onWorkerGone();
     
-    // Check if diagram is cached
-    bool isCached(const QString &mermaidCode, const QString &format) const;
+    // Cache key (file name) for a diagram
+    QString cacheKeyFor(const QString &mermaidCode, const QString &format) const;
+    
+    // Index a finished render and add its e-ink variant; returns the path to show
+    QString storeRender(const QString &key, const QString &format);
+    void indexChanged();
     
     // Parse Mermaid for text fallback
     QString parseFlowchartToText(const QString &code) const;
@@ -99,9 +174,31 @@ private:
     QString m_cacheDirectory;
     bool m_rendering;
     bool m_offlineMode;
-    QProcess *m_process;
-    QString m_currentCode;
-    QString m_currentFormat;
+    NetworkSession *m_network;
+    
+    // Render bookkeeping
+    QHash<QString, Task *> m_tasks;   // By key, queued and running
+    QList<QString> m_pending;         // Keys waiting to start, oldest first
+    QSet<int> m_waiting;              // Render ids not yet answered or cancelled
+    int m_nextRenderId;
+    
+    // Worker process; null until first needed
+    QProcess *m_worker;
+    QByteArray m_workerBuffer;        // Unterminated stdout line
+    bool m_workerUnavailable;
+    
+    // Rendered diagrams on disk
+    MermaidCache m_cache;
+    QTimer *m_indexSaveTimer;
+    
+    static const int MAX_PARALLEL_RENDERS = 3;
+    static const int INDEX_SAVE_DELAY_MS = 5000;
+    
+    // E-ink variants: rasterised at up to twice the SVG size, at most this large
+    static const int EINK_MAX_SIDE = 1600;
+    static const int MAX_EINK_SCALE = 2;
+    static const QString EINK_VARIANT;
+    static const QString NATIVE_VARIANT;
     
     // Server URL for rendering
     static const QString MERMAID_INK_URL;
@@ -0,0 +1,202 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * metrics.cpp - Lock-free performance counters and latency histograms
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#include "metrics.h"
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QTimer>
+#include <QtMath>
+#include <QDebug>
+#include <chrono>
+
+void Metrics::Histogram::record(qint64 value)
+{
+    value = qMax<qint64>(0, value);
+
+    // Bucket 0 holds 0; bucket b holds [2^(b-1), 2^b)
+    int bucket = value == 0 ? 0 : 64 - qCountLeadingZeroBits(quint64(value));
+    bucket = qMin(bucket, BUCKETS - 1);
+
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+
+    qint64 max = m_max.load(std::memory_order_relaxed);
+    while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+}
+
+qint64 Metrics::Histogram::percentile(double fraction) const
+{
+    qint64 total = count();
+    if (total == 0) return 0;
+
+    qint64 target = qMax<qint64>(1, qCeil(fraction * total));
+    qint64 seen = 0;
+    for (int bucket = 0; bucket < BUCKETS; ++bucket) {
+        qint64 inBucket = m_buckets[bucket].load(std::memory_order_relaxed);
+        if (seen + inBucket < target) {
+            seen += inBucket;
+            continue;
+        }
+        if (bucket == 0) return 0;
+
+        // Spread the bucket's samples evenly over its range
+        qint64 low = qint64(1) << (bucket - 1);
+        qint64 high = (qint64(1) << bucket) - 1;
+        qint64 value = low + (high - low) * (target - seen) / qMax<qint64>(1, inBucket);
+        return qMin(value, m_max.load(std::memory_order_relaxed));
+    }
+    return m_max.load(std::memory_order_relaxed);
+}
+
+QJsonObject Metrics::Histogram::toJson() const
+{
+    qint64 total = count();
+    return {
+        {"count", total},
+        {"mean", total > 0 ? double(m_sum.load(std::memory_order_relaxed)) / total : 0.0},
+        {"p50", percentile(0.50)},
+        {"p90", percentile(0.90)},
+        {"p99", percentile(0.99)},
+        {"max", m_max.load(std::memory_order_relaxed)}
+    };
+}
+
+Metrics &Metrics::instance()
+{
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::Metrics()
+    : m_keystrokeLatency(nullptr)
+{
+    m_keystrokeLatency = &histogram("editor.keystroke_latency_us");
+}
+
+Metrics::~Metrics()
+{
+    qDeleteAll(m_counters);
+    qDeleteAll(m_gauges);
+    qDeleteAll(m_histograms);
+}
+
+Metrics::Counter &Metrics::counter(const QString &name)
+{
+    QMutexLocker locker(&m_mutex);
+    Counter *&counter = m_counters[name];
+    if (!counter) counter = new Counter;
+    return *counter;
+}
+
+Metrics::Gauge &Metrics::gauge(const QString &name)
+{
+    QMutexLocker locker(&m_mutex);
+    Gauge *&gauge = m_gauges[name];
+    if (!gauge) gauge = new Gauge;
+    return *gauge;
+}
+
+Metrics::Histogram &Metrics::histogram(const QString &name)
+{
+    QMutexLocker locker(&m_mutex);
+    Histogram *&histogram = m_histograms[name];
+    if (!histogram) histogram = new Histogram;
+    return *histogram;
+}
+
+qint64 Metrics::nowUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void Metrics::markInput()
+{
+    // Keep the earliest unhandled read
+    qint64 expected = 0;
+    m_inputMark.compare_exchange_strong(expected, nowUs(), std::memory_order_relaxed);
+}
+
+void Metrics::inputApplied()
+{
+    qint64 mark = m_inputMark.exchange(0, std::memory_order_relaxed);
+    if (mark > 0) {
+        m_keystrokeLatency->record(nowUs() - mark);
+    }
+}
+
+void Metrics::dropInput()
+{
+    m_inputMark.store(0, std::memory_order_relaxed);
+}
+
+QJsonObject Metrics::snapshot() const
+{
+    QMutexLocker locker(&m_mutex);
+
+    QJsonObject counters;
+    for (auto it = m_counters.constBegin(); it != m_counters.constEnd(); ++it) {
+        counters[it.key()] = it.value()->value();
+    }
+    QJsonObject gauges;
+    for (auto it = m_gauges.constBegin(); it != m_gauges.constEnd(); ++it) {
+        gauges[it.key()] = it.value()->value();
+    }
+    QJsonObject histograms;
+    for (auto it = m_histograms.constBegin(); it != m_histograms.constEnd(); ++it) {
+        histograms[it.key()] = it.value()->toJson();
+    }
+
+    return {
+        {"counters", counters},
+        {"gauges", gauges},
+        {"histograms", histograms}
+    };
+}
+
+MetricsReporter::MetricsReporter(QObject *parent)
+    : QObject(parent)
+    , m_dumpTimer(new QTimer(this))
+{
+    connect(m_dumpTimer, &QTimer::timeout, this, &MetricsReporter::dump);
+}
+
+MetricsReporter::~MetricsReporter()
+{
+    dump();
+}
+
+void MetricsReporter::setDumpFile(const QString &path, int intervalMs)
+{
+    m_dumpFile = path;
+    if (path.isEmpty()) {
+        m_dumpTimer->stop();
+    } else {
+        m_dumpTimer->start(intervalMs > 0 ? intervalMs : DEFAULT_DUMP_INTERVAL_MS);
+    }
+}
+
+QVariantMap MetricsReporter::snapshot() const
+{
+    return Metrics::instance().snapshot().toVariantMap();
+}
+
+bool MetricsReporter::dump()
+{
+    if (m_dumpFile.isEmpty()) return false;
+
+    QSaveFile file(m_dumpFile);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not write metrics to" << m_dumpFile;
+        return false;
+    }
+    file.write(QJsonDocument(Metrics::instance().snapshot()).toJson(QJsonDocument::Indented));
+    return file.commit();
+}
@@ -0,0 +1,73 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * networksession.cpp - Shared HTTP connection layer implementation
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#include "networksession.h"
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QDateTime>
+#ifndef QT_NO_SSL
+#include <QSslConfiguration>
+#endif
+
+NetworkSession::NetworkSession(QObject *parent)
+    : QObject(parent)
+    , m_manager(new QNetworkAccessManager(this))
+{
+}
+
+QNetworkRequest NetworkSession::request(const QUrl &url) const
+{
+    QNetworkRequest request(url);
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+    return request;
+}
+
+QNetworkReply *NetworkSession::get(const QNetworkRequest &request)
+{
+    markUsed(request.url());
+    return m_manager->get(request);
+}
+
+QNetworkReply *NetworkSession::post(const QNetworkRequest &request, const QByteArray &data)
+{
+    markUsed(request.url());
+    return m_manager->post(request, data);
+}
+
+void NetworkSession::prewarm(const QUrl &url)
+{
+    if (!url.isValid() || url.host().isEmpty()) return;
+
+    const QString key = hostKey(url);
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (now - m_lastUsed.value(key, 0) < PREWARM_INTERVAL_MS) return;
+    m_lastUsed.insert(key, now);
+
+    if (url.scheme() == "https") {
+#ifndef QT_NO_SSL
+        // Offer h2 during the handshake so requests can reuse this connection
+        QSslConfiguration ssl = QSslConfiguration::defaultConfiguration();
+        ssl.setAllowedNextProtocols({QSslConfiguration::ALPNProtocolHTTP2,
+                                     QSslConfiguration::NextProtocolHttp1_1});
+        m_manager->connectToHostEncrypted(url.host(), url.port(443), ssl);
+#endif
+    } else {
+        m_manager->connectToHost(url.host(), url.port(80));
+    }
+}
+
+void NetworkSession::markUsed(const QUrl &url)
+{
+    m_lastUsed.insert(hostKey(url), QDateTime::currentMSecsSinceEpoch());
+}
+
+QString NetworkSession::hostKey(const QUrl &url)
+{
+    return url.scheme() + "://" + url.host() + ":" + QString::number(url.port());
+}
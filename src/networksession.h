@@ -0,0 +1,69 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * networksession.h - Shared HTTP connection layer
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#ifndef NETWORKSESSION_H
+#define NETWORKSESSION_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include <QUrl>
+#include <QByteArray>
+#include <QNetworkRequest>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
+/**
+ * @brief The NetworkSession class is the one network manager the app talks through.
+ *
+ * The AI client and the Mermaid renderer share a single long-lived
+ * QNetworkAccessManager, so connections to a host stay open between
+ * requests instead of paying DNS, TCP and TLS setup every time. Requests
+ * built with request() allow HTTP/2, which multiplexes concurrent requests
+ * to one provider over a single connection.
+ *
+ * prewarm() opens the connection ahead of time (for example when the prompt
+ * palette opens), so the handshake is done by the time the user has picked
+ * a prompt.
+ */
+class NetworkSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit NetworkSession(QObject *parent = nullptr);
+
+    /**
+     * @brief request - A request for url with the session's defaults applied
+     */
+    QNetworkRequest request(const QUrl &url) const;
+
+    QNetworkReply *get(const QNetworkRequest &request);
+    QNetworkReply *post(const QNetworkRequest &request, const QByteArray &data);
+
+    /**
+     * @brief prewarm - Open a connection to the host of url in the background
+     *
+     * Does nothing if the host was prewarmed or used within the last
+     * PREWARM_INTERVAL_MS, when the connection is most likely still open.
+     */
+    void prewarm(const QUrl &url);
+
+private:
+    void markUsed(const QUrl &url);
+    static QString hostKey(const QUrl &url);
+
+    QNetworkAccessManager *m_manager;
+    QHash<QString, qint64> m_lastUsed; // hostKey -> msecs since epoch
+
+    static const qint64 PREWARM_INTERVAL_MS = 30 * 1000;
+};
+
+#endif // NETWORKSESSION_H
@@ -0,0 +1,446 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * piecetable.cpp - Piece table storage implementation
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#include "piecetable.h"
+
+#include <algorithm>
+
+PieceTable::PieceTable()
+    : m_root(nullptr)
+    , m_seed(0x9e3779b9u)
+    , m_cacheValid(true)
+{
+}
+
+PieceTable::~PieceTable()
+{
+    destroy(m_root);
+}
+
+void PieceTable::setText(const QString &text)
+{
+    clear();
+    m_original = text;
+    appendLineBreaks(m_original, 0, m_originalBreaks);
+    if (!m_original.isEmpty()) {
+        m_root = createNode(Original, 0, m_original.length());
+    }
+    m_cache = m_original;
+    m_cacheValid = true;
+}
+
+void PieceTable::appendOriginal(const QString &text)
+{
+    if (text.isEmpty()) return;
+
+    int start = m_original.length();
+    m_original.append(text);
+    appendLineBreaks(text, start, m_originalBreaks);
+
+    Node *last = rightmost(m_root);
+    if (last && last->buffer == Original && last->start + last->length == start) {
+        extendRightmost(m_root, text.length());
+    } else {
+        m_root = merge(m_root, createNode(Original, start, text.length()));
+    }
+
+    if (m_cacheValid) {
+        m_cache.append(text);
+    }
+}
+
+void PieceTable::clear()
+{
+    destroy(m_root);
+    m_root = nullptr;
+    m_original.clear();
+    m_added.clear();
+    m_originalBreaks.clear();
+    m_addedBreaks.clear();
+    m_cache.clear();
+    m_cacheValid = true;
+}
+
+int PieceTable::length() const
+{
+    return lengthOf(m_root);
+}
+
+bool PieceTable::isEmpty() const
+{
+    return m_root == nullptr;
+}
+
+QChar PieceTable::at(int position) const
+{
+    const Node *node = m_root;
+    while (node) {
+        int leftLength = lengthOf(node->left);
+        if (position < leftLength) {
+            node = node->left;
+        } else if (position < leftLength + node->length) {
+            return bufferData(node->buffer)[node->start + position - leftLength];
+        } else {
+            position -= leftLength + node->length;
+            node = node->right;
+        }
+    }
+    return QChar();
+}
+
+QString PieceTable::text() const
+{
+    if (!m_cacheValid) {
+        m_cache.clear();
+        m_cache.reserve(length());
+        appendRange(m_root, 0, length(), m_cache);
+        m_cacheValid = true;
+    }
+    return m_cache;
+}
+
+QString PieceTable::text(int position, int length) const
+{
+    position = qBound(0, position, this->length());
+    int end = qBound(position, position + length, this->length());
+
+    if (m_cacheValid) {
+        return m_cache.mid(position, end - position);
+    }
+
+    QString result;
+    result.reserve(end - position);
+    appendRange(m_root, position, end, result);
+    return result;
+}
+
+void PieceTable::insert(int position, const QString &text)
+{
+    if (text.isEmpty()) return;
+
+    position = qBound(0, position, length());
+    int start = m_added.length();
+    m_added.append(text);
+    appendLineBreaks(text, start, m_addedBreaks);
+
+    Node *left = nullptr;
+    Node *right = nullptr;
+    split(m_root, position, left, right);
+
+    // Typing usually continues the piece created by the previous keystroke
+    Node *last = rightmost(left);
+    if (last && last->buffer == Added && last->start + last->length == start) {
+        extendRightmost(left, text.length());
+    } else {
+        left = merge(left, createNode(Added, start, text.length()));
+    }
+
+    m_root = merge(left, right);
+    m_cacheValid = false;
+}
+
+void PieceTable::remove(int position, int length)
+{
+    position = qBound(0, position, this->length());
+    length = qBound(0, length, this->length() - position);
+    if (length == 0) return;
+
+    Node *left = nullptr;
+    Node *middle = nullptr;
+    Node *right = nullptr;
+    split(m_root, position, left, right);
+    split(right, length, middle, right);
+    destroy(middle);
+
+    m_root = merge(left, right);
+    m_cacheValid = false;
+}
+
+int PieceTable::indexOf(QChar ch, int from) const
+{
+    return findForward(m_root, 0, qMax(0, from), ch);
+}
+
+int PieceTable::lastIndexOf(QChar ch, int from) const
+{
+    if (from < 0) return -1;
+    return findBackward(m_root, 0, qMin(from, length() - 1), ch);
+}
+
+int PieceTable::lineCount() const
+{
+    return newlinesOf(m_root) + 1;
+}
+
+int PieceTable::lineForPosition(int position) const
+{
+    position = qBound(0, position, length());
+
+    // Count the line breaks before position
+    int line = 0;
+    const Node *node = m_root;
+    while (node) {
+        int leftLength = lengthOf(node->left);
+        if (position <= leftLength) {
+            node = node->left;
+            continue;
+        }
+
+        line += newlinesOf(node->left);
+        int offset = position - leftLength;
+        if (offset <= node->length) {
+            line += countNewlines(node->buffer, node->start, offset);
+            break;
+        }
+
+        line += node->newlines;
+        position = offset - node->length;
+        node = node->right;
+    }
+    return line;
+}
+
+int PieceTable::positionForLine(int line) const
+{
+    line = qBound(0, line, lineCount() - 1);
+    if (line == 0) return 0;
+
+    // Find the line-th line break; the line starts right after it
+    int remaining = line;
+    int base = 0;
+    const Node *node = m_root;
+    while (node) {
+        int leftNewlines = newlinesOf(node->left);
+        if (remaining <= leftNewlines) {
+            node = node->left;
+            continue;
+        }
+
+        remaining -= leftNewlines;
+        base += lengthOf(node->left);
+        if (remaining <= node->newlines) {
+            const QVector<int> &breaks = lineBreaks(node->buffer);
+            auto first = std::lower_bound(breaks.constBegin(), breaks.constEnd(), node->start);
+            return base + *(first + remaining - 1) - node->start + 1;
+        }
+
+        remaining -= node->newlines;
+        base += node->length;
+        node = node->right;
+    }
+    return length();
+}
+
+PieceTable::Node *PieceTable::createNode(Buffer buffer, int start, int length)
+{
+    // xorshift32 is plenty for treap priorities
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+
+    Node *node = new Node;
+    node->buffer = buffer;
+    node->start = start;
+    node->length = length;
+    node->newlines = countNewlines(buffer, start, length);
+    node->priority = m_seed;
+    node->subtreeLength = length;
+    node->subtreeNewlines = node->newlines;
+    node->left = nullptr;
+    node->right = nullptr;
+    return node;
+}
+
+void PieceTable::destroy(Node *node)
+{
+    if (!node) return;
+    destroy(node->left);
+    destroy(node->right);
+    delete node;
+}
+
+int PieceTable::lengthOf(const Node *node)
+{
+    return node ? node->subtreeLength : 0;
+}
+
+int PieceTable::newlinesOf(const Node *node)
+{
+    return node ? node->subtreeNewlines : 0;
+}
+
+void PieceTable::update(Node *node)
+{
+    node->subtreeLength = lengthOf(node->left) + node->length + lengthOf(node->right);
+    node->subtreeNewlines = newlinesOf(node->left) + node->newlines + newlinesOf(node->right);
+}
+
+PieceTable::Node *PieceTable::merge(Node *left, Node *right)
+{
+    if (!left) return right;
+    if (!right) return left;
+
+    if (left->priority > right->priority) {
+        left->right = merge(left->right, right);
+        update(left);
+        return left;
+    }
+
+    right->left = merge(left, right->left);
+    update(right);
+    return right;
+}
+
+void PieceTable::split(Node *node, int position, Node *&left, Node *&right)
+{
+    if (!node) {
+        left = nullptr;
+        right = nullptr;
+        return;
+    }
+
+    int leftLength = lengthOf(node->left);
+
+    if (position <= leftLength) {
+        split(node->left, position, left, node->left);
+        update(node);
+        right = node;
+    } else if (position >= leftLength + node->length) {
+        split(node->right, position - leftLength - node->length, node->right, right);
+        update(node);
+        left = node;
+    } else {
+        // Split point falls inside this piece: cut it in two. The tail keeps
+        // the same priority so both halves still satisfy the heap order.
+        int offset = position - leftLength;
+        Node *tail = createNode(node->buffer, node->start + offset, node->length - offset);
+        tail->priority = node->priority;
+        tail->right = node->right;
+        node->right = nullptr;
+        node->length = offset;
+        node->newlines -= tail->newlines;
+        update(tail);
+        update(node);
+        left = node;
+        right = tail;
+    }
+}
+
+PieceTable::Node *PieceTable::rightmost(Node *node)
+{
+    while (node && node->right) {
+        node = node->right;
+    }
+    return node;
+}
+
+void PieceTable::extendRightmost(Node *node, int delta)
+{
+    if (node->right) {
+        extendRightmost(node->right, delta);
+    } else {
+        node->length += delta;
+        node->newlines = countNewlines(node->buffer, node->start, node->length);
+    }
+    update(node);
+}
+
+const QChar *PieceTable::bufferData(Buffer buffer) const
+{
+    return buffer == Original ? m_original.constData() : m_added.constData();
+}
+
+const QVector<int> &PieceTable::lineBreaks(Buffer buffer) const
+{
+    return buffer == Original ? m_originalBreaks : m_addedBreaks;
+}
+
+int PieceTable::countNewlines(Buffer buffer, int start, int length) const
+{
+    const QVector<int> &breaks = lineBreaks(buffer);
+    auto first = std::lower_bound(breaks.constBegin(), breaks.constEnd(), start);
+    auto last = std::lower_bound(first, breaks.constEnd(), start + length);
+    return int(last - first);
+}
+
+void PieceTable::appendLineBreaks(const QString &text, int offset, QVector<int> &breaks)
+{
+    const QChar *data = text.constData();
+    for (int i = 0; i < text.length(); ++i) {
+        if (data[i] == QLatin1Char('\n')) {
+            breaks.append(offset + i);
+        }
+    }
+}
+
+void PieceTable::appendRange(const Node *node, int from, int to, QString &out) const
+{
+    if (!node || from >= to) return;
+
+    int pieceStart = lengthOf(node->left);
+    int pieceEnd = pieceStart + node->length;
+
+    if (from < pieceStart) {
+        appendRange(node->left, from, qMin(to, pieceStart), out);
+    }
+
+    int start = qMax(from, pieceStart);
+    int end = qMin(to, pieceEnd);
+    if (start < end) {
+        out.append(bufferData(node->buffer) + node->start + (start - pieceStart), end - start);
+    }
+
+    if (to > pieceEnd) {
+        appendRange(node->right, qMax(from, pieceEnd) - pieceEnd, to - pieceEnd, out);
+    }
+}
+
+int PieceTable::findForward(const Node *node, int base, int from, QChar ch) const
+{
+    if (!node || from >= base + node->subtreeLength) return -1;
+
+    int pieceStart = base + lengthOf(node->left);
+    int pieceEnd = pieceStart + node->length;
+
+    if (from < pieceStart) {
+        int found = findForward(node->left, base, from, ch);
+        if (found >= 0) return found;
+    }
+
+    if (from < pieceEnd) {
+        const QChar *data = bufferData(node->buffer) + node->start;
+        for (int i = qMax(from, pieceStart) - pieceStart; i < node->length; ++i) {
+            if (data[i] == ch) return pieceStart + i;
+        }
+    }
+
+    return findForward(node->right, pieceEnd, from, ch);
+}
+
+int PieceTable::findBackward(const Node *node, int base, int from, QChar ch) const
+{
+    if (!node || from < base) return -1;
+
+    int pieceStart = base + lengthOf(node->left);
+    int pieceEnd = pieceStart + node->length;
+
+    if (from >= pieceEnd) {
+        int found = findBackward(node->right, pieceEnd, from, ch);
+        if (found >= 0) return found;
+    }
+
+    if (from >= pieceStart) {
+        const QChar *data = bufferData(node->buffer) + node->start;
+        for (int i = qMin(from, pieceEnd - 1) - pieceStart; i >= 0; --i) {
+            if (data[i] == ch) return pieceStart + i;
+        }
+    }
+
+    return findBackward(node->left, base, from, ch);
+}
@@ -0,0 +1,120 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * piecetable.h - Piece table storage for document text
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#ifndef PIECETABLE_H
+#define PIECETABLE_H
+
+#include <QString>
+#include <QChar>
+#include <QVector>
+
+/**
+ * @brief The PieceTable class stores document text as a sequence of pieces.
+ *
+ * The loaded text and everything typed afterwards live in two append-only
+ * buffers. The document itself is a list of pieces referencing ranges of
+ * those buffers, kept in a treap ordered by document position. Inserting or
+ * removing text only splits and joins pieces, so an edit costs O(log n)
+ * regardless of document size.
+ *
+ * Each buffer also keeps the sorted offsets of its line breaks, and every
+ * tree node caches how many line breaks its subtree spans. Line/position
+ * conversions therefore descend the tree in O(log n) as well.
+ *
+ * The flattened text is built on demand and cached until the next edit.
+ */
+class PieceTable
+{
+public:
+    PieceTable();
+    ~PieceTable();
+
+    // Content
+    void setText(const QString &text);
+    void clear();
+
+    int length() const;
+    bool isEmpty() const;
+    QChar at(int position) const;
+    QString text() const;
+    QString text(int position, int length) const;
+
+    /**
+     * @brief appendOriginal - Add more loaded text at the end of the document
+     *
+     * For files loaded in chunks: the text joins the original buffer rather
+     * than the added one, and extends the last piece when possible.
+     */
+    void appendOriginal(const QString &text);
+
+    // Editing
+    void insert(int position, const QString &text);
+    void remove(int position, int length);
+
+    // Search
+    int indexOf(QChar ch, int from = 0) const;
+    int lastIndexOf(QChar ch, int from) const;
+
+    // Line index (lines are 0-based and separated by '\n')
+    int lineCount() const;
+    int lineForPosition(int position) const;
+    int positionForLine(int line) const;
+
+private:
+    enum Buffer {
+        Original,
+        Added
+    };
+
+    struct Node {
+        Buffer buffer;
+        int start;
+        int length;
+        int newlines;
+        quint32 priority;
+        int subtreeLength;
+        int subtreeNewlines;
+        Node *left;
+        Node *right;
+    };
+
+    Node *createNode(Buffer buffer, int start, int length);
+    void destroy(Node *node);
+
+    static int lengthOf(const Node *node);
+    static int newlinesOf(const Node *node);
+    static void update(Node *node);
+    static Node *merge(Node *left, Node *right);
+    void split(Node *node, int position, Node *&left, Node *&right);
+    static Node *rightmost(Node *node);
+    void extendRightmost(Node *node, int delta);
+
+    const QChar *bufferData(Buffer buffer) const;
+    const QVector<int> &lineBreaks(Buffer buffer) const;
+    int countNewlines(Buffer buffer, int start, int length) const;
+    static void appendLineBreaks(const QString &text, int offset, QVector<int> &breaks);
+    void appendRange(const Node *node, int from, int to, QString &out) const;
+    int findForward(const Node *node, int base, int from, QChar ch) const;
+    int findBackward(const Node *node, int base, int from, QChar ch) const;
+
+    QString m_original;
+    QString m_added;
+    QVector<int> m_originalBreaks;
+    QVector<int> m_addedBreaks;
+    Node *m_root;
+    quint32 m_seed;
+
+    // Flattened text, rebuilt lazily after edits
+    mutable QString m_cache;
+    mutable bool m_cacheValid;
+
+    Q_DISABLE_COPY(PieceTable)
+};
+
+#endif // PIECETABLE_H
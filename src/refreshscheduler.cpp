@@ -0,0 +1,218 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * refreshscheduler.cpp - Paces editor repaints for the e-ink panel
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#include "refreshscheduler.h"
+#include "editor.h"
+#include "metrics.h"
+#include <QTimer>
+
+RefreshScheduler::RefreshScheduler(QObject *parent)
+    : QObject(parent)
+    , m_editor(nullptr)
+    , m_timer(new QTimer(this))
+    , m_cleanupTimer(new QTimer(this))
+    , m_holdOffMs(0)
+    , m_ghostingCleanup(false)
+    , m_dirtyFirst(-1)
+    , m_dirtyLast(-1)
+    , m_dirtyGray(false)
+    , m_fullPending(false)
+    , m_flashPending(false)
+    , m_updatesSinceFull(0)
+    , m_lineCount(0)
+    , m_cursorLine(0)
+    , m_selectionFirst(-1)
+    , m_selectionLast(-1)
+{
+    // Also when due at once: the signals of one edit arrive one after the
+    // other, and the refresh should see all of them
+    m_timer->setSingleShot(true);
+    connect(m_timer, &QTimer::timeout, this, &RefreshScheduler::flush);
+
+    m_cleanupTimer->setSingleShot(true);
+    connect(m_cleanupTimer, &QTimer::timeout, this, &RefreshScheduler::requestFullRefresh);
+}
+
+void RefreshScheduler::setEditor(Editor *editor)
+{
+    if (m_editor) {
+        disconnect(m_editor, nullptr, this, nullptr);
+    }
+    m_editor = editor;
+    if (!m_editor) return;
+
+    m_lineCount = m_editor->lineCount();
+    m_cursorLine = m_editor->cursorLine();
+    m_selectionFirst = m_selectionLast = -1;
+
+    connect(m_editor, &Editor::contentsChange, this, &RefreshScheduler::contentsChanged);
+    connect(m_editor, &Editor::cursorPositionChanged, this, &RefreshScheduler::cursorMoved);
+    connect(m_editor, &Editor::selectionChanged, this, &RefreshScheduler::selectionChanged);
+    // A new page on the panel starts clean
+    connect(m_editor, &Editor::documentLoaded, this, &RefreshScheduler::documentLoaded);
+}
+
+bool RefreshScheduler::ghostingCleanup() const
+{
+    return m_ghostingCleanup;
+}
+
+void RefreshScheduler::setGhostingCleanup(bool enabled)
+{
+    if (m_ghostingCleanup == enabled) return;
+
+    m_ghostingCleanup = enabled;
+    if (!enabled) {
+        m_cleanupTimer->stop();
+    }
+    emit ghostingCleanupChanged();
+}
+
+void RefreshScheduler::contentsChanged(int position, int charsRemoved, int charsAdded)
+{
+    Q_UNUSED(charsRemoved)
+
+    int first = m_editor->lineForPosition(position);
+    int last;
+    int lineCount = m_editor->lineCount();
+    if (lineCount != m_lineCount) {
+        // Lines were added or removed: everything below moves
+        last = qMax(lineCount, m_lineCount) - 1;
+        m_lineCount = lineCount;
+    } else {
+        last = m_editor->lineForPosition(position + charsAdded);
+    }
+    markDirty(first, last);
+}
+
+void RefreshScheduler::cursorMoved()
+{
+    int line = m_editor->cursorLine();
+    if (line == m_cursorLine) {
+        markDirty(line, line);
+        return;
+    }
+
+    // The cursor leaves one line and appears on another
+    markDirty(qMin(line, m_cursorLine), qMax(line, m_cursorLine));
+    m_cursorLine = line;
+}
+
+void RefreshScheduler::selectionChanged()
+{
+    int first = -1, last = -1;
+    if (m_editor->hasSelection()) {
+        first = m_editor->lineForPosition(m_editor->selectionStart());
+        last = m_editor->lineForPosition(m_editor->selectionEnd());
+    }
+
+    // Both the old highlight and the new one change
+    if (m_selectionFirst >= 0) {
+        markDirty(m_selectionFirst, m_selectionLast, true);
+    }
+    if (first >= 0) {
+        markDirty(first, last, true);
+    }
+    m_selectionFirst = first;
+    m_selectionLast = last;
+}
+
+void RefreshScheduler::markDirty(int firstLine, int lastLine, bool grayscale)
+{
+    firstLine = qMax(0, firstLine);
+    lastLine = qMax(firstLine, lastLine);
+
+    if (m_dirtyFirst < 0) {
+        m_dirtyFirst = firstLine;
+        m_dirtyLast = lastLine;
+    } else {
+        m_dirtyFirst = qMin(m_dirtyFirst, firstLine);
+        m_dirtyLast = qMax(m_dirtyLast, lastLine);
+    }
+    m_dirtyGray = m_dirtyGray || grayscale;
+    schedule();
+}
+
+void RefreshScheduler::requestFullRefresh()
+{
+    m_fullPending = true;
+    m_flashPending = true;
+    schedule();
+}
+
+void RefreshScheduler::documentLoaded()
+{
+    // Every pixel of the page changes, which clears the ghosting without a flash
+    m_fullPending = true;
+    schedule();
+}
+
+void RefreshScheduler::schedule()
+{
+    if (m_timer->isActive()) return;
+
+    int wait = 0;
+    if (m_sinceRefresh.isValid()) {
+        wait = qMax(0, m_holdOffMs - int(m_sinceRefresh.elapsed()));
+    }
+    m_timer->start(wait);
+}
+
+void RefreshScheduler::flush()
+{
+    if (!m_fullPending && m_dirtyFirst < 0) return;
+
+    Waveform waveform;
+    if (m_fullPending) {
+        waveform = Full;
+    } else if (m_dirtyGray || m_dirtyLast - m_dirtyFirst + 1 > MAX_FAST_LINES) {
+        waveform = Partial;
+    } else {
+        waveform = Fast;
+    }
+
+    int first = m_dirtyFirst;
+    int last = m_dirtyLast;
+    if (waveform == Full) {
+        first = 0;
+        last = qMax(0, qMax(m_lineCount, m_dirtyLast + 1) - 1);
+    }
+
+    m_dirtyFirst = m_dirtyLast = -1;
+    m_dirtyGray = false;
+    m_fullPending = false;
+    const bool flash = m_flashPending;
+    m_flashPending = false;
+
+    if (waveform == Full) {
+        m_updatesSinceFull = 0;
+        m_cleanupTimer->stop();
+        m_holdOffMs = FULL_REFRESH_MS;
+    } else {
+        ++m_updatesSinceFull;
+        m_holdOffMs = MIN_REFRESH_INTERVAL_MS;
+        // Restarted by every update, so the cleanup waits for a pause; once
+        // the ghosting has built up, a short one will do
+        if (m_ghostingCleanup && m_updatesSinceFull >= FULL_REFRESH_AFTER) {
+            m_cleanupTimer->start(CLEANUP_PAUSE_MS);
+        } else if (m_ghostingCleanup && m_updatesSinceFull >= CLEANUP_IDLE_MIN_UPDATES) {
+            m_cleanupTimer->start(CLEANUP_IDLE_MS);
+        }
+    }
+    m_sinceRefresh.start();
+
+    static Metrics::Counter &fast = Metrics::instance().counter("display.refresh_fast");
+    static Metrics::Counter &partial = Metrics::instance().counter("display.refresh_partial");
+    static Metrics::Counter &full = Metrics::instance().counter("display.refresh_full");
+    static Metrics::Histogram &lines = Metrics::instance().histogram("display.refresh_lines");
+    (waveform == Full ? full : waveform == Partial ? partial : fast).add();
+    lines.record(last - first + 1);
+
+    emit refresh(first, last, waveform, flash);
+}
@@ -0,0 +1,113 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * refreshscheduler.h - Paces editor repaints for the e-ink panel
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#ifndef REFRESHSCHEDULER_H
+#define REFRESHSCHEDULER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+
+class Editor;
+class QTimer;
+
+/**
+ * @brief The RefreshScheduler class decides when and how the editor view redraws.
+ *
+ * Edits, cursor moves and selection changes only mark lines dirty. The view
+ * applies them when refresh() is emitted, which happens at most once per
+ * MIN_REFRESH_INTERVAL_MS and at once for the first change after a pause,
+ * so a burst of typing costs one panel update per interval instead of one
+ * per signal.
+ *
+ * Each refresh names the range of lines that changed and the waveform it
+ * calls for: Fast for a few lines of black and white text, as when typing,
+ * Partial for larger or grey changes such as selections, and Full to clear
+ * the ghosting that fast updates leave behind. With ghosting cleanup on, a
+ * Full refresh that flashes the editor is forced once the user pauses for
+ * CLEANUP_IDLE_MS, or for CLEANUP_PAUSE_MS after FULL_REFRESH_AFTER updates;
+ * never in the middle of typing. A newly loaded document gets a Full
+ * refresh without the flash, as its whole page changes anyway.
+ */
+class RefreshScheduler : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool ghostingCleanup READ ghostingCleanup WRITE setGhostingCleanup NOTIFY ghostingCleanupChanged)
+
+public:
+    enum Waveform {
+        Fast = 0,
+        Partial = 1,
+        Full = 2
+    };
+
+    explicit RefreshScheduler(QObject *parent = nullptr);
+
+    void setEditor(Editor *editor);
+
+    // Only e-ink panels ghost; elsewhere no Full refresh is ever forced
+    bool ghostingCleanup() const;
+    void setGhostingCleanup(bool enabled);
+
+public slots:
+    /**
+     * @brief markDirty - Lines [firstLine, lastLine] need redrawing
+     * @param grayscale - The change includes grey, which Fast cannot show
+     */
+    void markDirty(int firstLine, int lastLine, bool grayscale = false);
+
+    /**
+     * @brief requestFullRefresh - Redraw everything with the Full waveform,
+     * flashing the editor to clear ghosting
+     */
+    void requestFullRefresh();
+
+signals:
+    // waveform: 0=fast, 1=partial, 2=full; flash only ever with full
+    void refresh(int firstLine, int lastLine, int waveform, bool flash);
+    void ghostingCleanupChanged();
+
+private:
+    void contentsChanged(int position, int charsRemoved, int charsAdded);
+    void cursorMoved();
+    void selectionChanged();
+    void documentLoaded();
+    void schedule();
+    void flush();
+
+    Editor *m_editor;
+    QTimer *m_timer;            // Next refresh, within the budget
+    QTimer *m_cleanupTimer;     // Full refresh once typing pauses
+    QElapsedTimer m_sinceRefresh;
+    int m_holdOffMs;            // Until the panel is ready for the next update
+    bool m_ghostingCleanup;
+
+    // Pending refresh
+    int m_dirtyFirst;           // -1 when nothing is dirty
+    int m_dirtyLast;
+    bool m_dirtyGray;
+    bool m_fullPending;
+    bool m_flashPending;
+    int m_updatesSinceFull;
+
+    // What is on screen, to dirty it when it moves
+    int m_lineCount;
+    int m_cursorLine;
+    int m_selectionFirst;       // -1 without a selection
+    int m_selectionLast;
+
+    static const int MIN_REFRESH_INTERVAL_MS = 100;
+    static const int FULL_REFRESH_MS = 450;      // A Full waveform takes this long
+    static const int MAX_FAST_LINES = 3;
+    static const int FULL_REFRESH_AFTER = 60;
+    static const int CLEANUP_IDLE_MS = 4000;
+    static const int CLEANUP_IDLE_MIN_UPDATES = 10; // Not worth a flash for fewer
+    static const int CLEANUP_PAUSE_MS = 1000;       // Once FULL_REFRESH_AFTER is reached
+};
+
+#endif // REFRESHSCHEDULER_H
@@ -0,0 +1,385 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * searchindex.cpp - Inverted full-text index over the documents
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#include "searchindex.h"
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <QtMath>
+#include <algorithm>
+
+namespace {
+
+// BM25 parameters
+const double K1 = 1.2;
+const double B = 0.75;
+
+// Weight of a prefix match relative to a whole word, and of a name match
+const double PREFIX_WEIGHT = 0.8;
+const double NAME_BONUS = 2.0;
+
+} // namespace
+
+SearchIndex::SearchIndex()
+    : m_totalLength(0)
+    , m_dirty(false)
+{
+}
+
+QStringList SearchIndex::tokenize(const QString &text)
+{
+    QStringList tokens;
+    QString token;
+
+    const auto flush = [&]() {
+        if (token.size() >= MIN_TOKEN_LENGTH && token.size() <= MAX_TOKEN_LENGTH) {
+            tokens << token;
+        }
+        token.clear();
+    };
+
+    for (const QChar &ch : text) {
+        if (ch.isLetterOrNumber()) {
+            token += ch.toLower();
+        } else {
+            flush();
+        }
+    }
+    flush();
+
+    return tokens;
+}
+
+void SearchIndex::load(const QString &path)
+{
+    m_path = path;
+    m_documents.clear();
+    m_ids.clear();
+    m_freeIds.clear();
+    m_postings.clear();
+    m_nameTerms.clear();
+    m_totalLength = 0;
+    m_dirty = false;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_15);
+
+    quint32 magic, version;
+    in >> magic >> version;
+    if (magic != FILE_MAGIC || version != FILE_VERSION) return;
+
+    // Documents, then postings by token. Counts are checked against what is
+    // left of the file before anything is allocated for them
+    qint32 documentCount = -1;
+    in >> documentCount;
+    if (documentCount < 0
+            || qint64(documentCount) * MIN_DOCUMENT_BYTES > file.size() - file.pos()) {
+        m_dirty = true; // Corrupt: rebuild from the documents
+        return;
+    }
+    m_documents.resize(documentCount);
+    for (Document &document : m_documents) {
+        in >> document.name >> document.modified >> document.length;
+    }
+
+    qint32 termCount;
+    in >> termCount;
+    for (qint32 i = 0; i < termCount && in.status() == QDataStream::Ok; ++i) {
+        QString term;
+        qint32 postingCount = -1;
+        in >> term >> postingCount;
+        if (postingCount < 0
+                || qint64(postingCount) * POSTING_BYTES > file.size() - file.pos()) {
+            in.setStatus(QDataStream::ReadCorruptData);
+            break;
+        }
+
+        QHash<int, int> &postings = m_postings[term];
+        postings.reserve(postingCount);
+        for (qint32 j = 0; j < postingCount; ++j) {
+            qint32 id, count;
+            in >> id >> count;
+            if (id < 0 || id >= m_documents.size()) continue;
+            postings.insert(id, count);
+            m_documents[id].terms << term;
+        }
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        // Truncated or corrupt: rebuild from the documents
+        m_documents.clear();
+        m_postings.clear();
+        m_dirty = true;
+        return;
+    }
+
+    for (int id = 0; id < m_documents.size(); ++id) {
+        const Document &document = m_documents[id];
+        if (document.name.isEmpty()) {
+            m_freeIds << id;
+        } else {
+            m_ids.insert(document.name, id);
+            m_totalLength += document.length;
+            addName(id);
+        }
+    }
+}
+
+bool SearchIndex::save()
+{
+    if (!m_dirty || m_path.isEmpty()) return true;
+
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << FILE_MAGIC << FILE_VERSION;
+
+    out << qint32(m_documents.size());
+    for (const Document &document : m_documents) {
+        out << document.name << document.modified << document.length;
+    }
+
+    out << qint32(m_postings.size());
+    for (auto it = m_postings.constBegin(); it != m_postings.constEnd(); ++it) {
+        out << it.key() << qint32(it->size());
+        for (auto posting = it->constBegin(); posting != it->constEnd(); ++posting) {
+            out << qint32(posting.key()) << qint32(posting.value());
+        }
+    }
+
+    if (!file.commit()) return false;
+    m_dirty = false;
+    return true;
+}
+
+bool SearchIndex::isDirty() const
+{
+    return m_dirty;
+}
+
+void SearchIndex::update(const QString &name, const QString &text, qint64 modified)
+{
+    int id;
+    if (m_ids.contains(name)) {
+        id = m_ids.value(name);
+        removeId(id);
+    } else if (!m_freeIds.isEmpty()) {
+        id = m_freeIds.takeLast();
+    } else {
+        id = m_documents.size();
+        m_documents.append(Document());
+    }
+
+    const QStringList tokens = tokenize(text);
+    QHash<QString, int> counts;
+    for (const QString &token : tokens) {
+        ++counts[token];
+    }
+
+    Document &document = m_documents[id];
+    document.name = name;
+    document.modified = modified;
+    document.length = tokens.size();
+    document.terms = counts.keys();
+    for (auto it = counts.constBegin(); it != counts.constEnd(); ++it) {
+        m_postings[it.key()].insert(id, it.value());
+    }
+
+    m_ids.insert(name, id);
+    m_totalLength += document.length;
+    addName(id);
+    m_dirty = true;
+}
+
+void SearchIndex::removeId(int id)
+{
+    removeName(id);
+    Document &document = m_documents[id];
+    for (const QString &term : document.terms) {
+        auto it = m_postings.find(term);
+        if (it == m_postings.end()) continue;
+        it->remove(id);
+        if (it->isEmpty()) m_postings.erase(it);
+    }
+    m_totalLength -= document.length;
+    document = Document();
+    m_dirty = true;
+}
+
+void SearchIndex::remove(const QString &name)
+{
+    auto it = m_ids.find(name);
+    if (it == m_ids.end()) return;
+
+    int id = it.value();
+    m_ids.erase(it);
+    removeId(id);
+    m_freeIds << id;
+}
+
+void SearchIndex::rename(const QString &oldName, const QString &newName)
+{
+    auto it = m_ids.find(oldName);
+    if (it == m_ids.end()) return;
+
+    int id = it.value();
+    m_ids.erase(it);
+    m_ids.insert(newName, id);
+    removeName(id);
+    m_documents[id].name = newName;
+    addName(id);
+    m_dirty = true;
+}
+
+void SearchIndex::addName(int id)
+{
+    for (const QString &term : tokenize(m_documents[id].name)) {
+        m_nameTerms[term].insert(id);
+    }
+}
+
+void SearchIndex::removeName(int id)
+{
+    for (const QString &term : tokenize(m_documents[id].name)) {
+        auto it = m_nameTerms.find(term);
+        if (it == m_nameTerms.end()) continue;
+        it->remove(id);
+        if (it->isEmpty()) m_nameTerms.erase(it);
+    }
+}
+
+bool SearchIndex::contains(const QString &name) const
+{
+    return m_ids.contains(name);
+}
+
+qint64 SearchIndex::modified(const QString &name) const
+{
+    auto it = m_ids.constFind(name);
+    return it != m_ids.constEnd() ? m_documents[it.value()].modified : 0;
+}
+
+QStringList SearchIndex::names() const
+{
+    return m_ids.keys();
+}
+
+QHash<int, double> SearchIndex::scoreTerm(const QString &term, bool prefix) const
+{
+    QHash<int, double> scores;
+    const int documentCount = m_ids.size();
+    if (documentCount == 0) return scores;
+    const double averageLength = qMax(1.0, double(m_totalLength) / documentCount);
+
+    const auto add = [&](const QHash<int, int> &postings, double weight) {
+        const double df = postings.size();
+        const double idf = qLn(1.0 + (documentCount - df + 0.5) / (df + 0.5));
+        for (auto it = postings.constBegin(); it != postings.constEnd(); ++it) {
+            const double tf = it.value();
+            const double norm = 1.0 - B + B * m_documents[it.key()].length / averageLength;
+            const double score = weight * idf * tf * (K1 + 1) / (tf + K1 * norm);
+            double &best = scores[it.key()];
+            best = qMax(best, score);
+        }
+    };
+
+    auto exact = m_postings.constFind(term);
+    if (exact != m_postings.constEnd()) {
+        add(exact.value(), 1.0);
+    }
+
+    if (prefix) {
+        // Tokens starting with term sort right after it
+        int expanded = 0;
+        for (auto it = m_postings.lowerBound(term);
+             it != m_postings.constEnd() && it.key().startsWith(term) && expanded < MAX_PREFIX_TERMS;
+             ++it) {
+            if (it.key() == term) continue;
+            add(it.value(), PREFIX_WEIGHT);
+            ++expanded;
+        }
+    }
+
+    return scores;
+}
+
+QSet<int> SearchIndex::matchName(const QString &term, bool prefix) const
+{
+    QSet<int> ids = m_nameTerms.value(term);
+    if (!prefix) return ids;
+
+    int expanded = 0;
+    for (auto it = m_nameTerms.lowerBound(term);
+         it != m_nameTerms.constEnd() && it.key().startsWith(term) && expanded < MAX_PREFIX_TERMS;
+         ++it) {
+        if (it.key() == term) continue;
+        ids.unite(it.value());
+        ++expanded;
+    }
+    return ids;
+}
+
+QList<SearchIndex::Hit> SearchIndex::search(const QString &query, int limit) const
+{
+    QList<Hit> hits;
+    const QStringList terms = tokenize(query);
+    if (terms.isEmpty() || limit <= 0) return hits;
+
+    // The last word may still be incomplete
+    const bool lastIsPartial = !query.isEmpty() && query.at(query.size() - 1).isLetterOrNumber();
+
+    QHash<int, double> total;
+    for (int i = 0; i < terms.size(); ++i) {
+        const bool prefix = lastIsPartial && i == terms.size() - 1;
+        QHash<int, double> scores = scoreTerm(terms[i], prefix);
+
+        // Names count too, so a title word works even if the text lacks it
+        for (int id : matchName(terms[i], prefix)) {
+            scores[id] += NAME_BONUS;
+        }
+
+        if (i == 0) {
+            total = scores;
+            continue;
+        }
+
+        // Every word has to match
+        for (auto it = total.begin(); it != total.end(); ) {
+            auto score = scores.constFind(it.key());
+            if (score == scores.constEnd()) {
+                it = total.erase(it);
+            } else {
+                it.value() += score.value();
+                ++it;
+            }
+        }
+    }
+
+    hits.reserve(total.size());
+    for (auto it = total.constBegin(); it != total.constEnd(); ++it) {
+        hits.append({ m_documents[it.key()].name, it.value() });
+    }
+
+    const auto better = [](const Hit &a, const Hit &b) {
+        return a.score != b.score ? a.score > b.score : a.name < b.name;
+    };
+    if (hits.size() > limit) {
+        std::partial_sort(hits.begin(), hits.begin() + limit, hits.end(), better);
+        hits.erase(hits.begin() + limit, hits.end());
+    } else {
+        std::sort(hits.begin(), hits.end(), better);
+    }
+
+    return hits;
+}
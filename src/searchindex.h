@@ -0,0 +1,102 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * searchindex.h - Inverted full-text index over the documents
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QVector>
+#include <QList>
+
+/**
+ * @brief The SearchIndex class answers content queries without opening files.
+ *
+ * Documents are split into lower-cased word tokens; for every token the index
+ * keeps the documents containing it and how often (its postings). Queries
+ * are ranked with BM25, every query word must match, and the last word also
+ * matches as a prefix so results appear while it is still being typed. A
+ * word found in the document name counts extra.
+ *
+ * The index is updated one document at a time and saved to a single file,
+ * so a restart only re-reads documents whose modification time changed.
+ */
+class SearchIndex
+{
+public:
+    struct Hit {
+        QString name;
+        double score;
+    };
+
+    SearchIndex();
+
+    /**
+     * @brief load - Read the index from path; starts empty if it is missing
+     *        or from another version
+     */
+    void load(const QString &path);
+
+    /**
+     * @brief save - Write the index back if it changed
+     */
+    bool save();
+    bool isDirty() const;
+
+    // Per-document maintenance
+    void update(const QString &name, const QString &text, qint64 modified);
+    void remove(const QString &name);
+    void rename(const QString &oldName, const QString &newName);
+    bool contains(const QString &name) const;
+    qint64 modified(const QString &name) const;
+    QStringList names() const;
+
+    /**
+     * @brief search - Best matches for query, highest score first
+     */
+    QList<Hit> search(const QString &query, int limit) const;
+
+    static QStringList tokenize(const QString &text);
+
+private:
+    struct Document {
+        QString name;            // Empty for a free slot
+        qint64 modified = 0;
+        int length = 0;          // Tokens, for length normalisation
+        QStringList terms;       // Distinct tokens, to find our postings again
+    };
+
+    QHash<int, double> scoreTerm(const QString &term, bool prefix) const;
+    QSet<int> matchName(const QString &term, bool prefix) const;
+    void removeId(int id);
+    void addName(int id);
+    void removeName(int id);
+
+    QString m_path;
+    QVector<Document> m_documents;
+    QHash<QString, int> m_ids;              // Name -> slot in m_documents
+    QVector<int> m_freeIds;
+    QMap<QString, QHash<int, int>> m_postings; // Token -> (document -> count)
+    QMap<QString, QSet<int>> m_nameTerms;   // Name token -> documents; rebuilt on load
+    qint64 m_totalLength;
+    bool m_dirty;
+
+    static const quint32 FILE_MAGIC = 0x47575358; // "GWSX"
+    static const quint32 FILE_VERSION = 1;
+    static const int MIN_TOKEN_LENGTH = 2;
+    static const int MAX_TOKEN_LENGTH = 40;
+    static const int MAX_PREFIX_TERMS = 64;
+    static const int MIN_DOCUMENT_BYTES = 16; // Empty name, modified and length
+    static const int POSTING_BYTES = 8;
+};
+
+#endif // SEARCHINDEX_H
@@ -0,0 +1,101 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * streamparser.cpp - Incremental stream parser implementation
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#include "streamparser.h"
+
+StreamParser::StreamParser(Format format)
+    : m_format(format)
+    , m_hasEventData(false)
+{
+}
+
+void StreamParser::reset(Format format)
+{
+    m_format = format;
+    m_buffer.clear();
+    m_eventData.clear();
+    m_hasEventData = false;
+}
+
+StreamParser::Format StreamParser::format() const
+{
+    return m_format;
+}
+
+QList<QByteArray> StreamParser::feed(const QByteArray &data)
+{
+    QList<QByteArray> messages;
+    m_buffer.append(data);
+
+    int start = 0;
+    int newline;
+    while ((newline = m_buffer.indexOf('\n', start)) >= 0) {
+        takeLine(m_buffer.mid(start, newline - start), messages);
+        start = newline + 1;
+    }
+    m_buffer.remove(0, start);
+
+    return messages;
+}
+
+QList<QByteArray> StreamParser::finish()
+{
+    QList<QByteArray> messages;
+    if (!m_buffer.isEmpty()) {
+        takeLine(m_buffer, messages);
+        m_buffer.clear();
+    }
+    // End of stream also ends a pending event
+    if (m_format == ServerSentEvents) {
+        takeLine(QByteArray(), messages);
+    }
+    return messages;
+}
+
+void StreamParser::takeLine(QByteArray line, QList<QByteArray> &messages)
+{
+    if (line.endsWith('\r')) {
+        line.chop(1);
+    }
+
+    if (m_format == NdJson) {
+        line = line.trimmed();
+        if (!line.isEmpty()) {
+            messages.append(line);
+        }
+        return;
+    }
+
+    // A blank line dispatches the event collected so far
+    if (line.isEmpty()) {
+        if (m_hasEventData) {
+            messages.append(m_eventData);
+            m_eventData.clear();
+            m_hasEventData = false;
+        }
+        return;
+    }
+
+    if (line.startsWith(':')) return; // Comment / keep-alive
+
+    int colon = line.indexOf(':');
+    QByteArray field = colon < 0 ? line : line.left(colon);
+    if (field != "data") return; // event:, id:, retry: are not needed
+
+    QByteArray value = colon < 0 ? QByteArray() : line.mid(colon + 1);
+    if (value.startsWith(' ')) {
+        value.remove(0, 1);
+    }
+
+    if (m_hasEventData) {
+        m_eventData.append('\n');
+    }
+    m_eventData.append(value);
+    m_hasEventData = true;
+}
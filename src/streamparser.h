@@ -0,0 +1,60 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * streamparser.h - Incremental parser for streamed AI responses
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#ifndef STREAMPARSER_H
+#define STREAMPARSER_H
+
+#include <QByteArray>
+#include <QList>
+
+/**
+ * @brief The StreamParser class splits a streamed HTTP body into messages.
+ *
+ * Bytes are fed as they arrive from QNetworkReply::readyRead, in chunks of
+ * any size. Each complete message is returned once its terminator has been
+ * seen, and partial lines are kept until the next feed().
+ *
+ * - ServerSentEvents (OpenAI, Anthropic): one message per event, made of its
+ *   "data:" lines joined with '\n'. Comments and other fields are skipped.
+ * - NdJson (Ollama): one message per non-empty line.
+ */
+class StreamParser
+{
+public:
+    enum Format {
+        ServerSentEvents,
+        NdJson
+    };
+
+    explicit StreamParser(Format format = ServerSentEvents);
+
+    void reset(Format format);
+    Format format() const;
+
+    /**
+     * @brief feed - Consume the next chunk of the body
+     * @return Messages completed by this chunk, in order
+     */
+    QList<QByteArray> feed(const QByteArray &data);
+
+    /**
+     * @brief finish - Flush a final message that lacked its terminator
+     */
+    QList<QByteArray> finish();
+
+private:
+    void takeLine(QByteArray line, QList<QByteArray> &messages);
+
+    Format m_format;
+    QByteArray m_buffer;
+    QByteArray m_eventData;
+    bool m_hasEventData;
+};
+
+#endif // STREAMPARSER_H
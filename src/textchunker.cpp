@@ -0,0 +1,108 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * textchunker.cpp - Split long text into model-sized pieces
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#include "textchunker.h"
+
+QStringList TextChunker::split(const QString &text, int maxChars)
+{
+    QStringList chunks;
+    QString current;
+
+    for (const QString &block : blocks(text)) {
+        if (block.size() > maxChars) {
+            if (!current.isEmpty()) {
+                chunks << current;
+                current.clear();
+            }
+            splitLongBlock(block, maxChars, chunks);
+            continue;
+        }
+
+        bool full = current.size() + 2 + block.size() > maxChars;
+        bool newSection = isHeading(block) && current.size() >= maxChars / 2;
+        if (!current.isEmpty() && (full || newSection)) {
+            chunks << current;
+            current.clear();
+        }
+
+        if (!current.isEmpty()) current += "\n\n";
+        current += block;
+    }
+
+    if (!current.isEmpty()) {
+        chunks << current;
+    }
+    return chunks;
+}
+
+QStringList TextChunker::blocks(const QString &text)
+{
+    QStringList result;
+    QStringList lines;
+
+    auto flush = [&]() {
+        QString block = lines.join('\n').trimmed();
+        if (!block.isEmpty()) result << block;
+        lines.clear();
+    };
+
+    for (const QString &line : text.split('\n')) {
+        if (line.trimmed().isEmpty()) {
+            flush();
+            continue;
+        }
+        if (isHeading(line)) {
+            flush();
+        }
+        lines << line;
+    }
+    flush();
+
+    return result;
+}
+
+void TextChunker::splitLongBlock(const QString &block, int maxChars, QStringList &out)
+{
+    QString rest = block;
+
+    while (rest.size() > maxChars) {
+        // Don't settle for a cut that leaves a tiny piece
+        const int minCut = maxChars / 4;
+        int cut = rest.lastIndexOf('\n', maxChars);
+
+        if (cut < minCut) {
+            cut = -1;
+            for (int i = maxChars - 1; i >= minCut; --i) {
+                QChar ch = rest.at(i);
+                if ((ch == '.' || ch == '!' || ch == '?') && rest.at(i + 1).isSpace()) {
+                    cut = i + 1;
+                    break;
+                }
+            }
+        }
+        if (cut < minCut) {
+            cut = rest.lastIndexOf(' ', maxChars);
+        }
+        if (cut < minCut) {
+            cut = maxChars;
+        }
+
+        out << rest.left(cut).trimmed();
+        rest = rest.mid(cut).trimmed();
+    }
+
+    if (!rest.isEmpty()) {
+        out << rest;
+    }
+}
+
+bool TextChunker::isHeading(const QString &block)
+{
+    return block.startsWith('#');
+}
@@ -0,0 +1,40 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * textchunker.h - Split long text into model-sized pieces
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#ifndef TEXTCHUNKER_H
+#define TEXTCHUNKER_H
+
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief The TextChunker class splits text at natural boundaries.
+ *
+ * The text is first cut into blocks at blank lines and before Markdown
+ * headings. Blocks are then packed greedily into chunks of at most maxChars,
+ * and a heading starts a new chunk once the current one is at least half
+ * full, so sections tend to stay together. A single block longer than
+ * maxChars is cut at line breaks, then at sentence ends, and only as a last
+ * resort in the middle of a word.
+ *
+ * Chunks are trimmed; joining them with blank lines gives back the text
+ * with its paragraph structure.
+ */
+class TextChunker
+{
+public:
+    static QStringList split(const QString &text, int maxChars);
+
+private:
+    static QStringList blocks(const QString &text);
+    static void splitLongBlock(const QString &block, int maxChars, QStringList &out);
+    static bool isHeading(const QString &block);
+};
+
+#endif // TEXTCHUNKER_H
@@ -0,0 +1,139 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * undohistory.cpp - Delta-based undo/redo history implementation
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#include "undohistory.h"
+
+UndoHistory::UndoHistory()
+    : m_groupOpen(false)
+    , m_bytes(0)
+    , m_maxBytes(DEFAULT_MAX_BYTES)
+{
+}
+
+void UndoHistory::clear()
+{
+    m_undoStack.clear();
+    m_redoStack.clear();
+    m_groupOpen = false;
+    m_bytes = 0;
+}
+
+void UndoHistory::record(int position, const QString &removed, const QString &inserted, int cursorBefore)
+{
+    if (removed.isEmpty() && inserted.isEmpty()) return;
+
+    // A new edit invalidates everything that could have been redone
+    for (const EditDelta &delta : m_redoStack) {
+        m_bytes -= costOf(delta);
+    }
+    m_redoStack.clear();
+
+    EditDelta delta{position, removed, inserted, cursorBefore};
+
+    if (!m_groupOpen || !coalesce(delta)) {
+        m_undoStack.append(delta);
+        m_bytes += costOf(delta);
+    }
+
+    // Typing runs end at a line break
+    m_groupOpen = !inserted.endsWith('\n');
+
+    trimToBudget();
+}
+
+void UndoHistory::closeGroup()
+{
+    m_groupOpen = false;
+}
+
+bool UndoHistory::canUndo() const
+{
+    return !m_undoStack.isEmpty();
+}
+
+bool UndoHistory::canRedo() const
+{
+    return !m_redoStack.isEmpty();
+}
+
+EditDelta UndoHistory::undo()
+{
+    EditDelta delta = m_undoStack.takeLast();
+    m_redoStack.append(delta);
+    m_groupOpen = false;
+    return delta;
+}
+
+EditDelta UndoHistory::redo()
+{
+    EditDelta delta = m_redoStack.takeLast();
+    m_undoStack.append(delta);
+    m_groupOpen = false;
+    return delta;
+}
+
+qint64 UndoHistory::bytes() const
+{
+    return m_bytes;
+}
+
+qint64 UndoHistory::maxBytes() const
+{
+    return m_maxBytes;
+}
+
+void UndoHistory::setMaxBytes(qint64 bytes)
+{
+    m_maxBytes = bytes;
+    trimToBudget();
+}
+
+bool UndoHistory::coalesce(const EditDelta &delta)
+{
+    if (m_undoStack.isEmpty()) return false;
+
+    EditDelta &last = m_undoStack.last();
+    qint64 before = costOf(last);
+
+    if (delta.removed.isEmpty() && last.removed.isEmpty()) {
+        // Typing: the new text continues right where the last insert ended
+        if (delta.position != last.position + last.inserted.length()) return false;
+        last.inserted += delta.inserted;
+    } else if (delta.inserted.isEmpty() && last.inserted.isEmpty()) {
+        if (delta.position + delta.removed.length() == last.position) {
+            // Backspace: removal grows towards the start of the document
+            last.removed.prepend(delta.removed);
+            last.position = delta.position;
+        } else if (delta.position == last.position) {
+            // Forward delete: removal grows towards the end of the document
+            last.removed += delta.removed;
+        } else {
+            return false;
+        }
+    } else {
+        return false;
+    }
+
+    m_bytes += costOf(last) - before;
+    return true;
+}
+
+void UndoHistory::trimToBudget()
+{
+    // Always keep the newest step, even if it alone exceeds the budget
+    while (m_bytes > m_maxBytes && m_undoStack.size() > 1) {
+        m_bytes -= costOf(m_undoStack.takeFirst());
+    }
+}
+
+qint64 UndoHistory::costOf(const EditDelta &delta)
+{
+    return qint64(sizeof(EditDelta))
+        + qint64(delta.removed.size() + delta.inserted.size()) * qint64(sizeof(QChar));
+}
@@ -0,0 +1,82 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * undohistory.h - Delta-based undo/redo history
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#ifndef UNDOHISTORY_H
+#define UNDOHISTORY_H
+
+#include <QString>
+#include <QList>
+
+/**
+ * @brief The EditDelta struct describes one reversible edit.
+ *
+ * At @c position, the text @c removed was replaced with @c inserted.
+ * @c cursorBefore is where the cursor was before the edit, so undo can
+ * put it back.
+ */
+struct EditDelta {
+    int position;
+    QString removed;
+    QString inserted;
+    int cursorBefore;
+};
+
+/**
+ * @brief The UndoHistory class keeps an operation log of edit deltas.
+ *
+ * Only the changed text is stored, never whole-document snapshots.
+ * Consecutive typing, backspacing or forward deleting at adjacent positions
+ * is coalesced into a single delta, so one undo reverts a whole typing run.
+ * The history is capped by a byte budget; the oldest entries are dropped
+ * first when it is exceeded.
+ */
+class UndoHistory
+{
+public:
+    UndoHistory();
+
+    void clear();
+
+    /**
+     * @brief record - Log an edit, merging it with the previous one when possible
+     */
+    void record(int position, const QString &removed, const QString &inserted, int cursorBefore);
+
+    /**
+     * @brief closeGroup - Stop coalescing; the next edit starts a new undo step
+     */
+    void closeGroup();
+
+    bool canUndo() const;
+    bool canRedo() const;
+
+    // Move the newest entry between the stacks and return it for replay
+    EditDelta undo();
+    EditDelta redo();
+
+    // Memory accounting
+    qint64 bytes() const;
+    qint64 maxBytes() const;
+    void setMaxBytes(qint64 bytes);
+
+private:
+    bool coalesce(const EditDelta &delta);
+    void trimToBudget();
+    static qint64 costOf(const EditDelta &delta);
+
+    QList<EditDelta> m_undoStack;
+    QList<EditDelta> m_redoStack;
+    bool m_groupOpen;
+    qint64 m_bytes;
+    qint64 m_maxBytes;
+
+    static const qint64 DEFAULT_MAX_BYTES = 4 * 1024 * 1024;
+};
+
+#endif // UNDOHISTORY_H
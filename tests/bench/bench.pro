@@ -0,0 +1,17 @@
+# Benchmarks for the Ghostwriter Pro core
+#
+#   make check                          runs them all, offscreen unless
+#                                       QT_QPA_PLATFORM says otherwise
+#   ./bench editorInsert                runs one
+#   ./bench -iterations 100 -csv        see ./bench -help
+
+QT += testlib
+
+CONFIG += testcase
+
+TARGET = bench
+TEMPLATE = app
+
+include(../../core.pri)
+
+SOURCES += benchcore.cpp
@@ -0,0 +1,505 @@
+/**
+ * Ghostwriter Pro - A typewriter application for reMarkable Paper Pro
+ *
+ * benchcore.cpp - Benchmarks for editing, search, diagrams and AI responses
+ *
+ * Copyright (c) 2026 tobsai
+ * Licensed under MIT License
+ */
+
+#include <QtTest>
+#include <QGuiApplication>
+#include <QTemporaryDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+#include "editor.h"
+#include "editjournal.h"
+#include "filemanager.h"
+#include "mermaidrenderer.h"
+#include "diagramrasterizer.h"
+#include "aiclient.h"
+#include "streamparser.h"
+
+/**
+ * @brief The BenchCore class times the operations a user waits on.
+ *
+ * Editing benchmarks run on documents from 1 KB to 10 MB, loaded the way
+ * the application loads them, so that costs growing with document size
+ * show up as a slope across the rows.
+ */
+class BenchCore : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanup();
+
+    // Editing
+    void editorLoad_data();
+    void editorLoad();
+    void editorInsert_data();
+    void editorInsert();
+    void editorBackspace_data();
+    void editorBackspace();
+    void editorUndo_data();
+    void editorUndo();
+
+    // Cursor navigation
+    void cursorLeftRight_data();
+    void cursorLeftRight();
+    void cursorUpDown_data();
+    void cursorUpDown();
+    void goToLine_data();
+    void goToLine();
+
+    // Document search
+    void searchDocuments_data();
+    void searchDocuments();
+
+    // Mermaid fallbacks
+    void mermaidToText_data();
+    void mermaidToText();
+    void mermaidRasterize_data();
+    void mermaidRasterize();
+
+    // AI responses
+    void parseResponse_data();
+    void parseResponse();
+    void parseStream_data();
+    void parseStream();
+
+private:
+    void documentSizes();
+    QString documentPath(int bytes);
+    void load(Editor &editor, int bytes);
+
+    QTemporaryDir m_dir;
+    QHash<int, QString> m_documents;     // Sample documents by size
+    FileManager m_fileManager;
+};
+
+namespace {
+
+const char *const SAMPLE_LINE =
+    "The quick brown fox jumps over the lazy dog while the typewriter hums.";
+
+// Prose of roughly the given size: lines of ~70 characters, paragraphs of five
+QString sampleText(int bytes)
+{
+    QString text;
+    text.reserve(bytes + 128);
+    int line = 0;
+    while (text.size() < bytes) {
+        text += QLatin1String(SAMPLE_LINE);
+        text += ++line % 5 == 0 ? QLatin1String("\n\n") : QLatin1String("\n");
+    }
+    return text;
+}
+
+const char *const FLOWCHART =
+    "flowchart TD\n"
+    "    A[Draft] --> B{Reviewed?}\n"
+    "    B -->|Yes| C[Edit]\n"
+    "    B -->|No| D[Rewrite]\n"
+    "    C --> E[Proofread]\n"
+    "    D --> A\n"
+    "    E --> F{Typos?}\n"
+    "    F -->|Yes| C\n"
+    "    F -->|No| G[Publish]\n"
+    "    G --> H[Archive]\n"
+    "    G --> I[Share]\n"
+    "    I --> J[Feedback]\n"
+    "    J --> A\n";
+
+const char *const SEQUENCE =
+    "sequenceDiagram\n"
+    "    participant U as User\n"
+    "    participant E as Editor\n"
+    "    participant A as AI\n"
+    "    U->>E: Select text\n"
+    "    U->>E: Ctrl+T\n"
+    "    E->>A: Transform request\n"
+    "    A-->>E: Streamed reply\n"
+    "    E-->>U: Show result\n"
+    "    U->>E: Replace\n"
+    "    E->>E: Record undo step\n"
+    "    E-->>U: Updated document\n";
+
+const char *const MINDMAP =
+    "mindmap\n"
+    "  root((Novel))\n"
+    "    Characters\n"
+    "      Protagonist\n"
+    "      Antagonist\n"
+    "    Plot\n"
+    "      Setup\n"
+    "      Conflict\n"
+    "      Resolution\n"
+    "    Setting\n"
+    "      City\n"
+    "      Countryside\n";
+
+const char *const PIE =
+    "pie title Words per chapter\n"
+    "    \"One\" : 3200\n"
+    "    \"Two\" : 4100\n"
+    "    \"Three\" : 2800\n";
+
+QByteArray responseBody(AIProvider provider, const QString &content)
+{
+    QJsonObject root;
+    switch (provider) {
+    case AIProvider::OpenAI:
+        root["choices"] = QJsonArray{ QJsonObject{
+            { "index", 0 },
+            { "message", QJsonObject{ { "role", "assistant" }, { "content", content } } },
+            { "finish_reason", "stop" } } };
+        root["usage"] = QJsonObject{ { "total_tokens", content.size() / 4 } };
+        break;
+    case AIProvider::Anthropic:
+        root["content"] = QJsonArray{ QJsonObject{ { "type", "text" }, { "text", content } } };
+        root["usage"] = QJsonObject{ { "input_tokens", 100 }, { "output_tokens", content.size() / 4 } };
+        break;
+    case AIProvider::Ollama:
+        root["message"] = QJsonObject{ { "role", "assistant" }, { "content", content } };
+        root["done"] = true;
+        root["eval_count"] = content.size() / 4;
+        break;
+    default:
+        break;
+    }
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+// An OpenAI-style event stream delivering content a few characters at a time
+QByteArray eventStream(const QString &content)
+{
+    QByteArray stream;
+    for (int i = 0; i < content.size(); i += 4) {
+        QJsonObject delta{ { "content", content.mid(i, 4) } };
+        QJsonObject event{ { "choices", QJsonArray{ QJsonObject{ { "index", 0 }, { "delta", delta } } } } };
+        stream += "data: " + QJsonDocument(event).toJson(QJsonDocument::Compact) + "\n\n";
+    }
+    stream += "data: [DONE]\n\n";
+    return stream;
+}
+
+} // namespace
+
+void BenchCore::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+
+    // 10k documents for the name search
+    const QStringList kinds = { "draft", "notes", "meeting", "chapter", "journal",
+                                "letter", "outline", "ideas", "review", "todo" };
+    const QStringList topics = { "novel", "project", "garden", "travel", "budget",
+                                 "recipes", "reading", "work", "family", "poems" };
+    QDir documents(m_dir.filePath("documents"));
+    QVERIFY(documents.mkpath("."));
+    for (int i = 0; i < 10000; ++i) {
+        QString name = QString("%1-%2-%3").arg(kinds.at(i % kinds.size()),
+                                               topics.at(i / kinds.size() % topics.size()))
+                                          .arg(i);
+        QFile file(documents.filePath(name + ".md"));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+    }
+    m_fileManager.setDocumentDirectory(documents.path());
+    QCOMPARE(m_fileManager.searchDocuments(QString()).size(), 10000);
+}
+
+void BenchCore::cleanup()
+{
+    // Benchmarked edits are not to be recovered by the next load
+    for (const QString &path : qAsConst(m_documents)) {
+        QFile::remove(EditJournal::journalPath(path));
+    }
+}
+
+void BenchCore::documentSizes()
+{
+    QTest::addColumn<int>("bytes");
+    QTest::newRow("1 KB") << 1024;
+    QTest::newRow("100 KB") << 100 * 1024;
+    QTest::newRow("1 MB") << 1024 * 1024;
+    QTest::newRow("10 MB") << 10 * 1024 * 1024;
+}
+
+QString BenchCore::documentPath(int bytes)
+{
+    auto it = m_documents.constFind(bytes);
+    if (it != m_documents.constEnd()) return it.value();
+
+    QString path = m_dir.filePath(QString("sample-%1.md").arg(bytes));
+    QFile file(path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(sampleText(bytes).toUtf8());
+    }
+    m_documents.insert(bytes, path);
+    return path;
+}
+
+void BenchCore::load(Editor &editor, int bytes)
+{
+    QVERIFY(editor.loadDocument(documentPath(bytes)));
+    // Large documents decode in the background; wait for all of it
+    QTRY_VERIFY_WITH_TIMEOUT(!editor.isLoading(), 60000);
+}
+
+void BenchCore::editorLoad_data()
+{
+    documentSizes();
+}
+
+void BenchCore::editorLoad()
+{
+    QFETCH(int, bytes);
+    const QString path = documentPath(bytes);
+
+    // Until the document can be shown; the rest decodes afterwards
+    QBENCHMARK {
+        Editor editor;
+        editor.loadDocument(path);
+    }
+}
+
+void BenchCore::editorInsert_data()
+{
+    documentSizes();
+}
+
+void BenchCore::editorInsert()
+{
+    QFETCH(int, bytes);
+    Editor editor;
+    load(editor, bytes);
+    editor.setCursorPosition(editor.length() / 2);
+
+    QBENCHMARK {
+        editor.insertText("a");
+    }
+}
+
+void BenchCore::editorBackspace_data()
+{
+    documentSizes();
+}
+
+void BenchCore::editorBackspace()
+{
+    QFETCH(int, bytes);
+    Editor editor;
+    load(editor, bytes);
+    editor.setCursorPosition(editor.length() / 2);
+
+    QBENCHMARK {
+        if (editor.cursorPosition() == 0) {
+            editor.setCursorPosition(editor.length());
+        }
+        editor.backspace();
+    }
+}
+
+void BenchCore::editorUndo_data()
+{
+    documentSizes();
+}
+
+void BenchCore::editorUndo()
+{
+    QFETCH(int, bytes);
+    Editor editor;
+    load(editor, bytes);
+    editor.setCursorPosition(editor.length() / 2);
+
+    // A word typed and taken back again
+    QBENCHMARK {
+        editor.insertText("word ");
+        editor.undo();
+    }
+}
+
+void BenchCore::cursorLeftRight_data()
+{
+    documentSizes();
+}
+
+void BenchCore::cursorLeftRight()
+{
+    QFETCH(int, bytes);
+    Editor editor;
+    load(editor, bytes);
+    editor.setCursorPosition(editor.length() / 2);
+
+    QBENCHMARK {
+        editor.moveCursorRight();
+        editor.moveCursorLeft();
+    }
+}
+
+void BenchCore::cursorUpDown_data()
+{
+    documentSizes();
+}
+
+void BenchCore::cursorUpDown()
+{
+    QFETCH(int, bytes);
+    Editor editor;
+    load(editor, bytes);
+    editor.setCursorPosition(editor.length() / 2);
+
+    QBENCHMARK {
+        editor.moveCursorDown();
+        editor.moveCursorUp();
+    }
+}
+
+void BenchCore::goToLine_data()
+{
+    documentSizes();
+}
+
+void BenchCore::goToLine()
+{
+    QFETCH(int, bytes);
+    Editor editor;
+    load(editor, bytes);
+    const int lines = editor.lineCount();
+
+    // Jump about the document the way search results do
+    int line = 0;
+    QBENCHMARK {
+        line = (line + 7919) % lines;
+        editor.goToLine(line);
+    }
+}
+
+void BenchCore::searchDocuments_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::newRow("one letter") << "n";
+    QTest::newRow("word") << "meeting";
+    QTest::newRow("scattered") << "jrnltrvl";
+    QTest::newRow("no match") << "zzqx";
+}
+
+void BenchCore::searchDocuments()
+{
+    QFETCH(QString, query);
+
+    // Typed one character at a time, as the quick switcher sees it
+    QBENCHMARK {
+        for (int length = 1; length <= query.size(); ++length) {
+            m_fileManager.searchDocuments(query.left(length));
+        }
+        m_fileManager.searchDocuments(QString());
+    }
+}
+
+void BenchCore::mermaidToText_data()
+{
+    QTest::addColumn<QString>("code");
+    QTest::newRow("flowchart") << QString(FLOWCHART);
+    QTest::newRow("sequence") << QString(SEQUENCE);
+    QTest::newRow("mindmap") << QString(MINDMAP);
+    QTest::newRow("other") << QString(PIE);
+}
+
+void BenchCore::mermaidToText()
+{
+    QFETCH(QString, code);
+    MermaidRenderer renderer;
+
+    QBENCHMARK {
+        renderer.renderToText(code);
+    }
+}
+
+void BenchCore::mermaidRasterize_data()
+{
+    QTest::addColumn<QString>("code");
+    QTest::newRow("flowchart") << QString(FLOWCHART);
+    QTest::newRow("sequence") << QString(SEQUENCE);
+    QTest::newRow("mindmap") << QString(MINDMAP);
+}
+
+void BenchCore::mermaidRasterize()
+{
+    QFETCH(QString, code);
+    QVERIFY(DiagramRasterizer::canRender(code));
+
+    QBENCHMARK {
+        DiagramRasterizer::render(code);
+    }
+}
+
+void BenchCore::parseResponse_data()
+{
+    QTest::addColumn<int>("provider");
+    QTest::addColumn<QByteArray>("body");
+
+    const QString shortReply = sampleText(1024);
+    const QString longReply = sampleText(64 * 1024);
+    QTest::newRow("openai 1 KB") << int(AIProvider::OpenAI) << responseBody(AIProvider::OpenAI, shortReply);
+    QTest::newRow("openai 64 KB") << int(AIProvider::OpenAI) << responseBody(AIProvider::OpenAI, longReply);
+    QTest::newRow("anthropic 1 KB") << int(AIProvider::Anthropic) << responseBody(AIProvider::Anthropic, shortReply);
+    QTest::newRow("anthropic 64 KB") << int(AIProvider::Anthropic) << responseBody(AIProvider::Anthropic, longReply);
+    QTest::newRow("ollama 1 KB") << int(AIProvider::Ollama) << responseBody(AIProvider::Ollama, shortReply);
+    QTest::newRow("ollama 64 KB") << int(AIProvider::Ollama) << responseBody(AIProvider::Ollama, longReply);
+}
+
+void BenchCore::parseResponse()
+{
+    QFETCH(int, provider);
+    QFETCH(QByteArray, body);
+
+    AIResponse response;
+    QBENCHMARK {
+        response = AIClient::parseResponse(AIProvider(provider), body);
+    }
+    QVERIFY(response.success);
+}
+
+void BenchCore::parseStream_data()
+{
+    QTest::addColumn<QByteArray>("stream");
+    QTest::newRow("1 KB") << eventStream(sampleText(1024));
+    QTest::newRow("64 KB") << eventStream(sampleText(64 * 1024));
+}
+
+void BenchCore::parseStream()
+{
+    QFETCH(QByteArray, stream);
+    const int chunkSize = 1400; // About one TCP segment per readyRead
+
+    QBENCHMARK {
+        StreamParser parser(StreamParser::ServerSentEvents);
+        QString content;
+        for (int offset = 0; offset < stream.size(); offset += chunkSize) {
+            for (const QByteArray &message : parser.feed(stream.mid(offset, chunkSize))) {
+                QJsonObject root = QJsonDocument::fromJson(message).object();
+                content += root["choices"].toArray().at(0).toObject()["delta"].toObject()["content"].toString();
+            }
+        }
+    }
+}
+
+// QTEST_MAIN, except that without a display (make check, a build machine)
+// the GUI parts run on the offscreen platform
+int main(int argc, char *argv[])
+{
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+    app.setAttribute(Qt::AA_Use96Dpi, true);
+    BenchCore bench;
+    QTEST_SET_MAIN_SOURCE_PATH
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "benchcore.moc"